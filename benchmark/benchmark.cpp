@@ -11,8 +11,11 @@
 #include <chrono>
 #include <algorithm>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "program.hpp"
+#include "scheduler.hpp"
 
 #include "expressions_test.hpp"
 
@@ -152,7 +155,74 @@ void Benchmark::testResult(const NativeEntry &entry) {
 }
 
 
+// Evaluates all expressions over the same rows with runGrid, for 1, 2, 4, ... threads up to
+// the number of hardware threads, and prints the time and the speedup over one thread.
+static int runGridBenchmark(size_t rows, unsigned max_threads) {
+	std::vector<std::unique_ptr<Program>> programs;
+	std::vector<const Program *> grid;
+	for (auto *entries : { &arithmetic_expressions_3_entries, &selection_entries }) {
+		for (const auto &entry : *entries) {
+			try {
+				programs.emplace_back(new Program(entry.expr.c_str(), OPTIMIZATION_LEVEL));
+				grid.push_back(programs.back().get());
+			} catch (...) {
+			}
+		}
+	}
+
+	// the pages of every column are first touched by the thread that will read them, so they are
+	// placed on the NUMA node of that thread
+	std::vector<std::unique_ptr<double[]>> columns;
+	std::vector<ColumnView> arguments;
+	for (int i = 0; i < MAXNARGS; ++i) {
+		columns.emplace_back(new double[rows]);
+		arguments.emplace_back(columns.back().get());
+	}
+	GridOptions fill;
+	fill.threads = max_threads;
+	Program one("1");
+	std::vector<const Program *> fillers(MAXNARGS, &one);
+	std::vector<ResultView> outputs;
+	for (auto &column : columns)
+		outputs.emplace_back(column.get());
+	runGrid(fillers, arguments.data(), outputs.data(), rows, fill);
+
+	std::vector<std::unique_ptr<double[]>> results;
+	std::vector<ResultView> views;
+	for (size_t p = 0; p < grid.size(); ++p) {
+		results.emplace_back(new double[rows]);
+		views.emplace_back(results.back().get());
+	}
+
+	printf("%zu expressions x %zu rows\n", grid.size(), rows);
+	printf("%8s %6s %12s %8s %8s\n", "threads", "nodes", "seconds", "speedup", "stolen");
+	double single = 0.0;
+	for (unsigned threads = 1;; threads = std::min(2 * threads, max_threads)) {
+		GridOptions options;
+		options.threads = threads;
+		auto t1 = std::chrono::high_resolution_clock::now();
+		GridStatistics statistics = runGrid(grid, arguments.data(), views.data(), rows, options);
+		auto t2 = std::chrono::high_resolution_clock::now();
+		double seconds = std::chrono::duration<double>(t2 - t1).count();
+		if (threads == 1)
+			single = seconds;
+		printf("%8u %6u %12.6f %8.2f %8zu\n", threads, statistics.nodes, seconds, single / seconds,
+			statistics.stolen);
+		if (threads == max_threads)
+			break;
+	}
+	return 0;
+}
+
 int main(int argc, char *argv[]) {
+	// benchmark --grid [rows] [threads]
+	if (argc > 1 && std::string(argv[1]) == "--grid") {
+		size_t rows = argc > 2 ? std::stoul(argv[2]) : 10000000;
+		unsigned threads = argc > 3 ? unsigned(std::stoul(argv[3]))
+			: std::thread::hardware_concurrency();
+		return runGridBenchmark(rows, threads > 0 ? threads : 1);
+	}
+
 	Benchmark bm;
 	
 	for (const auto &entry : arithmetic_expressions_3_entries) bm.testCompilation(entry);
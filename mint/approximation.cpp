@@ -0,0 +1,95 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "approximation.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+const size_t Approximation::MAX_DEGREE;
+
+Approximation::Approximation(const Program &program, double low, double high, double max_error,
+	size_t degree, size_t max_pieces) :
+	low(low), high(high), degree(degree)
+{
+	if (program.getArgumentNumber() > 1)
+		throw std::invalid_argument("only programs of one argument can be tabulated");
+	if (program.getOutputNumber() != 1)
+		throw std::invalid_argument("only programs with a single output can be tabulated");
+	if (!(low < high) || !std::isfinite(high - low))
+		throw std::invalid_argument("invalid interval");
+	if (degree < 1 || degree > MAX_DEGREE)
+		throw std::invalid_argument("invalid degree");
+
+	Program::Context context;
+	for (pieces = 1;; pieces *= 2) {
+		tabulate(program, context);
+		if (error <= max_error || pieces * 2 > max_pieces)
+			break;
+	}
+}
+
+void Approximation::tabulate(const Program &program, Program::Context &context) {
+	const double pi = 3.14159265358979323846;
+	double width = (high - low) / double(pieces);
+	scale = double(pieces) / (high - low);
+
+	// the Chebyshev nodes, followed by the points where the error is measured: the ends of the
+	// piece and the midpoints between the nodes
+	std::vector<double> points;
+	for (size_t k = 0; k <= degree; ++k)
+		points.push_back(std::cos(pi * double(2 * k + 1) / double(2 * (degree + 1))));
+	points.push_back(1.0);
+	points.push_back(-1.0);
+	for (size_t k = 0; k < degree; ++k)
+		points.push_back(0.5 * (points[k] + points[k + 1]));
+
+	std::vector<double> x(pieces * points.size()), values(x.size());
+	for (size_t piece = 0; piece < pieces; ++piece) {
+		for (size_t k = 0; k < points.size(); ++k) {
+			x[piece * points.size() + k] = low + (double(piece) + 0.5 * (points[k] + 1.0)) *
+				width;
+		}
+	}
+	ColumnView argument(x.data());
+	program.runRange(context, &argument, ResultView(values.data()), 0, x.size());
+
+	coefficients.assign(pieces * (degree + 1), 0.0);
+	for (size_t piece = 0; piece < pieces; ++piece) {
+		const double *f = values.data() + piece * points.size();
+		double *c = coefficients.data() + piece * (degree + 1);
+		for (size_t j = 0; j <= degree; ++j) {
+			for (size_t k = 0; k <= degree; ++k)
+				c[j] += f[k] * std::cos(pi * double(j * (2 * k + 1)) / double(2 * (degree + 1)));
+			c[j] *= (j == 0 ? 1.0 : 2.0) / double(degree + 1);
+		}
+	}
+
+	error = 0.0;
+	for (size_t piece = 0; piece < pieces; ++piece) {
+		for (size_t k = 0; k < points.size(); ++k) {
+			size_t index = piece * points.size() + k;
+			double difference = std::abs(evaluate(x[index]) - values[index]);
+			if (!(difference <= error)) {
+				error = std::isnan(difference) ? std::numeric_limits<double>::infinity() :
+					difference;
+			}
+		}
+	}
+}
+
+void Approximation::evaluate(const ColumnView &x, const ResultView &result, size_t n) const {
+	if (result.type != TYPE_FLOAT64 && result.type != TYPE_FLOAT32)
+		throw std::invalid_argument("unsupported result type");
+	double buffer[Program::BLOCK_SIZE];
+	double values[Program::BLOCK_SIZE];
+	for (size_t first = 0; first < n; first += Program::BLOCK_SIZE) {
+		size_t count = n - first < Program::BLOCK_SIZE ? n - first : Program::BLOCK_SIZE;
+		const double *arguments = loadColumn(x, first, nullptr, count, buffer);
+		for (size_t j = 0; j < count; ++j)
+			values[j] = evaluate(arguments[j]);
+		storeColumn(result, first, nullptr, count, values);
+	}
+}
@@ -0,0 +1,77 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef APPROXIMATION_HPP_
+#define APPROXIMATION_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+#include <vector>
+
+/// A program of one argument tabulated as a piecewise polynomial over an interval, for
+/// expensive functions that are evaluated very often over a known range.  The interval is split
+/// into pieces of equal width, and on each piece the program is interpolated at the Chebyshev
+/// nodes.  Evaluating a value finds its piece with one multiplication and sums the Chebyshev
+/// series of the piece with getDegree() steps of the Clenshaw recurrence.
+class Approximation {
+public:
+	/// Tabulates program over [low, high] with polynomials of the given degree, doubling the
+	/// number of pieces until the error is at most max_error or there are max_pieces of them.
+	/// The error is estimated against the program at 2 * degree + 3 points of every piece: the
+	/// interpolation nodes, the ends and the midpoints between the nodes, so functions with poles
+	/// or steps inside the interval can't reach max_error.  Throws
+	/// std::invalid_argument if the program has more than one argument or several outputs, if
+	/// the interval is empty or if the degree is not between 1 and MAX_DEGREE.
+	Approximation(const Program &program, double low, double high, double max_error,
+		size_t degree = 5, size_t max_pieces = size_t(1) << 16);
+
+	static const size_t MAX_DEGREE = 15;
+
+	/// Estimate of the error: the largest difference to the program at the 2 * degree + 3
+	/// sample points of every piece when building the table.  The difference between the
+	/// sample points can be larger.
+	double getError() const { return error; }
+
+	size_t getPieceNumber() const { return pieces; }
+	size_t getDegree() const { return degree; }
+
+	/// Evaluates the approximation.  Values outside the interval are extrapolated from the
+	/// first or last piece.
+	double evaluate(double x) const {
+		double t = (x - low) * scale;
+		size_t piece = 0;
+		if (t >= double(pieces))
+			piece = pieces - 1;
+		else if (t > 0.0)
+			piece = size_t(t);
+		double u = 2.0 * (t - double(piece)) - 1.0; // in [-1, 1] on the piece
+		const double *c = coefficients.data() + piece * (degree + 1);
+		// Clenshaw: b_k = c_k + 2u b_(k+1) - b_(k+2), and the sum is c_0 + u b_1 - b_2
+		double b1 = c[degree];
+		double b2 = 0.0;
+		for (size_t k = degree - 1; k > 0; --k) {
+			double b = c[k] + 2.0 * u * b1 - b2;
+			b2 = b1;
+			b1 = b;
+		}
+		return c[0] + u * b1 - b2;
+	}
+
+	/// Evaluates n values of x and writes result i.
+	void evaluate(const ColumnView &x, const ResultView &result, size_t n) const;
+
+private:
+	void tabulate(const Program &program, Program::Context &context);
+
+	double low;
+	double high;
+	double scale = 0.0; // pieces per unit of x
+	size_t degree;
+	size_t pieces = 0;
+	double error = 0.0;
+	std::vector<double> coefficients; // of T_0(u) to T_degree(u), degree + 1 per piece
+};
+
+#endif // APPROXIMATION_HPP_
@@ -4,7 +4,11 @@
 
 #include "ast.hpp"
 
+#include <cstdint>
 #include <cstdio>
+#include <utility>
+
+using std::move;
 
 static void print(const Ast &ast, int indent) {
 	if (indent > 0)
@@ -13,6 +17,9 @@ static void print(const Ast &ast, int indent) {
 	switch (ast.op) {
 	case OP_ARG:
 	case OP_POWI:
+	case OP_CALL:
+	case OP_STORE:
+	case OP_LOAD:
 		printf(" %d\n", ast.i);
 		break;
 	case OP_CONST:
@@ -27,23 +34,97 @@ static void print(const Ast &ast, int indent) {
 	}
 }
 
+// copies other into ast, which has no children, with an explicit stack of the nodes whose
+// children are still to be copied
+static void copyTree(Ast &ast, const Ast &other) {
+	std::vector<std::pair<Ast *, const Ast *>> stack;
+	stack.emplace_back(&ast, &other);
+	while (stack.size() > 0) {
+		Ast *to = stack.back().first;
+		const Ast *from = stack.back().second;
+		stack.pop_back();
+		to->op = from->op;
+		memcpy(&to->str, &from->str, sizeof(to->str));
+		to->stack_size_needed = from->stack_size_needed;
+		to->pos = from->pos;
+		to->len = from->len;
+		// the children are not moved once they are on the stack
+		to->children.resize(from->children.size());
+		for (size_t i = 0; i < from->children.size(); ++i)
+			stack.emplace_back(&to->children[i], &from->children[i]);
+	}
+}
+
+Ast::Ast(const Ast &other) {
+	copyTree(*this, other);
+}
+
+Ast &Ast::operator = (const Ast &other) {
+	// other may be a descendant of this node, so it is copied before the children are replaced
+	if (this != &other) {
+		Ast copy(other);
+		*this = move(copy);
+	}
+	return *this;
+}
+
+Ast::~Ast() {
+	if (children.empty())
+		return;
+	// move all descendants into a flat list, so every node is destroyed without children
+	std::vector<Ast> pending = move(children);
+	while (pending.size() > 0) {
+		Ast ast = move(pending.back());
+		pending.pop_back();
+		for (Ast &child : ast.children) {
+			pending.emplace_back(move(child));
+		}
+		ast.children.clear();
+	}
+}
+
 bool Ast::equals(const Ast &other) const
 {
-	if (this == &other)
-		return true;
-	if (op != other.op)
-		return false;
-	if (children.size() != other.children.size())
-		return false;
-	if (memcmp(&str, &other.str, sizeof(str)) != 0)
-		return false;
-	for (size_t i = 0; i < children.size(); ++i) {
-		if (!children[i].equals(other.children[i]))
+	std::vector<std::pair<const Ast *, const Ast *>> stack;
+	stack.emplace_back(this, &other);
+	while (stack.size() > 0) {
+		const Ast *lhs = stack.back().first;
+		const Ast *rhs = stack.back().second;
+		stack.pop_back();
+		if (lhs == rhs)
+			continue;
+		if (lhs->op != rhs->op)
+			return false;
+		if (lhs->children.size() != rhs->children.size())
 			return false;
+		if (memcmp(&lhs->str, &rhs->str, sizeof(lhs->str)) != 0)
+			return false;
+		for (size_t i = 0; i < lhs->children.size(); ++i) {
+			stack.emplace_back(&lhs->children[i], &rhs->children[i]);
+		}
 	}
 	return true;
 }
 
+size_t Ast::hash() const {
+	uint64_t hash = 0;
+	std::vector<const Ast *> stack;
+	stack.push_back(this);
+	while (stack.size() > 0) {
+		const Ast *ast = stack.back();
+		stack.pop_back();
+		uint64_t bits;
+		memcpy(&bits, &ast->str, sizeof(bits));
+		for (uint64_t value : { uint64_t(ast->op), bits, uint64_t(ast->children.size()) }) {
+			hash = (hash ^ value) * 0x100000001b3ull;
+			hash ^= hash >> 29;
+		}
+		for (const Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	return size_t(hash);
+}
+
 void print(const Ast &ast) {
 	print(ast, 0);
 }
@@ -7,6 +7,7 @@
 
 #include "ops.hpp"
 
+#include <cstring>
 #include <vector>
 
 struct Ast {
@@ -18,6 +19,8 @@ struct Ast {
 		char str[8];
 	};
 	size_t stack_size_needed = 0;
+	int pos = -1; // position of the token in the source, or -1
+	int len = 0;  // length of the token
 
 	Ast(Op op = OP_INVALID) :
 		op(op)
@@ -25,7 +28,17 @@ struct Ast {
 		memset(&str, 0, sizeof(str));
 	}
 
+	// copies and destroys deep trees without recursion
+	Ast(const Ast &other);
+	Ast(Ast &&) = default;
+	Ast &operator = (const Ast &other);
+	Ast &operator = (Ast &&) = default;
+	~Ast();
+
 	bool equals(const Ast &) const;
+
+	/// hash of the whole tree, equal for trees that are equal
+	size_t hash() const;
 };
 
 inline bool operator == (const Ast &lhs, const Ast &rhs) {
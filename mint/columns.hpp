@@ -0,0 +1,120 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef COLUMNS_HPP_
+#define COLUMNS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+enum ElementType {
+	TYPE_FLOAT64,
+	TYPE_FLOAT32,
+	TYPE_INT32,
+	TYPE_INT64,
+};
+
+/// Describes where the values of one input column are stored: element i is found at
+/// data + i * stride bytes.  With a stride larger than the element, this can be a field of an
+/// array of structs or a strided view into larger records.
+struct ColumnView {
+	const void *data = nullptr;
+	ptrdiff_t stride = 0; // in bytes
+	ElementType type = TYPE_FLOAT64;
+
+	ColumnView() = default;
+	ColumnView(const void *data, ptrdiff_t stride, ElementType type) :
+		data(data), stride(stride), type(type) {}
+
+	ColumnView(const double *data) : ColumnView(data, sizeof(double), TYPE_FLOAT64) {}
+	ColumnView(const float *data) : ColumnView(data, sizeof(float), TYPE_FLOAT32) {}
+	ColumnView(const int32_t *data) : ColumnView(data, sizeof(int32_t), TYPE_INT32) {}
+	ColumnView(const int64_t *data) : ColumnView(data, sizeof(int64_t), TYPE_INT64) {}
+};
+
+/// Describes where results are written to, see ColumnView.  Only floating point types are
+/// supported.
+struct ResultView {
+	void *data = nullptr;
+	ptrdiff_t stride = 0; // in bytes
+	ElementType type = TYPE_FLOAT64;
+
+	ResultView() = default;
+	ResultView(void *data, ptrdiff_t stride, ElementType type) :
+		data(data), stride(stride), type(type) {}
+
+	ResultView(double *data) : ResultView(data, sizeof(double), TYPE_FLOAT64) {}
+	ResultView(float *data) : ResultView(data, sizeof(float), TYPE_FLOAT32) {}
+};
+
+/// Where the results of an evaluation over selected rows are written to.
+enum ResultPlacement {
+	RESULT_DENSE,     // the result of the j-th selected row goes to result row j
+	RESULT_SCATTERED, // the result of a selected row goes to the same row of the result
+};
+
+// Loads the values of a column and converts them to double, see loadColumn().
+template <typename T>
+inline const double *gatherValues(const ColumnView &view, size_t first, const size_t *rows,
+	size_t count, double *buffer)
+{
+	const char *base = (const char *)view.data;
+	if (rows) {
+		for (size_t j = 0; j < count; ++j)
+			buffer[j] = double(*(const T *)(base + ptrdiff_t(rows[j]) * view.stride));
+	} else {
+		const char *p = base + ptrdiff_t(first) * view.stride;
+		for (size_t j = 0; j < count; ++j, p += view.stride)
+			buffer[j] = double(*(const T *)p);
+	}
+	return buffer;
+}
+
+/// Loads the values of the given rows or, if rows is null, of count rows starting at first
+/// into buffer and converts them to double.  Dense double columns are not copied, the returned
+/// pointer then points into the column.
+inline const double *loadColumn(const ColumnView &view, size_t first, const size_t *rows,
+	size_t count, double *buffer)
+{
+	switch (view.type) {
+	case TYPE_FLOAT64:
+		if (view.stride == sizeof(double) && !rows)
+			return (const double *)view.data + first;
+		return gatherValues<double>(view, first, rows, count, buffer);
+	case TYPE_FLOAT32: return gatherValues<float>(view, first, rows, count, buffer);
+	case TYPE_INT32:   return gatherValues<int32_t>(view, first, rows, count, buffer);
+	case TYPE_INT64:   return gatherValues<int64_t>(view, first, rows, count, buffer);
+	default:           return buffer;
+	}
+}
+
+// Converts values to the type of a result and stores them, see storeColumn().
+template <typename T>
+inline void scatterValues(const ResultView &view, size_t first, const size_t *rows,
+	size_t count, const double *values)
+{
+	char *base = (char *)view.data;
+	if (rows) {
+		for (size_t j = 0; j < count; ++j)
+			*(T *)(base + ptrdiff_t(rows[j]) * view.stride) = T(values[j]);
+	} else {
+		char *p = base + ptrdiff_t(first) * view.stride;
+		for (size_t j = 0; j < count; ++j, p += view.stride)
+			*(T *)p = T(values[j]);
+	}
+}
+
+/// Stores count values to the given rows or, if rows is null, to count rows starting at first.
+/// Results of other than floating point types are left alone.
+inline void storeColumn(const ResultView &view, size_t first, const size_t *rows, size_t count,
+	const double *values)
+{
+	switch (view.type) {
+	case TYPE_FLOAT64: scatterValues<double>(view, first, rows, count, values); break;
+	case TYPE_FLOAT32: scatterValues<float>(view, first, rows, count, values); break;
+	default:           break;
+	}
+}
+
+#endif // COLUMNS_HPP_
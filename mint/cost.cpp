@@ -0,0 +1,148 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "cost.hpp"
+
+#include "program.hpp"
+
+#include <chrono>
+#include <utility>
+#include <vector>
+
+struct CostData {
+	Op op;
+	double cost;
+};
+
+// operators that are not listed cost 1
+static const CostData DEFAULT_COST_TABLE[] = {
+	{ OP_HLT,    0.0 },
+	{ OP_NOOP,   0.0 },
+	{ OP_CONST,  0.5 },
+	{ OP_ARG,    0.5 },
+	{ OP_CONST16, 0.5 },
+	{ OP_CONST32, 0.5 },
+	{ OP_ARG16,  0.5 },
+	{ OP_ARG32,  0.5 },
+	{ OP_PI,     0.5 },
+	{ OP_E,      0.5 },
+	{ OP_INV,    5.0 },
+	{ OP_CU,     2.0 },
+	{ OP_SQRT,   6.0 },
+	{ OP_SIN,    20.0 },
+	{ OP_COS,    20.0 },
+	{ OP_TAN,    30.0 },
+	{ OP_ASIN,   25.0 },
+	{ OP_ACOS,   25.0 },
+	{ OP_ATAN,   25.0 },
+	{ OP_SINH,   30.0 },
+	{ OP_COSH,   30.0 },
+	{ OP_TANH,   30.0 },
+	{ OP_ASINH,  35.0 },
+	{ OP_ACOSH,  35.0 },
+	{ OP_ATANH,  35.0 },
+	{ OP_EXP,    15.0 },
+	{ OP_LOG,    15.0 },
+	{ OP_ERF,    20.0 },
+	{ OP_ERFC,   20.0 },
+	{ OP_POWI,   8.0 },
+	{ OP_DIV,    5.0 },
+	{ OP_RDIV,   5.0 },
+	{ OP_POW,    50.0 },
+	{ OP_RPOW,   50.0 },
+	{ OP_CALL,   20.0 },
+};
+
+CostModel::CostModel() {
+	for (double &cost : costs)
+		cost = 1.0;
+	for (const CostData &data : DEFAULT_COST_TABLE)
+		costs[data.op] = data.cost;
+}
+
+// inputs for which every operator is defined and takes its usual path
+static double calibrationInput(int op, size_t j, size_t count) {
+	double x = 0.5 + 0.4 * double(j) / double(count);
+	return op == OP_ACOSH ? x + 1.0 : x;
+}
+
+// seconds per row for evaluating the given operator on its arguments
+static double measure(int op, size_t operands) {
+	const size_t rows = 16 * Program::BLOCK_SIZE;
+	const int repetitions = 16;
+
+	Ast root(OP_HLT);
+	if (op == OP_ARG) {
+		root.children.emplace_back(OP_ARG);
+	} else {
+		Ast node = Ast(Op(op));
+		if (op == OP_POWI)
+			node.i = 7;
+		for (size_t i = 0; i < operands; ++i) {
+			Ast argument(OP_ARG);
+			argument.i = long(i);
+			node.children.emplace_back(std::move(argument));
+		}
+		root.children.emplace_back(std::move(node));
+	}
+	Program program(root);
+
+	std::vector<std::vector<double>> columns(operands > 0 ? operands : 1);
+	std::vector<ColumnView> views;
+	for (std::vector<double> &column : columns) {
+		column.resize(rows);
+		for (size_t j = 0; j < rows; ++j)
+			column[j] = calibrationInput(op, j, rows);
+		views.emplace_back(column.data());
+	}
+	std::vector<double> result(rows);
+
+	// the fastest of several runs is the least disturbed one
+	typedef std::chrono::steady_clock Clock;
+	double best = 0.0;
+	for (int r = 0; r < repetitions; ++r) {
+		Clock::time_point start = Clock::now();
+		program.run(views.data(), ResultView(result.data()), rows);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (r == 0 || seconds < best)
+			best = seconds;
+	}
+	return best / double(rows);
+}
+
+CostModel CostModel::calibrate() {
+	CostModel model;
+	// loading the arguments and storing the result is not part of the operator's cost
+	double base = measure(OP_ARG, 0);
+	double add = measure(OP_ADD, 2) - base;
+	if (add <= 0.0)
+		return model;
+	for (int op = OP_NEG; op < OP_INVALID; ++op) {
+		// native functions are not known to the cost model
+		if (!isOperatorValid(op) || op == OP_CALL)
+			continue;
+		size_t operands = getOperandNumber(op);
+		double cost = (measure(op, operands) - base) / add;
+		model.costs[op] = cost > 0.1 ? cost : 0.1;
+	}
+	return model;
+}
+
+double CostModel::estimate(const Ast &root) const {
+	double total = 0.0;
+	std::vector<const Ast *> stack;
+	stack.push_back(&root);
+	while (stack.size() > 0) {
+		const Ast *ast = stack.back();
+		stack.pop_back();
+		// n-ary sums and products are evaluated as a chain of binary operations
+		size_t count = 1;
+		if ((ast->op == OP_ADD || ast->op == OP_MUL) && ast->children.size() > 2)
+			count = ast->children.size() - 1;
+		total += getCost(ast->op) * double(count);
+		for (const Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	return total;
+}
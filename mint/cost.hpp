@@ -0,0 +1,33 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef COST_HPP_
+#define COST_HPP_
+
+#include "ast.hpp"
+#include "ops.hpp"
+
+/// Estimated cost of every operator per row, relative to an addition, which costs 1.  The
+/// default table holds typical values for x86 processors, calibrate() measures the host.
+class CostModel {
+public:
+	CostModel();
+
+	/// Measures the cost of every operator by evaluating it with the block interpreter.
+	static CostModel calibrate();
+
+	double getCost(int op) const { return isIndexed(op) ? costs[op] : 0.0; }
+	void setCost(int op, double cost) { if (isIndexed(op)) costs[op] = cost; }
+
+	/// estimated cost of evaluating the tree for one row
+	double estimate(const Ast &ast) const;
+
+private:
+	// the bounds are checked here as well, so the compiler sees them
+	static bool isIndexed(int op) { return 0 <= op && op < OP_INVALID && isOperatorValid(op); }
+
+	double costs[OP_INVALID];
+};
+
+#endif // COST_HPP_
@@ -0,0 +1,321 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "derivatives.hpp"
+
+#include <climits>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+using std::move;
+
+static Ast makeConstant(double value) {
+	Ast ast(OP_CONST);
+	ast.d = value;
+	return ast;
+}
+
+static bool isConstant(const Ast &ast, double value) {
+	return ast.op == OP_CONST && ast.d == value;
+}
+
+static Ast makeNode(Op op, Ast &&x) {
+	Ast ast(op);
+	ast.children.emplace_back(move(x));
+	return ast;
+}
+
+static Ast makeNode(Op op, Ast &&x, Ast &&y) {
+	Ast ast(op);
+	ast.children.emplace_back(move(x));
+	ast.children.emplace_back(move(y));
+	return ast;
+}
+
+// the builders leave out terms with a zero derivative, which is most of them for expressions
+// with several arguments
+static Ast sum(Ast &&x, Ast &&y) {
+	if (isConstant(x, 0.0))
+		return move(y);
+	if (isConstant(y, 0.0))
+		return move(x);
+	return makeNode(OP_ADD, move(x), move(y));
+}
+
+static Ast difference(Ast &&x, Ast &&y) {
+	if (isConstant(y, 0.0))
+		return move(x);
+	if (isConstant(x, 0.0))
+		return makeNode(OP_NEG, move(y));
+	return makeNode(OP_SUB, move(x), move(y));
+}
+
+static Ast product(Ast &&x, Ast &&y) {
+	if (isConstant(x, 0.0) || isConstant(y, 0.0))
+		return makeConstant(0.0);
+	if (isConstant(x, 1.0))
+		return move(y);
+	if (isConstant(y, 1.0))
+		return move(x);
+	return makeNode(OP_MUL, move(x), move(y));
+}
+
+static Ast quotient(Ast &&x, Ast &&y) {
+	if (isConstant(x, 0.0))
+		return makeConstant(0.0);
+	return makeNode(OP_DIV, move(x), move(y));
+}
+
+static Ast square(const Ast &x) {
+	return makeNode(OP_SQ, Ast(x));
+}
+
+// x^exponent, also for exponents POWI can't hold
+static Ast power(const Ast &x, long exponent) {
+	if (exponent == 0)
+		return makeConstant(1.0);
+	if (exponent == 1)
+		return x;
+	if (exponent < SCHAR_MIN || exponent > SCHAR_MAX)
+		return makeNode(OP_POW, Ast(x), makeConstant(double(exponent)));
+	Ast ast = makeNode(OP_POWI, Ast(x));
+	ast.i = exponent;
+	return ast;
+}
+
+// derivative of f(x) with respect to x, where f is a function of one operand
+static Ast outerDerivative(const Ast &node) {
+	const Ast &x = node.children[0];
+	switch (node.op) {
+	case OP_NEG:   return makeConstant(-1.0);
+	case OP_INV:   return makeNode(OP_NEG, makeNode(OP_INV, square(x)));
+	case OP_SQ:    return product(makeConstant(2.0), Ast(x));
+	case OP_CU:    return product(makeConstant(3.0), square(x));
+	case OP_SQRT:  return makeNode(OP_INV, product(makeConstant(2.0), Ast(node)));
+	case OP_SIN:   return makeNode(OP_COS, Ast(x));
+	case OP_COS:   return makeNode(OP_NEG, makeNode(OP_SIN, Ast(x)));
+	case OP_TAN:   return sum(makeConstant(1.0), square(node));
+	case OP_ASIN:
+		return makeNode(OP_INV, makeNode(OP_SQRT, difference(makeConstant(1.0), square(x))));
+	case OP_ACOS:
+		return makeNode(OP_NEG, makeNode(OP_INV,
+			makeNode(OP_SQRT, difference(makeConstant(1.0), square(x)))));
+	case OP_ATAN:  return makeNode(OP_INV, sum(makeConstant(1.0), square(x)));
+	case OP_SINH:  return makeNode(OP_COSH, Ast(x));
+	case OP_COSH:  return makeNode(OP_SINH, Ast(x));
+	case OP_TANH:  return difference(makeConstant(1.0), square(node));
+	case OP_ASINH:
+		return makeNode(OP_INV, makeNode(OP_SQRT, sum(square(x), makeConstant(1.0))));
+	case OP_ACOSH:
+		return makeNode(OP_INV, makeNode(OP_SQRT, difference(square(x), makeConstant(1.0))));
+	case OP_ATANH: return makeNode(OP_INV, difference(makeConstant(1.0), square(x)));
+	case OP_EXP:   return node;
+	case OP_LOG:   return makeNode(OP_INV, Ast(x));
+	case OP_ERF:
+	case OP_ERFC: {
+		const double scale = 1.12837916709551257390; // 2 / sqrt(pi)
+		return product(makeConstant(node.op == OP_ERF ? scale : -scale),
+			makeNode(OP_EXP, makeNode(OP_NEG, square(x))));
+	}
+	case OP_LOG1P: return makeNode(OP_INV, sum(makeConstant(1.0), Ast(x)));
+	case OP_EXPM1: return makeNode(OP_EXP, Ast(x));
+	case OP_CBRT:  return makeNode(OP_INV, product(makeConstant(3.0), square(node)));
+	case OP_ABS: {
+		Ast ast(OP_SELECT);
+		ast.children.emplace_back(makeNode(OP_LT, Ast(x), makeConstant(0.0)));
+		ast.children.emplace_back(makeConstant(-1.0));
+		ast.children.emplace_back(makeConstant(1.0));
+		return ast;
+	}
+	case OP_POWI:  return product(makeConstant(double(node.i)), power(x, node.i - 1));
+	default:       return makeConstant(0.0); // step functions and logical operations
+	}
+}
+
+// Derivative of node, given the derivatives of its children, which are consumed.  At least one
+// of them is not zero.
+static Ast chainRule(const Ast &node, std::vector<Ast> &&derivatives) {
+	const std::vector<Ast> &children = node.children;
+	switch (node.op) {
+	case OP_HLT: {
+		Ast root(OP_HLT);
+		root.children = move(derivatives);
+		return root;
+	}
+	case OP_ADD: {
+		Ast result = makeConstant(0.0);
+		for (Ast &derivative : derivatives)
+			result = sum(move(result), move(derivative));
+		return result;
+	}
+	case OP_MUL: {
+		// the product rule for n factors
+		Ast result = makeConstant(0.0);
+		for (size_t i = 0; i < children.size(); ++i) {
+			if (isConstant(derivatives[i], 0.0))
+				continue;
+			Ast others(OP_MUL);
+			for (size_t j = 0; j < children.size(); ++j) {
+				if (j != i)
+					others.children.push_back(children[j]);
+			}
+			if (others.children.size() == 1) {
+				Ast single = move(others.children[0]);
+				others = move(single);
+			}
+			result = sum(move(result), product(move(derivatives[i]), move(others)));
+		}
+		return result;
+	}
+	case OP_SUB:
+		return difference(move(derivatives[0]), move(derivatives[1]));
+	case OP_RSUB:
+		return difference(move(derivatives[1]), move(derivatives[0]));
+	case OP_DIV:
+	case OP_RDIV: {
+		// (a/b)' = a'/b - (a/b) * b'/b
+		size_t a = node.op == OP_DIV ? 0 : 1;
+		size_t b = 1 - a;
+		return difference(quotient(move(derivatives[a]), Ast(children[b])),
+			product(Ast(node), quotient(move(derivatives[b]), Ast(children[b]))));
+	}
+	case OP_POW:
+	case OP_RPOW: {
+		// (a^b)' = b * a^(b-1) * a' + a^b * log(a) * b', with the partials of the reverse
+		// sweep, so both give NaN for the derivative with respect to b where a isn't positive
+		size_t a = node.op == OP_POW ? 0 : 1;
+		size_t b = 1 - a;
+		Ast exponent = difference(Ast(children[b]), makeConstant(1.0));
+		Ast power = node.op == OP_POW ?
+			makeNode(OP_POW, Ast(children[a]), move(exponent)) :
+			makeNode(OP_RPOW, move(exponent), Ast(children[a]));
+		Ast result = product(product(Ast(children[b]), move(power)), move(derivatives[a]));
+		if (isConstant(derivatives[b], 0.0))
+			return result;
+		return sum(move(result), product(product(Ast(node), makeNode(OP_LOG, Ast(children[a]))),
+			move(derivatives[b])));
+	}
+	case OP_HYPOT: {
+		// (a a' + b b') / hypot(a, b), and 0 at the origin like the reverse sweep
+		Ast ratio = quotient(sum(product(Ast(children[0]), move(derivatives[0])),
+			product(Ast(children[1]), move(derivatives[1]))), Ast(node));
+		if (isConstant(ratio, 0.0))
+			return ratio;
+		Ast ast(OP_SELECT);
+		ast.children.emplace_back(makeNode(OP_EQ, Ast(node), makeConstant(0.0)));
+		ast.children.emplace_back(makeConstant(0.0));
+		ast.children.emplace_back(move(ratio));
+		return ast;
+	}
+	case OP_SELECT: {
+		if (isConstant(derivatives[1], 0.0) && isConstant(derivatives[2], 0.0))
+			return makeConstant(0.0);
+		Ast ast(OP_SELECT);
+		ast.children.push_back(children[0]);
+		ast.children.push_back(move(derivatives[1]));
+		ast.children.push_back(move(derivatives[2]));
+		return ast;
+	}
+	case OP_NOOP: // left by the optimizer, e.g. for x^1
+		return move(derivatives[0]);
+	case OP_CALL:
+		throw std::invalid_argument("native functions can't be differentiated");
+	default:
+		if (children.size() == 1)
+			return product(outerDerivative(node), move(derivatives[0]));
+		return makeConstant(0.0); // comparisons and logical operations
+	}
+}
+
+// undoes the sharing done by the optimizer, so subtrees can be copied freely
+static Ast unshare(const Ast &ast) {
+	Ast result = ast;
+	std::vector<Ast *> stack;
+	stack.push_back(&result);
+	while (stack.size() > 0) {
+		Ast *node = stack.back();
+		stack.pop_back();
+		while (node->op == OP_STORE) {
+			Ast child = move(node->children[0]);
+			*node = move(child);
+		}
+		if (node->op == OP_SINCOS)
+			node->op = OP_SIN;
+		else if (node->op == OP_COSSIN)
+			node->op = OP_COS;
+		for (Ast &child : node->children)
+			stack.push_back(&child);
+	}
+	return result;
+}
+
+Ast differentiate(const Ast &ast, size_t argument) {
+	Ast tree = unshare(ast);
+
+	// post-order traversal with an explicit stack, the derivatives of the children of the
+	// current node are the last ones in derivatives
+	struct DerivativeState {
+		const Ast *ast;
+		size_t index;
+	};
+	std::vector<DerivativeState> stack;
+	std::vector<Ast> derivatives;
+	stack.push_back({ &tree, 0 });
+	while (stack.size() > 0) {
+		const Ast *node = stack.back().ast;
+		size_t index = stack.back().index;
+		if (index < node->children.size()) {
+			stack.back().index++;
+			stack.push_back({ &node->children[index], 0 });
+			continue;
+		}
+		stack.pop_back();
+
+		if (node->op == OP_ARG) {
+			derivatives.push_back(makeConstant(node->i == long(argument) ? 1.0 : 0.0));
+			continue;
+		}
+		size_t n = node->children.size();
+		std::vector<Ast> operands(std::make_move_iterator(derivatives.end() - n),
+			std::make_move_iterator(derivatives.end()));
+		derivatives.resize(derivatives.size() - n);
+		bool depends = node->op == OP_HLT;
+		for (const Ast &operand : operands)
+			depends = depends || !isConstant(operand, 0.0);
+		derivatives.push_back(depends ? chainRule(*node, move(operands)) : makeConstant(0.0));
+	}
+	return move(derivatives.back());
+}
+
+Program compileDerivative(const char *src, size_t argument, int optimize) {
+	Ast derivative = differentiate(Program::parse(src), argument);
+	Program::applyOptimizations(&derivative, optimize);
+	return Program(derivative);
+}
+
+Program compileGradient(const char *src, int optimize) {
+	Ast tree = Program::parse(src);
+	if (tree.children.size() != 1)
+		throw std::invalid_argument("the gradient needs a single output");
+	size_t argument_number = 0;
+	std::vector<const Ast *> stack;
+	stack.push_back(&tree);
+	while (stack.size() > 0) {
+		const Ast *node = stack.back();
+		stack.pop_back();
+		if (node->op == OP_ARG && argument_number < size_t(node->i) + 1)
+			argument_number = size_t(node->i) + 1;
+		for (const Ast &child : node->children)
+			stack.push_back(&child);
+	}
+
+	Ast gradient(OP_HLT);
+	for (size_t k = 0; k < argument_number; ++k)
+		gradient.children.push_back(move(differentiate(tree, k).children[0]));
+	if (gradient.children.empty())
+		gradient.children.push_back(makeConstant(0.0));
+	Program::applyOptimizations(&gradient, optimize);
+	return Program(gradient);
+}
@@ -0,0 +1,30 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef DERIVATIVES_HPP_
+#define DERIVATIVES_HPP_
+
+#include "ast.hpp"
+#include "program.hpp"
+
+/// Returns the partial derivative of a tree with respect to the given argument.  For a tree with
+/// an OP_HLT root as returned by Program::parse(), every output is differentiated.  Derivatives
+/// of terms that don't depend on the argument are left out, but the result is not optimized
+/// otherwise.  Step functions like floor and the comparisons have the derivative 0, and abs has
+/// the derivative 1 at 0.  The derivative of u^v with respect to v is u^v * log(u), which is NaN
+/// where u isn't positive, and constant factors 0 drop the derivatives of the other factors, the
+/// same as Program::runGradient().  Throws std::invalid_argument for calls to native functions.
+Ast differentiate(const Ast &ast, size_t argument);
+
+/// Compiles the partial derivative of src with respect to the given argument, optimized like a
+/// program at the given level.
+Program compileDerivative(const char *src, size_t argument,
+	int optimize = Program::OPTIMIZE_STRICT);
+
+/// Compiles the gradient of src, a program with one output per argument of src, so
+/// subexpressions are shared between the partial derivatives.  Throws std::invalid_argument if
+/// src has several outputs.
+Program compileGradient(const char *src, int optimize = Program::OPTIMIZE_STRICT);
+
+#endif // DERIVATIVES_HPP_
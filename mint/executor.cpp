@@ -0,0 +1,272 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "executor.hpp"
+
+#include <stdexcept>
+
+using std::move;
+
+const size_t Executor::CHUNK_BLOCKS;
+
+static const size_t CHUNK_ROWS = Executor::CHUNK_BLOCKS * Program::BLOCK_SIZE;
+
+// keeps the first error of a job with several chunks
+struct Failure {
+	std::mutex mutex;
+	std::exception_ptr error;
+
+	void set(std::exception_ptr e) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!error)
+			error = e;
+	}
+};
+
+Executor::Executor(unsigned threads, size_t max_jobs) :
+	max_jobs(max_jobs > 0 ? max_jobs : 1)
+{
+	if (threads == 0)
+		threads = 1;
+	for (unsigned i = 0; i < threads; ++i)
+		workers.emplace_back(&Executor::work, this);
+}
+
+Executor::~Executor() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	job_ready.notify_all();
+	for (std::thread &worker : workers)
+		worker.join();
+}
+
+size_t Executor::getJobsInFlight() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return jobs;
+}
+
+void Executor::work() {
+	Program::Context context;
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		job_ready.wait(lock, [this]() { return stopping || queue.size() > 0; });
+		if (queue.empty())
+			return;
+
+		// take one chunk and move the job to the back, so the jobs take turns
+		std::shared_ptr<Job> job = queue.front();
+		queue.pop_front();
+		size_t chunk = job->next_chunk++;
+		if (job->next_chunk < job->chunks)
+			queue.push_back(job);
+
+		lock.unlock();
+		job->run(context, chunk);
+		if (--job->remaining == 0)
+			job->finish();
+		lock.lock();
+	}
+}
+
+void Executor::admit() {
+	std::unique_lock<std::mutex> lock(mutex);
+	job_done.wait(lock, [this]() { return jobs < max_jobs; });
+	++jobs;
+}
+
+void Executor::release() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		--jobs;
+	}
+	job_done.notify_one();
+}
+
+void Executor::schedule(std::shared_ptr<Job> job) {
+	job->remaining = job->chunks;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(move(job));
+	}
+	job_ready.notify_all();
+}
+
+std::future<Executor::ProgramPtr> Executor::compile(const std::string &src, int optimize) {
+	admit();
+	auto promise = std::make_shared<std::promise<ProgramPtr>>();
+	std::future<ProgramPtr> future = promise->get_future();
+	auto failure = std::make_shared<Failure>();
+	auto compiled = std::make_shared<ProgramPtr>();
+	auto job = std::make_shared<Job>();
+	job->run = [src, optimize, compiled, failure](Program::Context &, size_t) {
+		try {
+			*compiled = std::make_shared<const Program>(src.c_str(), optimize);
+		} catch (...) {
+			failure->set(std::current_exception());
+		}
+	};
+	job->finish = [this, promise, compiled, failure]() {
+		release();
+		if (failure->error)
+			promise->set_exception(failure->error);
+		else
+			promise->set_value(*compiled);
+	};
+	schedule(move(job));
+	return future;
+}
+
+void Executor::scheduleEvaluation(ProgramPtr program, std::vector<ColumnView> &&arguments,
+	const ResultView &result, size_t n, std::shared_ptr<std::promise<void>> promise)
+{
+	if (arguments.size() < program->getArgumentNumber()) {
+		release();
+		promise->set_exception(std::make_exception_ptr(
+			std::invalid_argument("missing argument columns")));
+		return;
+	}
+	auto failure = std::make_shared<Failure>();
+	auto columns = std::make_shared<std::vector<ColumnView>>(move(arguments));
+	auto job = std::make_shared<Job>();
+	job->chunks = n > 0 ? (n + CHUNK_ROWS - 1) / CHUNK_ROWS : 1;
+	job->run = [program, columns, result, n, failure](Program::Context &context, size_t chunk) {
+		size_t first = chunk * CHUNK_ROWS;
+		size_t end = n - first < CHUNK_ROWS ? n : first + CHUNK_ROWS;
+		try {
+			program->runRange(context, columns->data(), result, first, end);
+		} catch (...) {
+			failure->set(std::current_exception());
+		}
+	};
+	job->finish = [this, promise, failure]() {
+		release();
+		if (failure->error)
+			promise->set_exception(failure->error);
+		else
+			promise->set_value();
+	};
+	schedule(move(job));
+}
+
+std::future<void> Executor::evaluate(ProgramPtr program, std::vector<ColumnView> arguments,
+	const ResultView &result, size_t n)
+{
+	admit();
+	auto promise = std::make_shared<std::promise<void>>();
+	std::future<void> future = promise->get_future();
+	scheduleEvaluation(move(program), move(arguments), result, n, move(promise));
+	return future;
+}
+
+std::future<void> Executor::evaluate(const std::string &src, int optimize,
+	std::vector<ColumnView> arguments, const ResultView &result, size_t n)
+{
+	admit();
+	auto promise = std::make_shared<std::promise<void>>();
+	std::future<void> future = promise->get_future();
+
+	// the evaluation is scheduled by the compile job and counts as the same job
+	auto columns = std::make_shared<std::vector<ColumnView>>(move(arguments));
+	auto failure = std::make_shared<Failure>();
+	auto compiled = std::make_shared<ProgramPtr>();
+	auto job = std::make_shared<Job>();
+	job->run = [src, optimize, compiled, failure](Program::Context &, size_t) {
+		try {
+			*compiled = std::make_shared<const Program>(src.c_str(), optimize);
+		} catch (...) {
+			failure->set(std::current_exception());
+		}
+	};
+	job->finish = [this, compiled, failure, columns, result, n, promise]() {
+		if (failure->error) {
+			release();
+			promise->set_exception(failure->error);
+		} else {
+			scheduleEvaluation(*compiled, move(*columns), result, n, promise);
+		}
+	};
+	schedule(move(job));
+	return future;
+}
+
+void Executor::scheduleReduction(ProgramPtr program, Reduction reduction,
+	std::vector<ColumnView> &&arguments, size_t n, std::shared_ptr<std::promise<double>> promise)
+{
+	if (arguments.size() < program->getArgumentNumber()) {
+		release();
+		promise->set_exception(std::make_exception_ptr(
+			std::invalid_argument("missing argument columns")));
+		return;
+	}
+
+	// the chunks of reduce(), so the partials are the same
+	auto failure = std::make_shared<Failure>();
+	auto columns = std::make_shared<std::vector<ColumnView>>(move(arguments));
+	auto job = std::make_shared<Job>();
+	job->chunks = n > 0 ? (n + REDUCTION_CHUNK_ROWS - 1) / REDUCTION_CHUNK_ROWS : 1;
+	auto partials = std::make_shared<std::vector<ReductionPartial>>(job->chunks);
+	job->run = [program, columns, reduction, n, partials, failure](Program::Context &context,
+		size_t chunk)
+	{
+		size_t first = chunk * REDUCTION_CHUNK_ROWS;
+		size_t end = n - first < REDUCTION_CHUNK_ROWS ? n : first + REDUCTION_CHUNK_ROWS;
+		try {
+			reduceChunk(*program, context, reduction, columns->data(), first, end,
+				(*partials)[chunk]);
+		} catch (...) {
+			failure->set(std::current_exception());
+		}
+	};
+	job->finish = [this, promise, partials, failure, reduction, n]() {
+		release();
+		if (failure->error)
+			promise->set_exception(failure->error);
+		else
+			promise->set_value(combinePartials(*partials, reduction, n));
+	};
+	schedule(move(job));
+}
+
+std::future<double> Executor::reduce(ProgramPtr program, Reduction reduction,
+	std::vector<ColumnView> arguments, size_t n)
+{
+	admit();
+	auto promise = std::make_shared<std::promise<double>>();
+	std::future<double> future = promise->get_future();
+	scheduleReduction(move(program), reduction, move(arguments), n, move(promise));
+	return future;
+}
+
+std::future<double> Executor::reduce(const std::string &src, int optimize, Reduction reduction,
+	std::vector<ColumnView> arguments, size_t n)
+{
+	admit();
+	auto promise = std::make_shared<std::promise<double>>();
+	std::future<double> future = promise->get_future();
+
+	// the reduction is scheduled by the compile job and counts as the same job
+	auto columns = std::make_shared<std::vector<ColumnView>>(move(arguments));
+	auto failure = std::make_shared<Failure>();
+	auto compiled = std::make_shared<ProgramPtr>();
+	auto job = std::make_shared<Job>();
+	job->run = [src, optimize, compiled, failure](Program::Context &, size_t) {
+		try {
+			*compiled = std::make_shared<const Program>(src.c_str(), optimize);
+		} catch (...) {
+			failure->set(std::current_exception());
+		}
+	};
+	job->finish = [this, compiled, failure, columns, reduction, n, promise]() {
+		if (failure->error) {
+			release();
+			promise->set_exception(failure->error);
+		} else {
+			scheduleReduction(*compiled, reduction, move(*columns), n, promise);
+		}
+	};
+	schedule(move(job));
+	return future;
+}
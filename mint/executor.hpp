@@ -0,0 +1,105 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef EXECUTOR_HPP_
+#define EXECUTOR_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+#include "reductions.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Compiles and evaluates programs asynchronously on a pool of worker threads.  Every call
+/// returns a future right away and errors, e.g. parsing errors, are reported through it.
+///
+/// Evaluations are split into chunks of CHUNK_BLOCKS blocks, reductions into the chunks of
+/// reduce(), and the workers take chunks from the
+/// queued jobs in turns, so a short job does not wait until a long one submitted before it is
+/// done.  At most max_jobs jobs are in flight; a call that would exceed this blocks until a job
+/// completes, which keeps producers from running ahead of the workers.  A job counts as
+/// completed before its future becomes ready.
+class Executor {
+public:
+	typedef std::shared_ptr<const Program> ProgramPtr;
+
+	/// number of blocks evaluated by a worker before it moves on to the next job
+	static const size_t CHUNK_BLOCKS = 16;
+
+	explicit Executor(unsigned threads = std::thread::hardware_concurrency(),
+		size_t max_jobs = 64);
+
+	/// Completes all submitted jobs, then stops the workers.
+	~Executor();
+
+	Executor(const Executor &) = delete;
+	Executor &operator = (const Executor &) = delete;
+
+	std::future<ProgramPtr> compile(const std::string &src,
+		int optimize = Program::OPTIMIZE_STRICT);
+
+	/// Evaluates n rows, like Program::run.  The columns and the result must stay valid until
+	/// the future is ready.
+	std::future<void> evaluate(ProgramPtr program, std::vector<ColumnView> arguments,
+		const ResultView &result, size_t n);
+
+	/// Compiles src and then evaluates it, as one job.  Other jobs are evaluated while it is
+	/// compiled.
+	std::future<void> evaluate(const std::string &src, int optimize,
+		std::vector<ColumnView> arguments, const ResultView &result, size_t n);
+
+	/// Evaluates and reduces n rows.  The job is split into the chunks of reduce(), of
+	/// REDUCTION_CHUNK_ROWS rows, which are combined in order, so the result is the same as the
+	/// one of reduce() bit for bit.
+	std::future<double> reduce(ProgramPtr program, Reduction reduction,
+		std::vector<ColumnView> arguments, size_t n);
+
+	/// Compiles src and then reduces it, as one job.
+	std::future<double> reduce(const std::string &src, int optimize, Reduction reduction,
+		std::vector<ColumnView> arguments, size_t n);
+
+	unsigned getThreadNumber() const { return unsigned(workers.size()); }
+
+	/// number of jobs submitted that are not completed yet
+	size_t getJobsInFlight() const;
+
+private:
+	struct Job {
+		size_t chunks = 1;
+		size_t next_chunk = 0; // guarded by mutex
+		std::atomic<size_t> remaining;
+		std::function<void(Program::Context &, size_t)> run;
+		std::function<void()> finish; // called once after the last chunk was run
+	};
+
+	void work();
+	void admit();
+	void release();
+	void schedule(std::shared_ptr<Job> job);
+	void scheduleEvaluation(ProgramPtr program, std::vector<ColumnView> &&arguments,
+		const ResultView &result, size_t n, std::shared_ptr<std::promise<void>> promise);
+	void scheduleReduction(ProgramPtr program, Reduction reduction,
+		std::vector<ColumnView> &&arguments, size_t n,
+		std::shared_ptr<std::promise<double>> promise);
+
+	mutable std::mutex mutex;
+	std::condition_variable job_ready;
+	std::condition_variable job_done;
+	std::deque<std::shared_ptr<Job>> queue;
+	std::vector<std::thread> workers;
+	size_t max_jobs;
+	size_t jobs = 0;
+	bool stopping = false;
+};
+
+#endif // EXECUTOR_HPP_
@@ -0,0 +1,177 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "functions.hpp"
+
+#include "parser.hpp"
+#include "tokenizer.hpp"
+
+#include <cctype>
+#include <stdexcept>
+
+using std::move;
+
+const size_t FunctionRegistry::NONE;
+const size_t FunctionRegistry::MAX_NATIVE_PARAMETERS;
+const size_t FunctionRegistry::MAX_COPIED_NODES;
+
+// true for tokens that can name a parameter: identifiers and the named arguments like x
+static bool isName(const Token &tok) {
+	return tok.id == TOK_IDENT || (tok.id == TOK_ARG && std::isalpha(tok.start[0]));
+}
+
+void FunctionRegistry::define(const char *definition) {
+	Tokenizer tokenizer(definition);
+	Token name = tokenizer.getNextToken();
+	if (name.id != TOK_IDENT)
+		throw std::invalid_argument("expected a function name that is not built in");
+	Function function;
+	function.name = std::string(name.start, name.len);
+	if (find(function.name) != NONE)
+		throw std::invalid_argument("function is already defined");
+
+	// parameter list, which is left out for named constants
+	std::vector<std::string> parameters;
+	const char *next = name.start + name.len;
+	while (std::isspace(*next))
+		++next;
+	if (*next == '(') {
+		tokenizer.getNextToken();
+		for (;;) {
+			Token parameter = tokenizer.getNextToken();
+			if (!isName(parameter))
+				throw std::invalid_argument("expected a parameter name");
+			std::string parameter_name(parameter.start, parameter.len);
+			for (const std::string &other : parameters) {
+				if (other == parameter_name)
+					throw std::invalid_argument("duplicate parameter name");
+			}
+			parameters.push_back(parameter_name);
+			Token separator = tokenizer.getNextToken();
+			if (separator.id == TOK_RPAREN) {
+				next = separator.start + separator.len;
+				break;
+			}
+			if (separator.id != TOK_COMMA)
+				throw std::invalid_argument("expected ',' or ')' in the parameter list");
+		}
+	}
+
+	// a single '=' separates the body
+	while (std::isspace(*next))
+		++next;
+	if (next[0] != '=' || next[1] == '=')
+		throw std::invalid_argument("expected '=' before the function body");
+	Parser parser(next + 1, this, &parameters);
+	if (parser.parse())
+		throw std::invalid_argument(parser.getError());
+	if (parser.getAst().children.size() != 1)
+		throw std::invalid_argument("a function has a single result");
+
+	// positions in the body would point into the definition, not into the calling source
+	function.body = move(parser.getAst().children[0]);
+	std::vector<Ast *> stack;
+	stack.push_back(&function.body);
+	while (stack.size() > 0) {
+		Ast *ast = stack.back();
+		stack.pop_back();
+		ast->pos = -1;
+		ast->len = 0;
+		for (Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	function.parameters = parameters.size();
+	index[function.name] = functions.size();
+	functions.push_back(move(function));
+}
+
+void FunctionRegistry::defineNative(const char *name, size_t parameters,
+	NativeFunction::BlockFunction block, NativeFunction::ScalarFunction scalar)
+{
+	Tokenizer tokenizer(name);
+	Token token = tokenizer.getNextToken();
+	if (token.id != TOK_IDENT || token.start != name || name[token.len] != '\0')
+		throw std::invalid_argument("expected a function name that is not built in");
+	if (find(name) != NONE)
+		throw std::invalid_argument("function is already defined");
+	if (parameters == 0 || parameters > MAX_NATIVE_PARAMETERS)
+		throw std::invalid_argument("invalid number of parameters");
+	if (!block)
+		throw std::invalid_argument("missing block function");
+
+	Function function;
+	function.name = name;
+	function.parameters = parameters;
+	function.native.parameters = parameters;
+	function.native.block = move(block);
+	function.native.scalar = move(scalar);
+	index[function.name] = functions.size();
+	functions.push_back(move(function));
+}
+
+size_t FunctionRegistry::find(const std::string &name) const {
+	auto it = index.find(name);
+	return it != index.end() ? it->second : NONE;
+}
+
+static size_t countNodes(const Ast &ast) {
+	size_t count = 0;
+	std::vector<const Ast *> stack;
+	stack.push_back(&ast);
+	while (stack.size() > 0) {
+		const Ast *node = stack.back();
+		stack.pop_back();
+		++count;
+		for (const Ast &child : node->children)
+			stack.push_back(&child);
+	}
+	return count;
+}
+
+Ast FunctionRegistry::expand(size_t function, std::vector<Ast> &&arguments) const {
+	const Function &definition = functions[function];
+	if (isNative(function)) {
+		Ast call(OP_CALL);
+		call.i = long(function);
+		call.children = move(arguments);
+		return call;
+	}
+	Ast result = definition.body;
+
+	// every use of a parameter gets a copy of the argument, except the last one, which moves it
+	std::vector<size_t> uses(definition.parameters, 0);
+	std::vector<Ast *> stack;
+	stack.push_back(&result);
+	while (stack.size() > 0) {
+		Ast *ast = stack.back();
+		stack.pop_back();
+		if (ast->op == OP_ARG && ast->i < 0)
+			uses[size_t(-ast->i - 1)]++;
+		for (Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	size_t copied = 0;
+	for (size_t k = 0; k < definition.parameters; ++k) {
+		if (uses[k] > 1)
+			copied += (uses[k] - 1) * countNodes(arguments[k]);
+		if (copied > MAX_COPIED_NODES)
+			throw std::invalid_argument("function call expands to too many nodes");
+	}
+	stack.push_back(&result);
+	while (stack.size() > 0) {
+		Ast *ast = stack.back();
+		stack.pop_back();
+		if (ast->op == OP_ARG && ast->i < 0) {
+			size_t parameter = size_t(-ast->i - 1);
+			if (--uses[parameter] == 0)
+				*ast = move(arguments[parameter]);
+			else
+				*ast = arguments[parameter];
+			continue;
+		}
+		for (Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	return result;
+}
@@ -0,0 +1,88 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef FUNCTIONS_HPP_
+#define FUNCTIONS_HPP_
+
+#include "ast.hpp"
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// A function implemented in C++.  The block function gets one pointer per parameter, each to n
+/// values, and writes n results to result, which never overlaps the inputs.  It is called once
+/// per block of rows by the batch interpreter.  The optional scalar function gets the values of
+/// the parameters of a single row and is used by Program::run(const double *), which otherwise
+/// calls the block function with n = 1.  Both must be pure, as calls with equal arguments may be
+/// merged by the optimizer, and thread safe if programs calling them run concurrently.
+struct NativeFunction {
+	typedef std::function<void(const double *const *arguments, double *result, size_t n)>
+		BlockFunction;
+	typedef std::function<double(const double *arguments)> ScalarFunction;
+
+	size_t parameters = 0;
+	BlockFunction block;
+	ScalarFunction scalar;
+};
+
+/// Functions defined by expressions, which the parser inlines at every call.  The optimizer sees
+/// the inlined tree, so constants are folded and powers are rewritten across calls, and there is
+/// no call at run time.  Native functions are called through OP_CALL instead.
+class FunctionRegistry {
+public:
+	static const size_t NONE = size_t(-1);
+
+	/// maximum number of parameters of a native function
+	static const size_t MAX_NATIVE_PARAMETERS = 16;
+
+	/// Maximum number of nodes a call copies to use an argument several times.  Nested calls
+	/// of a function that uses a parameter twice double the tree at every level, so they fail
+	/// to parse before they exhaust the memory.
+	static const size_t MAX_COPIED_NODES = size_t(1) << 20;
+
+	FunctionRegistry() = default;
+
+	/// Defines a function, e.g. "gauss(x, m, s) = exp(-0.5*((x-m)/s)^2) / (sqrt(2*pi)*s)", or a
+	/// named constant without parameters, e.g. "kB = 1.380649e-23".  Inside the body, the
+	/// parameters hide the arguments of the same name, and functions defined before can be
+	/// called.  Throws std::invalid_argument if the definition can't be parsed, or if the name
+	/// is a built-in name or is already defined.
+	void define(const char *definition);
+
+	/// Defines a native function with a fixed number of parameters, see NativeFunction.  Throws
+	/// std::invalid_argument if the name is not an identifier, is a built-in name or is already
+	/// defined, or if the number of parameters is 0 or above MAX_NATIVE_PARAMETERS.
+	void defineNative(const char *name, size_t parameters, NativeFunction::BlockFunction block,
+		NativeFunction::ScalarFunction scalar = nullptr);
+
+	/// index of the function with the given name, or NONE
+	size_t find(const std::string &name) const;
+
+	size_t getFunctionNumber() const { return functions.size(); }
+	const std::string &getName(size_t function) const { return functions[function].name; }
+	size_t getParameterNumber(size_t function) const { return functions[function].parameters; }
+	bool isNative(size_t function) const { return functions[function].native.block != nullptr; }
+	const NativeFunction &getNative(size_t function) const { return functions[function].native; }
+
+	/// Returns the body of the function with the parameters replaced by the arguments.  For a
+	/// native function, this is an OP_CALL node with the function index and the arguments as
+	/// children.  Throws std::invalid_argument if more than MAX_COPIED_NODES nodes would be
+	/// copied.
+	Ast expand(size_t function, std::vector<Ast> &&arguments) const;
+
+private:
+	struct Function {
+		std::string name;
+		size_t parameters;
+		Ast body; // parameter k is an OP_ARG node with index -(k + 1)
+		NativeFunction native;
+	};
+
+	std::vector<Function> functions;
+	std::unordered_map<std::string, size_t> index;
+};
+
+#endif // FUNCTIONS_HPP_
@@ -0,0 +1,155 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "histogram.hpp"
+
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// number of blocks a thread takes at a time
+static const size_t CHUNK_BLOCKS = 64;
+
+Axis::Axis(size_t bins, double low, double high) :
+	bins(bins), low(low), high(high), scale(bins / (high - low))
+{
+	if (bins == 0 || !(low < high))
+		throw std::invalid_argument("invalid axis");
+}
+
+Axis::Axis(const std::vector<double> &edges) : edges(edges) {
+	if (edges.size() < 2)
+		throw std::invalid_argument("invalid axis");
+	for (size_t i = 1; i < edges.size(); ++i)
+		if (!(edges[i - 1] < edges[i]))
+			throw std::invalid_argument("axis edges must be increasing");
+	bins = edges.size() - 1;
+	low = edges.front();
+	high = edges.back();
+	scale = 0.0;
+}
+
+double Axis::getLowEdge(size_t bin) const {
+	if (bin == 0)
+		return -HUGE_VAL;
+	if (bin > bins)
+		return high;
+	if (!edges.empty())
+		return edges[bin - 1];
+	return low + (bin - 1) / scale;
+}
+
+size_t Axis::findBin(double value) const {
+	if (value < low)
+		return 0;
+	if (!(value < high))
+		return bins + 1;
+	if (!edges.empty())
+		return std::upper_bound(edges.begin(), edges.end(), value) - edges.begin();
+	// rounding may put values just below high into a bin that does not exist
+	size_t bin = size_t((value - low) * scale);
+	return (bin < bins ? bin : bins - 1) + 1;
+}
+
+Histogram1D::Histogram1D(const Axis &axis) :
+	axis(axis), contents(axis.getBinNumber() + 2, 0.0) {}
+
+void Histogram1D::fill(double value, double weight) {
+	contents[axis.findBin(value)] += weight;
+	++entries;
+}
+
+void Histogram1D::add(const Histogram1D &other) {
+	if (other.contents.size() != contents.size())
+		throw std::invalid_argument("histograms have different binning");
+	for (size_t i = 0; i < contents.size(); ++i)
+		contents[i] += other.contents[i];
+	entries += other.entries;
+}
+
+Histogram2D::Histogram2D(const Axis &x_axis, const Axis &y_axis) :
+	x_axis(x_axis), y_axis(y_axis),
+	contents((x_axis.getBinNumber() + 2) * (y_axis.getBinNumber() + 2), 0.0) {}
+
+void Histogram2D::fill(double x, double y, double weight) {
+	size_t bin = y_axis.findBin(y) * (x_axis.getBinNumber() + 2) + x_axis.findBin(x);
+	contents[bin] += weight;
+	++entries;
+}
+
+void Histogram2D::add(const Histogram2D &other) {
+	if (other.x_axis.getBinNumber() != x_axis.getBinNumber() ||
+		other.contents.size() != contents.size())
+		throw std::invalid_argument("histograms have different binning");
+	for (size_t i = 0; i < contents.size(); ++i)
+		contents[i] += other.contents[i];
+	entries += other.entries;
+}
+
+// Fills n rows into histogram on the given number of threads.  fillBlock(local, contexts, first,
+// count) fills one block into a histogram owned by the calling thread, using contexts of that
+// thread, one per program.  empty is a histogram with the same binning and no entries.
+template <typename H, typename F>
+static void fillBlocks(H &histogram, const H &empty, size_t programs, size_t n, unsigned threads,
+	F fillBlock)
+{
+	const size_t chunk_rows = CHUNK_BLOCKS * Program::BLOCK_SIZE;
+	const size_t chunks = (n + chunk_rows - 1) / chunk_rows;
+	if (threads > chunks)
+		threads = unsigned(chunks);
+	if (threads < 1)
+		threads = 1;
+
+	// the calling thread fills histogram directly, the others fill histograms of their own
+	std::vector<H> locals(threads - 1, empty);
+	std::vector<std::vector<Program::Context>> contexts(threads,
+		std::vector<Program::Context>(programs));
+	runChunks(chunks, threads, [&](unsigned w, size_t chunk) {
+		H &local = w == 0 ? histogram : locals[w - 1];
+		size_t end = (chunk + 1) * chunk_rows < n ? (chunk + 1) * chunk_rows : n;
+		for (size_t first = chunk * chunk_rows; first < end; first += Program::BLOCK_SIZE) {
+			size_t count = end - first < Program::BLOCK_SIZE ? end - first : Program::BLOCK_SIZE;
+			fillBlock(local, contexts[w].data(), first, count);
+		}
+	});
+	for (const H &local : locals)
+		histogram.add(local);
+}
+
+void fillHistogram(Histogram1D &histogram, const Program &x, const ColumnView *arguments,
+	size_t n, const Program *weight, unsigned threads)
+{
+	fillBlocks(histogram, Histogram1D(histogram.getAxis()), 2, n, threads,
+		[&](Histogram1D &local, Program::Context *contexts, size_t first, size_t count) {
+			const double *values = x.runBlock(contexts[0], arguments, first, nullptr, count);
+			if (weight) {
+				const double *weights = weight->runBlock(contexts[1], arguments, first, nullptr, count);
+				for (size_t j = 0; j < count; ++j)
+					local.fill(values[j], weights[j]);
+			} else {
+				for (size_t j = 0; j < count; ++j)
+					local.fill(values[j]);
+			}
+		});
+}
+
+void fillHistogram(Histogram2D &histogram, const Program &x, const Program &y,
+	const ColumnView *arguments, size_t n, const Program *weight, unsigned threads)
+{
+	fillBlocks(histogram, Histogram2D(histogram.getXAxis(), histogram.getYAxis()), 3, n, threads,
+		[&](Histogram2D &local, Program::Context *contexts, size_t first, size_t count) {
+			const double *x_values = x.runBlock(contexts[0], arguments, first, nullptr, count);
+			const double *y_values = y.runBlock(contexts[1], arguments, first, nullptr, count);
+			if (weight) {
+				const double *weights = weight->runBlock(contexts[2], arguments, first, nullptr, count);
+				for (size_t j = 0; j < count; ++j)
+					local.fill(x_values[j], y_values[j], weights[j]);
+			} else {
+				for (size_t j = 0; j < count; ++j)
+					local.fill(x_values[j], y_values[j]);
+			}
+		});
+}
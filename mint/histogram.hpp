@@ -0,0 +1,87 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef HISTOGRAM_HPP_
+#define HISTOGRAM_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+#include <vector>
+
+/// Binning along one axis.  Bins are numbered like in ROOT: bin 0 is the underflow, bins 1 to
+/// getBinNumber() are the regular bins and bin getBinNumber() + 1 is the overflow, which also
+/// receives NaN.  Every bin includes its low edge and excludes its high edge.
+class Axis {
+public:
+	/// bins of equal width between low and high
+	Axis(size_t bins, double low, double high);
+
+	/// bins of variable width, edges must be strictly increasing
+	Axis(const std::vector<double> &edges);
+
+	size_t getBinNumber() const { return bins; }
+	double getLowEdge(size_t bin) const;
+	size_t findBin(double value) const;
+
+private:
+	size_t bins;
+	double low;
+	double high;
+	double scale;
+	std::vector<double> edges; // empty for bins of equal width
+};
+
+class Histogram1D {
+public:
+	Histogram1D(const Axis &axis);
+
+	const Axis &getAxis() const { return axis; }
+	double getBinContent(size_t bin) const { return contents[bin]; }
+	size_t getEntries() const { return entries; }
+
+	void fill(double value, double weight = 1.0);
+	void add(const Histogram1D &other);
+
+private:
+	Axis axis;
+	std::vector<double> contents;
+	size_t entries = 0;
+};
+
+class Histogram2D {
+public:
+	Histogram2D(const Axis &x_axis, const Axis &y_axis);
+
+	const Axis &getXAxis() const { return x_axis; }
+	const Axis &getYAxis() const { return y_axis; }
+	double getBinContent(size_t x_bin, size_t y_bin) const {
+		return contents[y_bin * (x_axis.getBinNumber() + 2) + x_bin];
+	}
+	size_t getEntries() const { return entries; }
+
+	void fill(double x, double y, double weight = 1.0);
+	void add(const Histogram2D &other);
+
+private:
+	Axis x_axis;
+	Axis y_axis;
+	std::vector<double> contents;
+	size_t entries = 0;
+};
+
+/// Evaluates x over n rows and fills the results into the histogram, weighted with the results
+/// of weight if given.  The results are binned block by block and never stored.  With several
+/// threads, each thread fills a histogram of its own and these are added at the end.  An
+/// exception thrown by a native function stops all threads and is rethrown, with the histogram
+/// partly filled.
+void fillHistogram(Histogram1D &histogram, const Program &x, const ColumnView *arguments,
+	size_t n, const Program *weight = nullptr, unsigned threads = 1);
+
+/// Like the one dimensional version, with x and y evaluated over the same rows.
+void fillHistogram(Histogram2D &histogram, const Program &x, const Program &y,
+	const ColumnView *arguments, size_t n, const Program *weight = nullptr,
+	unsigned threads = 1);
+
+#endif // HISTOGRAM_HPP_
@@ -25,6 +25,16 @@ template <typename T> static inline T sqrt_impl  (T x) { return std::sqrt(x); }
 template <typename T> static inline T sin_impl   (T x) { return std::sin(x); }
 template <typename T> static inline T cos_impl   (T x) { return std::cos(x); }
 template <typename T> static inline T tan_impl   (T x) { return std::tan(x); }
+
+// sine and cosine of the same value, in a single call where the C library has one
+static inline void sincos_impl(double x, double *sin, double *cos) {
+#ifdef __GLIBC__
+	::sincos(x, sin, cos);
+#else
+	*sin = std::sin(x);
+	*cos = std::cos(x);
+#endif
+}
 template <typename T> static inline T asin_impl  (T x) { return std::asin(x); }
 template <typename T> static inline T acos_impl  (T x) { return std::acos(x); }
 template <typename T> static inline T atan_impl  (T x) { return std::atan(x); }
@@ -38,17 +48,36 @@ template <typename T> static inline T log_impl   (T x) { return std::log(x); }
 template <typename T> static inline T exp_impl   (T x) { return std::exp(x); }
 template <typename T> static inline T erf_impl   (T x) { return std::erf(x); }
 template <typename T> static inline T erfc_impl  (T x) { return std::erfc(x); }
+template <typename T> static inline T log1p_impl (T x) { return std::log1p(x); }
+template <typename T> static inline T expm1_impl (T x) { return std::expm1(x); }
+template <typename T> static inline T cbrt_impl  (T x) { return std::cbrt(x); }
 template <typename T> static inline T abs_impl   (T x) { return std::abs(x); }
 template <typename T> static inline T floor_impl (T x) { return std::floor(x); }
 template <typename T> static inline T ceil_impl  (T x) { return std::ceil(x); }
 template <typename T> static inline T round_impl (T x) { return std::round(x); }
 template <typename T> static inline T trunc_impl (T x) { return std::trunc(x); }
+template <typename T> static inline T not_impl   (T x) { return T(x == T(0)); }
 
 template <typename T> static inline T add_impl (T x, T y) { return x + y; }
 template <typename T> static inline T sub_impl (T x, T y) { return x - y; }
 template <typename T> static inline T mul_impl (T x, T y) { return x * y; }
 template <typename T> static inline T div_impl (T x, T y) { return x / y; }
 template <typename T> static inline T pow_impl (T x, T y) { return std::pow(x, y); }
+template <typename T> static inline T hypot_impl(T x, T y) { return std::hypot(x, y); }
+template <typename T> static inline T rsub_impl(T x, T y) { return y - x; }
+template <typename T> static inline T rdiv_impl(T x, T y) { return y / x; }
+template <typename T> static inline T rpow_impl(T x, T y) { return std::pow(y, x); }
+template <typename T> static inline T lt_impl  (T x, T y) { return T(x < y); }
+template <typename T> static inline T le_impl  (T x, T y) { return T(x <= y); }
+template <typename T> static inline T gt_impl  (T x, T y) { return T(x > y); }
+template <typename T> static inline T ge_impl  (T x, T y) { return T(x >= y); }
+template <typename T> static inline T eq_impl  (T x, T y) { return T(x == y); }
+template <typename T> static inline T ne_impl  (T x, T y) { return T(x != y); }
+template <typename T> static inline T and_impl (T x, T y) { return T((x != T(0)) & (y != T(0))); }
+template <typename T> static inline T or_impl  (T x, T y) { return T((x != T(0)) | (y != T(0))); }
+
+// both alternatives are already evaluated, so this compiles to a blend instead of a branch
+template <typename T> static inline T select_impl(T c, T x, T y) { return c != T(0) ? x : y; }
 
 template <typename T>
 static inline T op0_impl(Op op) {
@@ -83,11 +112,18 @@ static inline T op1_impl(Op op, T x) {
 	case OP_LOG:   return log_impl(x);
 	case OP_ERF:   return erf_impl(x);
 	case OP_ERFC:  return erfc_impl(x);
+	case OP_LOG1P: return log1p_impl(x);
+	case OP_EXPM1: return expm1_impl(x);
+	case OP_CBRT:  return cbrt_impl(x);
 	case OP_ABS:   return abs_impl(x);
 	case OP_FLOOR: return floor_impl(x);
 	case OP_CEIL:  return ceil_impl(x);
 	case OP_ROUND: return round_impl(x);
 	case OP_TRUNC: return trunc_impl(x);
+	case OP_NOT:   return not_impl(x);
+	// the first result of operations with several results
+	case OP_SINCOS: return sin_impl(x);
+	case OP_COSSIN: return cos_impl(x);
 	default:       throw std::invalid_argument("Wrong number of arguments for operator");
 	}
 }
@@ -95,11 +131,31 @@ static inline T op1_impl(Op op, T x) {
 template <typename T>
 static inline T op2_impl(Op op, T x, T y) {
 	switch (op) {
-	case OP_ADD: return add_impl(x, y);
-	case OP_SUB: return sub_impl(x, y);
-	case OP_MUL: return mul_impl(x, y);
-	case OP_DIV: return div_impl(x, y);
-	case OP_POW: return pow_impl(x, y);
-	default:     throw std::invalid_argument("Wrong number of arguments for operator");
+	case OP_ADD:  return add_impl(x, y);
+	case OP_SUB:  return sub_impl(x, y);
+	case OP_MUL:  return mul_impl(x, y);
+	case OP_DIV:  return div_impl(x, y);
+	case OP_POW:  return pow_impl(x, y);
+	case OP_HYPOT: return hypot_impl(x, y);
+	case OP_RSUB: return rsub_impl(x, y);
+	case OP_RDIV: return rdiv_impl(x, y);
+	case OP_RPOW: return rpow_impl(x, y);
+	case OP_LT:   return lt_impl(x, y);
+	case OP_LE:   return le_impl(x, y);
+	case OP_GT:   return gt_impl(x, y);
+	case OP_GE:   return ge_impl(x, y);
+	case OP_EQ:   return eq_impl(x, y);
+	case OP_NE:   return ne_impl(x, y);
+	case OP_AND:  return and_impl(x, y);
+	case OP_OR:   return or_impl(x, y);
+	default:      throw std::invalid_argument("Wrong number of arguments for operator");
+	}
+}
+
+template <typename T>
+static inline T op3_impl(Op op, T x, T y, T z) {
+	switch (op) {
+	case OP_SELECT: return select_impl(x, y, z);
+	default:        throw std::invalid_argument("Wrong number of arguments for operator");
 	}
 }
@@ -0,0 +1,131 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "incremental.hpp"
+
+#include "passes.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using std::move;
+
+static bool isSum(int op) {
+	return op == OP_ADD || op == OP_SUB || op == OP_RSUB;
+}
+
+static bool isProduct(int op) {
+	return op == OP_MUL || op == OP_DIV || op == OP_RDIV;
+}
+
+// Splits the optimized tree at its first node with several operands.  If that node is a sum or
+// a product, the terms or factors below it are split off as well, so each of them reads only its
+// own arguments.  The operands become the parts, and in the combination, part i is replaced by
+// argument i.  The parts are separate programs, so work is shared within each part only, by the
+// sharing passes run after the split.
+IncrementalProgram::Split IncrementalProgram::split(const char *src, int optimize) {
+	Split split;
+	split.combination = Program::parse(src);
+	if (split.combination.children.size() != 1)
+		throw std::invalid_argument("incremental programs have a single output");
+	PassManager::forLevel(optimize, PassManager::REWRITE_PASSES).run(&split.combination);
+
+	Ast *node = &split.combination;
+	while (node->children.size() == 1 && node->children[0].children.size() >= 1)
+		node = &node->children[0];
+
+	// the operands are visited from left to right, with an explicit stack for long sums
+	bool sum = isSum(node->op);
+	bool product = isProduct(node->op);
+	std::vector<Ast *> pending;
+	for (size_t i = node->children.size(); i-- > 0;)
+		pending.push_back(&node->children[i]);
+	while (!pending.empty()) {
+		Ast *operand = pending.back();
+		pending.pop_back();
+		if ((sum && isSum(operand->op)) || (product && isProduct(operand->op))) {
+			for (size_t i = operand->children.size(); i-- > 0;)
+				pending.push_back(&operand->children[i]);
+			continue;
+		}
+		Ast part(OP_HLT);
+		part.children.emplace_back(move(*operand));
+		split.parts.emplace_back(move(part));
+		Ast argument(OP_ARG);
+		argument.i = long(split.parts.size() - 1);
+		*operand = move(argument);
+	}
+
+	PassManager sharing = PassManager::forLevel(optimize, PassManager::SHARING_PASSES);
+	for (Ast &part : split.parts)
+		sharing.run(&part);
+	sharing.run(&split.combination);
+	return split;
+}
+
+// sorted indices of the arguments a part reads, kept beside the tree instead of in its nodes
+static std::vector<size_t> findArguments(const Ast &tree) {
+	std::vector<size_t> arguments;
+	std::vector<const Ast *> stack;
+	stack.push_back(&tree);
+	while (!stack.empty()) {
+		const Ast *node = stack.back();
+		stack.pop_back();
+		if (node->op == OP_ARG)
+			arguments.push_back(size_t(node->i));
+		for (const Ast &child : node->children)
+			stack.push_back(&child);
+	}
+	std::sort(arguments.begin(), arguments.end());
+	arguments.erase(std::unique(arguments.begin(), arguments.end()), arguments.end());
+	return arguments;
+}
+
+IncrementalProgram::IncrementalProgram(const char *src, int optimize) :
+	IncrementalProgram(split(src, optimize)) {}
+
+IncrementalProgram::IncrementalProgram(Split &&prepared) :
+	combination(prepared.combination)
+{
+	parts.reserve(prepared.parts.size());
+	for (Ast &tree : prepared.parts) {
+		std::vector<size_t> arguments = findArguments(tree);
+		if (!arguments.empty() && argument_number < arguments.back() + 1)
+			argument_number = arguments.back() + 1;
+		parts.push_back({ Program(tree), move(arguments), {} });
+	}
+}
+
+void IncrementalProgram::evaluate(Part &part, const ColumnView *arguments) {
+	part.values.resize(n);
+	part.program.run(arguments, ResultView(part.values.data()), n);
+}
+
+void IncrementalProgram::combine(const ResultView &result) {
+	std::vector<ColumnView> views;
+	views.reserve(parts.size());
+	for (Part &part : parts)
+		views.emplace_back(part.values.data());
+	combination.run(views.data(), result, n);
+}
+
+void IncrementalProgram::run(const ColumnView *arguments, const ResultView &result, size_t n) {
+	this->n = n;
+	for (Part &part : parts)
+		evaluate(part, arguments);
+	combine(result);
+	has_run = true;
+}
+
+void IncrementalProgram::update(size_t argument, const ColumnView *arguments,
+	const ResultView &result)
+{
+	if (!has_run)
+		throw std::invalid_argument("update before run");
+	for (Part &part : parts) {
+		if (std::binary_search(part.arguments.begin(), part.arguments.end(), argument))
+			evaluate(part, arguments);
+	}
+	combine(result);
+}
@@ -0,0 +1,63 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef INCREMENTAL_HPP_
+#define INCREMENTAL_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+#include <vector>
+
+/// Evaluates an expression repeatedly over the same rows while single argument columns change.
+/// The expression is split at its first node with several operands, below any unary operators
+/// at the top, and if that is a sum or a product, into all of its terms or factors.  Each part
+/// is compiled into a program of its own and its values are kept for every row, so after a
+/// column changed, only the parts that read it are evaluated again.
+class IncrementalProgram {
+public:
+	IncrementalProgram(const char *src, int optimize = Program::OPTIMIZE_STRICT);
+
+	/// number of arguments this expression reads, i.e. the highest argument index plus one
+	size_t getArgumentNumber() const { return argument_number; }
+
+	/// number of separately cached subtrees
+	size_t getPartNumber() const { return parts.size(); }
+
+	/// the program that computes subtree i
+	const Program &getPart(size_t i) const { return parts[i].program; }
+
+	/// Evaluates all n rows and keeps the values of the subtrees.
+	void run(const ColumnView *arguments, const ResultView &result, size_t n);
+
+	/// Evaluates the rows of the last run() again after the column of the given argument
+	/// changed.  Only the subtrees that read this argument are evaluated again.
+	void update(size_t argument, const ColumnView *arguments, const ResultView &result);
+
+private:
+	struct Split {
+		Ast combination;
+		std::vector<Ast> parts;
+	};
+
+	static Split split(const char *src, int optimize);
+	IncrementalProgram(Split &&prepared);
+
+	struct Part {
+		Program program;
+		std::vector<size_t> arguments;
+		std::vector<double> values;
+	};
+
+	void evaluate(Part &part, const ColumnView *arguments);
+	void combine(const ResultView &result);
+
+	std::vector<Part> parts;
+	Program combination; // reads the values of part i as argument i
+	size_t argument_number = 0;
+	size_t n = 0;
+	bool has_run = false;
+};
+
+#endif // INCREMENTAL_HPP_
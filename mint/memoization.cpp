@@ -0,0 +1,219 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "memoization.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using std::memory_order_acquire;
+using std::memory_order_relaxed;
+using std::memory_order_release;
+
+const size_t MemoizedProgram::PROBES;
+
+static inline uint64_t toBits(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static inline double fromBits(uint64_t bits) {
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+MemoizedProgram::MemoizedProgram(Program program, size_t capacity) :
+	program(std::move(program)), hits(0), misses(0)
+{
+	if (capacity == 0)
+		throw std::invalid_argument("the cache needs at least one entry");
+	size_t entries = 1;
+	while (entries < capacity)
+		entries *= 2;
+	mask = entries - 1;
+	key_size = this->program.getUsedArguments().size();
+	table.reset(new std::atomic<uint64_t>[entries * (2 + key_size)]);
+	clear();
+}
+
+void MemoizedProgram::resetStatistics() {
+	hits.store(0, memory_order_relaxed);
+	misses.store(0, memory_order_relaxed);
+}
+
+void MemoizedProgram::clear() {
+	for (size_t i = 0; i < (mask + 1) * (2 + key_size); ++i)
+		table[i].store(0, memory_order_relaxed);
+}
+
+uint64_t MemoizedProgram::hash(const uint64_t *key) const {
+	// the finalizer of MurmurHash3 over the words combined with a multiplicative hash
+	uint64_t h = 0x9e3779b97f4a7c15ull;
+	for (size_t k = 0; k < key_size; ++k)
+		h = (h ^ key[k]) * 0x9e3779b97f4a7c15ull;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+// Reads an entry like a sequence lock: the entry is only used if its sequence number was even
+// and did not change while the key and the result were read.
+bool MemoizedProgram::lookup(const uint64_t *key, uint64_t hash, double *value) const {
+	for (size_t probe = 0; probe < PROBES; ++probe) {
+		std::atomic<uint64_t> *entry = table.get() + ((hash + probe) & mask) * (2 + key_size);
+		uint64_t sequence = entry[0].load(memory_order_acquire);
+		if (sequence == 0)
+			return false; // keys are inserted into the first empty entry
+		if (sequence & 1)
+			continue;
+		bool equal = true;
+		for (size_t k = 0; k < key_size && equal; ++k)
+			equal = entry[2 + k].load(memory_order_relaxed) == key[k];
+		uint64_t bits = entry[1].load(memory_order_relaxed);
+		std::atomic_thread_fence(memory_order_acquire);
+		if (equal && entry[0].load(memory_order_relaxed) == sequence) {
+			*value = fromBits(bits);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Writes into the first empty entry among the probed ones, or else into one chosen by the hash.
+// The writer that makes the sequence number odd owns the entry, others give up.
+void MemoizedProgram::insert(const uint64_t *key, uint64_t hash, double value) const {
+	std::atomic<uint64_t> *entry = nullptr;
+	for (size_t probe = 0; probe < PROBES && !entry; ++probe) {
+		std::atomic<uint64_t> *candidate = table.get() + ((hash + probe) & mask) * (2 + key_size);
+		if (candidate[0].load(memory_order_relaxed) == 0)
+			entry = candidate;
+	}
+	if (!entry)
+		entry = table.get() + ((hash + (hash >> 62)) & mask) * (2 + key_size);
+
+	uint64_t sequence = entry[0].load(memory_order_relaxed);
+	if ((sequence & 1) || !entry[0].compare_exchange_strong(sequence, sequence + 1,
+		memory_order_relaxed))
+	{
+		return;
+	}
+	std::atomic_thread_fence(memory_order_release);
+	for (size_t k = 0; k < key_size; ++k)
+		entry[2 + k].store(key[k], memory_order_relaxed);
+	entry[1].store(toBits(value), memory_order_relaxed);
+	entry[0].store(sequence + 2, memory_order_release);
+}
+
+double MemoizedProgram::run(const double *arguments) {
+	const std::vector<size_t> &used = program.getUsedArguments();
+	// keys of up to SHORT_KEY words are not allocated
+	const size_t SHORT_KEY = 64;
+	uint64_t key[SHORT_KEY];
+	std::vector<uint64_t> long_key;
+	uint64_t *words = key;
+	if (key_size > SHORT_KEY) {
+		long_key.resize(key_size);
+		words = long_key.data();
+	}
+	for (size_t k = 0; k < key_size; ++k)
+		words[k] = toBits(arguments[used[k]]);
+	uint64_t h = hash(words);
+	double value;
+	if (lookup(words, h, &value)) {
+		hits.fetch_add(1, memory_order_relaxed);
+		return value;
+	}
+	misses.fetch_add(1, memory_order_relaxed);
+	value = program.run(arguments);
+	insert(words, h, value);
+	return value;
+}
+
+void MemoizedProgram::run(const ColumnView *arguments, const ResultView &result, size_t n) {
+	runRange(context, arguments, result, 0, n);
+}
+
+void MemoizedProgram::runRange(Program::Context &context, const ColumnView *arguments,
+	const ResultView &result, size_t first, size_t end) const
+{
+	if (result.type != TYPE_FLOAT64 && result.type != TYPE_FLOAT32)
+		throw std::invalid_argument("unsupported result type");
+	const std::vector<size_t> &used = program.getUsedArguments();
+	const size_t block_size = Program::BLOCK_SIZE;
+	std::vector<uint64_t> keys(block_size * key_size);
+	uint64_t hashes[block_size];
+	double buffer[block_size];
+	double values[block_size];
+	size_t missed[block_size]; // row within the block
+	size_t rows[block_size];
+
+	// Rows that miss the cache but repeat the key of an earlier miss in the same block reuse
+	// its result.  pending is a small open addressing table of the misses of the block.
+	const size_t NONE = size_t(-1);
+	size_t pending[2 * block_size];
+	size_t repeated[block_size]; // row within the block
+	size_t repeated_miss[block_size]; // index into missed
+
+	for (; first < end; first += block_size) {
+		size_t count = end - first < block_size ? end - first : block_size;
+
+		// the keys of the block, one row after the other, in the same conversion to double as
+		// the interpreter's
+		for (size_t k = 0; k < key_size; ++k) {
+			const double *column = loadColumn(arguments[used[k]], first, nullptr, count, buffer);
+			for (size_t j = 0; j < count; ++j)
+				keys[j * key_size + k] = toBits(column[j]);
+		}
+
+		size_t misses_in_block = 0;
+		size_t repeats = 0;
+		std::fill(pending, pending + 2 * block_size, NONE);
+		for (size_t j = 0; j < count; ++j) {
+			const uint64_t *key = keys.data() + j * key_size;
+			hashes[j] = hash(key);
+			if (lookup(key, hashes[j], &values[j]))
+				continue;
+			size_t position = hashes[j] & (2 * block_size - 1);
+			for (; pending[position] != NONE; position = (position + 1) & (2 * block_size - 1)) {
+				const uint64_t *other = keys.data() + missed[pending[position]] * key_size;
+				if (std::equal(key, key + key_size, other))
+					break;
+			}
+			if (pending[position] != NONE) {
+				repeated[repeats] = j;
+				repeated_miss[repeats] = pending[position];
+				++repeats;
+				continue;
+			}
+			pending[position] = misses_in_block;
+			missed[misses_in_block] = j;
+			rows[misses_in_block] = first + j;
+			++misses_in_block;
+		}
+
+		// only the rows that missed are evaluated
+		if (misses_in_block > 0) {
+			const double *computed = program.runBlock(context, arguments, 0, rows,
+				misses_in_block);
+			for (size_t m = 0; m < misses_in_block; ++m) {
+				size_t j = missed[m];
+				values[j] = computed[m];
+				insert(keys.data() + j * key_size, hashes[j], computed[m]);
+			}
+			for (size_t r = 0; r < repeats; ++r)
+				values[repeated[r]] = computed[repeated_miss[r]];
+		}
+		hits.fetch_add(count - misses_in_block, memory_order_relaxed);
+		misses.fetch_add(misses_in_block, memory_order_relaxed);
+
+		storeColumn(result, first, nullptr, count, values);
+	}
+}
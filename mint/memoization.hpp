@@ -0,0 +1,69 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef MEMOIZATION_HPP_
+#define MEMOIZATION_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/// Evaluates a program through a cache of its results, for argument tuples that repeat, e.g.
+/// quantized readings.  The cache is a fixed size open addressing table keyed by the bit
+/// patterns of the arguments the program reads, so arguments it doesn't read don't affect
+/// hits, while 0.0 and -0.0 are different keys.  Only the first output is cached.  The table is
+/// lock free: readers never wait, and an insert that collides with another insert into the
+/// same entry is dropped.  runRange() can be called concurrently with one context per thread.
+class MemoizedProgram {
+public:
+	/// Caches the results of program in a table of capacity entries, rounded up to a power of
+	/// two.  Throws std::invalid_argument if capacity is 0.
+	MemoizedProgram(Program program, size_t capacity = 4096);
+
+	const Program &getProgram() const { return program; }
+	size_t getCapacity() const { return mask + 1; }
+
+	/// Evaluates a single row, like Program::run().  The run methods use the context of the
+	/// program and one owned by this object, so they must not be called concurrently.
+	double run(const double *arguments);
+
+	/// Evaluates n rows, like Program::run().  Only the rows that miss the cache are evaluated,
+	/// a block at a time, and rows of a block with the same key are evaluated once.
+	void run(const ColumnView *arguments, const ResultView &result, size_t n);
+
+	/// Like run() for the rows first <= i < end, with the given context.
+	void runRange(Program::Context &context, const ColumnView *arguments,
+		const ResultView &result, size_t first, size_t end) const;
+
+	size_t getHits() const { return hits.load(std::memory_order_relaxed); }
+	size_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+	void resetStatistics();
+
+	/// Empties the cache.  Must not be called concurrently with the run methods.
+	void clear();
+
+	/// number of entries probed for a key, starting at its hash
+	static const size_t PROBES = 4;
+
+private:
+	uint64_t hash(const uint64_t *key) const;
+	bool lookup(const uint64_t *key, uint64_t hash, double *value) const;
+	void insert(const uint64_t *key, uint64_t hash, double value) const;
+
+	Program program;
+	size_t key_size; // words per key, one per used argument
+	size_t mask;
+
+	// Every entry is a sequence number, the bits of the result and the key.  The sequence number
+	// is 0 for empty entries and odd while the entry is written.
+	std::unique_ptr<std::atomic<uint64_t>[]> table;
+	mutable std::atomic<size_t> hits;
+	mutable std::atomic<size_t> misses;
+	Program::Context context;
+};
+
+#endif // MEMOIZATION_HPP_
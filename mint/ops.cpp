@@ -9,59 +9,99 @@ static const struct {
 	const char *name;
 	char operandNumber;
 	char isConstant;
+	char immediateSize;
 } OPERATOR_DATA_TABLE[] = {
-	{ OP_HLT,   "HLT",   0, 0 },
-	{ OP_NOOP,  "NOOP",  0, 0 },
-
-	{ OP_CONST, "CONST", 0, 1 },
-	{ OP_ARG,   "ARG",   0, 0 },
-
-	{ OP_PI,    "PI",    0, 1 },
-	{ OP_E,     "E",     0, 1 },
-
-	{ OP_NEG,   "NEG",   1, 0 },
-	{ OP_INV,   "INV",   1, 0 },
-
-	{ OP_SQ,    "SQ",    1, 0 },
-	{ OP_CU,    "CU",    1, 0 },
-	{ OP_SQRT,  "SQRT",  1, 0 },
-
-	{ OP_SIN,   "SIN",   1, 0 },
-	{ OP_COS,   "COS",   1, 0 },
-	{ OP_TAN,   "TAN",   1, 0 },
-	{ OP_ASIN,  "ASIN",  1, 0 },
-	{ OP_ACOS,  "ACOS",  1, 0 },
-	{ OP_ATAN,  "ATAN",  1, 0 },
-	{ OP_SINH,  "SINH",  1, 0 },
-	{ OP_COSH,  "COSH",  1, 0 },
-	{ OP_TANH,  "TANH",  1, 0 },
-	{ OP_ASINH, "ASINH", 1, 0 },
-	{ OP_ACOSH, "ACOSH", 1, 0 },
-	{ OP_ATANH, "ATANH", 1, 0 },
-
-	{ OP_EXP,   "EXP",   1, 0 },
-	{ OP_LOG,   "LOG",   1, 0 },
-
-	{ OP_ERF,   "ERF",   1, 0 },
-	{ OP_ERFC,  "ERFC",  1, 0 },
-
-	{ OP_ABS,   "ABS",   1, 0 },
-	{ OP_FLOOR, "FLOOR", 1, 0 },
-	{ OP_CEIL,  "CEIL",  1, 0 },
-	{ OP_ROUND, "ROUND", 1, 0 },
-	{ OP_TRUNC, "TRUNC", 1, 0 },
-
-	{ OP_POWI,  "POWI",  1, 0 },
-
-	{ OP_ADD,   "ADD",   2, 0 },
-	{ OP_SUB,   "SUB",   2, 0 },
-	{ OP_MUL,   "MUL",   2, 0 },
-	{ OP_DIV,   "DIV",   2, 0 },
-	{ OP_POW,   "POW",   2, 0 },
-
-	{ OP_INVALID, "", 0, 0 },
+	{ OP_HLT,   "HLT",   0, 0, 0 },
+	{ OP_NOOP,  "NOOP",  0, 0, 0 },
+
+	{ OP_CONST, "CONST", 0, 1, 1 },
+	{ OP_ARG,   "ARG",   0, 0, 1 },
+
+	{ OP_CONST16, "CONST16", 0, 1, 2 },
+	{ OP_CONST32, "CONST32", 0, 1, 4 },
+	{ OP_ARG16,   "ARG16",   0, 0, 2 },
+	{ OP_ARG32,   "ARG32",   0, 0, 4 },
+
+	{ OP_LOAD,  "LOAD",  0, 0, 1 },
+
+	{ OP_PI,    "PI",    0, 1, 0 },
+	{ OP_E,     "E",     0, 1, 0 },
+
+	{ OP_NEG,   "NEG",   1, 0, 0 },
+	{ OP_INV,   "INV",   1, 0, 0 },
+
+	{ OP_SQ,    "SQ",    1, 0, 0 },
+	{ OP_CU,    "CU",    1, 0, 0 },
+	{ OP_SQRT,  "SQRT",  1, 0, 0 },
+
+	{ OP_SIN,   "SIN",   1, 0, 0 },
+	{ OP_COS,   "COS",   1, 0, 0 },
+	{ OP_TAN,   "TAN",   1, 0, 0 },
+	{ OP_ASIN,  "ASIN",  1, 0, 0 },
+	{ OP_ACOS,  "ACOS",  1, 0, 0 },
+	{ OP_ATAN,  "ATAN",  1, 0, 0 },
+	{ OP_SINH,  "SINH",  1, 0, 0 },
+	{ OP_COSH,  "COSH",  1, 0, 0 },
+	{ OP_TANH,  "TANH",  1, 0, 0 },
+	{ OP_ASINH, "ASINH", 1, 0, 0 },
+	{ OP_ACOSH, "ACOSH", 1, 0, 0 },
+	{ OP_ATANH, "ATANH", 1, 0, 0 },
+
+	{ OP_EXP,   "EXP",   1, 0, 0 },
+	{ OP_LOG,   "LOG",   1, 0, 0 },
+
+	{ OP_ERF,   "ERF",   1, 0, 0 },
+	{ OP_ERFC,  "ERFC",  1, 0, 0 },
+
+	{ OP_LOG1P, "LOG1P", 1, 0, 0 },
+	{ OP_EXPM1, "EXPM1", 1, 0, 0 },
+	{ OP_CBRT,  "CBRT",  1, 0, 0 },
+
+	{ OP_ABS,   "ABS",   1, 0, 0 },
+	{ OP_FLOOR, "FLOOR", 1, 0, 0 },
+	{ OP_CEIL,  "CEIL",  1, 0, 0 },
+	{ OP_ROUND, "ROUND", 1, 0, 0 },
+	{ OP_TRUNC, "TRUNC", 1, 0, 0 },
+
+	{ OP_POWI,  "POWI",  1, 0, 1 },
+
+	{ OP_ADD,   "ADD",   2, 0, 0 },
+	{ OP_SUB,   "SUB",   2, 0, 0 },
+	{ OP_MUL,   "MUL",   2, 0, 0 },
+	{ OP_DIV,   "DIV",   2, 0, 0 },
+	{ OP_POW,   "POW",   2, 0, 0 },
+	{ OP_HYPOT, "HYPOT", 2, 0, 0 },
+
+	{ OP_RSUB,  "RSUB",  2, 0, 0 },
+	{ OP_RDIV,  "RDIV",  2, 0, 0 },
+	{ OP_RPOW,  "RPOW",  2, 0, 0 },
+
+	{ OP_LT,    "LT",    2, 0, 0 },
+	{ OP_LE,    "LE",    2, 0, 0 },
+	{ OP_GT,    "GT",    2, 0, 0 },
+	{ OP_GE,    "GE",    2, 0, 0 },
+	{ OP_EQ,    "EQ",    2, 0, 0 },
+	{ OP_NE,    "NE",    2, 0, 0 },
+	{ OP_AND,   "AND",   2, 0, 0 },
+	{ OP_OR,    "OR",    2, 0, 0 },
+	{ OP_NOT,   "NOT",   1, 0, 0 },
+
+	{ OP_SELECT, "SELECT", 3, 0, 0 },
+
+	{ OP_SINCOS, "SINCOS", 1, 0, 1 },
+	{ OP_COSSIN, "COSSIN", 1, 0, 1 },
+	{ OP_STORE,  "STORE",  1, 0, 1 },
+
+	{ OP_CALL,   "CALL",   0, 0, 2 }, // the number of operands is an immediate
+
+	{ OP_INVALID, "", 0, 0, 0 },
 };
 
+bool isOperatorValid(int op) {
+	const int n = sizeof(OPERATOR_DATA_TABLE) / sizeof(OPERATOR_DATA_TABLE[0]) - 1;
+	return 0 <= op && op < n && OPERATOR_DATA_TABLE[op].op == op;
+}
+
 int getOperandNumber(int op) {
 	return OPERATOR_DATA_TABLE[op].operandNumber;
 }
@@ -70,6 +110,10 @@ bool isOperatorConstant(int op) {
 	return OPERATOR_DATA_TABLE[op].isConstant != 0;
 }
 
+int getImmediateSize(int op) {
+	return OPERATOR_DATA_TABLE[op].immediateSize;
+}
+
 const char *getOperatorName(int op) {
 	return OPERATOR_DATA_TABLE[op].name;
 }
@@ -5,6 +5,8 @@
 #ifndef OPS_HPP_
 #define OPS_HPP_
 
+#include <cstddef>
+
 enum Op {
 	// program flow
 	OP_HLT,   // end program execution
@@ -14,6 +16,14 @@ enum Op {
 	OP_CONST, // push constant on stack
 	OP_ARG,   // push argument on stack
 
+	// push values with wider indices, for programs with many constants or arguments
+	OP_CONST16, // push constant on stack, 16 bit index
+	OP_CONST32, // push constant on stack, 32 bit index
+	OP_ARG16,   // push argument on stack, 16 bit index
+	OP_ARG32,   // push argument on stack, 32 bit index
+
+	OP_LOAD,  // push the value stored in a slot by an operation with several results
+
 	// constants
 	OP_PI,    // push pi onto the stack
 	OP_E,     // push e onto the stack
@@ -45,6 +55,10 @@ enum Op {
 	OP_ERF,   // error function
 	OP_ERFC,  // complementary error function
 
+	OP_LOG1P, // log(1 + x), accurate for small x
+	OP_EXPM1, // exp(x) - 1, accurate for small x
+	OP_CBRT,  // cube root
+
 	OP_ABS,   // magnitude or absolute value of the given value
 	OP_FLOOR, // nearest integer not greater than the given value
 	OP_CEIL,  // nearest integer not less than the given value
@@ -59,14 +73,59 @@ enum Op {
 	OP_MUL,   // multiply
 	OP_DIV,   // divide
 	OP_POW,   // first value to the second value's power
+	OP_HYPOT, // sqrt(x*x + y*y) without intermediate overflow or underflow
+
+	// operations with two parameters in reversed order, so the more expensive operand can be
+	// evaluated first
+	OP_RSUB,  // subtract the first value from the second value
+	OP_RDIV,  // divide the second value by the first value
+	OP_RPOW,  // second value to the first value's power
+
+	// comparisons and logical operations.  They return 1 for true and 0 for false, any value
+	// other than 0 counts as true.
+	OP_LT,    // first value less than second value
+	OP_LE,    // first value less than or equal to second value
+	OP_GT,    // first value greater than second value
+	OP_GE,    // first value greater than or equal to second value
+	OP_EQ,    // first value equal to second value
+	OP_NE,    // first value not equal to second value
+	OP_AND,   // both values are true
+	OP_OR,    // at least one value is true
+	OP_NOT,   // top value is false
+
+	// operations with three parameters
+	OP_SELECT, // second value if the first value is true, third value otherwise
+
+	// operations with several results.  The first result replaces the top value, the second one
+	// is stored in the slot given by the immediate operand, to be pushed again by OP_LOAD.
+	OP_SINCOS, // sine, stores the cosine
+	OP_COSSIN, // cosine, stores the sine
+
+	// stores the top value in the slot given by the immediate operand and leaves it on the stack,
+	// so a shared subexpression is computed once and pushed again by OP_LOAD
+	OP_STORE,
+
+	// calls a native function.  The first immediate byte is the index into the program's table
+	// of native functions, the second one the number of parameters, which are popped.
+	OP_CALL,
 
 	// technical nodes used by the AST
 	OP_INVALID = 0x100, // invalid opcode
 
 };
 
+bool isOperatorValid(int op);
 int getOperandNumber(int op);
 bool isOperatorConstant(int op);
+int getImmediateSize(int op);
 const char *getOperatorName(int op);
 
+/// reads an immediate operand of the given size in bytes, stored in little endian order
+inline size_t readImmediate(const unsigned char *ip, int size) {
+	size_t value = 0;
+	for (int i = size - 1; i >= 0; --i)
+		value = (value << 8) | ip[i];
+	return value;
+}
+
 #endif
@@ -7,8 +7,13 @@
 #include "ast.hpp"
 #include "impl.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
 
 using std::move;
 using std::swap;
@@ -35,81 +40,102 @@ static void matchAll(Visitor visitor, Ast *ast) {
 	}
 }
 
+// true if pow(x, exponent) can be computed by a cheaper operation of an integer power
+static bool isIntegerExponent(const Ast &exponent) {
+	if (exponent.op != OP_CONST || exponent.d != exponent.d)
+		return false;
+	long i = long(exponent.d);
+	return exponent.d == (double)i && SCHAR_MIN <= i && i <= SCHAR_MAX;
+}
+
+// the operation of x^i for an integer exponent i, with x as its only operand
+static Ast makeIntegerPower(Ast &&x, long i) {
+	Ast ast(OP_POWI);
+	if (i == 1)
+		ast.op = OP_NOOP;
+	else if (i == 2)
+		ast.op = OP_SQ;
+	else if (i == 3)
+		ast.op = OP_CU;
+	else
+		ast.i = i;
+	ast.children.emplace_back(move(x));
+	return ast;
+}
+
 void Optimizer::optimizePowersToIntegerExponents(Ast *ast) {
 	matchAll([](Ast *ast) {
-		if (ast->op != OP_POW || ast->children.size() != 2)
-			return;
-		Ast *exponent_node = &ast->children[1];
-		if (exponent_node->op == OP_CONST) {
-			double exponent = exponent_node->d;
-			if (exponent != exponent)
-				return;
-			long i = long(exponent);
-			if (exponent == (double)i && SCHAR_MIN <= i && i <= SCHAR_MAX) {
-				ast->children.pop_back();
-				if (i == 1) {
-					ast->op = OP_NOOP;
-				} else if (i == 2) {
-					ast->op = OP_SQ;
-				} else if (i == 3) {
-					ast->op = OP_CU;
-				} else {
-					ast->op = OP_POWI;
-					ast->i = i;
-				}
-			}
-		}
+		if ((ast->op != OP_POW && ast->op != OP_RPOW) || ast->children.size() != 2)
+			return;
+		size_t exponent_index = ast->op == OP_POW ? 1 : 0;
+		if (!isIntegerExponent(ast->children[exponent_index]))
+			return;
+		int pos = ast->pos;
+		int len = ast->len;
+		*ast = makeIntegerPower(move(ast->children[1 - exponent_index]),
+			long(ast->children[exponent_index].d));
+		ast->pos = pos;
+		ast->len = len;
 	}, ast);
 }
 
+// value of a constant operand, pi and e are only turned into constants by their parent
+static inline double getConstant(const Ast &ast) {
+	return ast.op == OP_CONST ? ast.d : op0_impl<double>(ast.op);
+}
+
+// value of an operation whose operands are all constants
+static double evaluateConstant(const Ast &ast) {
+	const std::vector<Ast> &children = ast.children;
+	if (ast.op == OP_POWI)
+		return pow(getConstant(children[0]), ast.i);
+	switch (getOperandNumber(ast.op)) {
+	case 0:  return op0_impl<double>(ast.op);
+	case 1:  return op1_impl(ast.op, getConstant(children[0]));
+	case 2:  return op2_impl<double>(ast.op, getConstant(children[0]), getConstant(children[1]));
+	default:
+		return op3_impl<double>(ast.op, getConstant(children[0]), getConstant(children[1]),
+			getConstant(children[2]));
+	}
+}
+
+// true if the node computes a value from its operands, and all of them are constants
+static bool isFoldable(const Ast &ast) {
+	switch (ast.op) {
+	case OP_HLT: case OP_NOOP: case OP_CONST: case OP_ARG: case OP_LOAD: case OP_STORE:
+	case OP_SINCOS: case OP_COSSIN: case OP_CALL:
+		return false;
+	default:
+		break;
+	}
+	if (size_t(getOperandNumber(ast.op)) != ast.children.size())
+		return false;
+	for (const Ast &child : ast.children) {
+		if (!isOperatorConstant(child.op))
+			return false;
+	}
+	return true;
+}
+
 void Optimizer::foldConstants(Ast *ast) {
 	matchAll([](Ast *ast) {
-		if (getOperandNumber(ast->op) != ast->children.size())
+		// a shared constant is not worth a slot, every copy is folded like the others
+		if (ast->op == OP_STORE && isOperatorConstant(ast->children[0].op)) {
+			Ast child = move(ast->children[0]);
+			*ast = move(child);
 			return;
-		bool has_non_constant_child = false;
-		for (Ast &child : ast->children) {
-			if (!isOperatorConstant(child.op)) {
-				has_non_constant_child = true;
-				break;
-			}
 		}
-		if (has_non_constant_child)
+		if (!isFoldable(*ast))
+			return;
+		if (ast->children.empty()) {
+			// pi and e keep their operator, which is cheaper than loading a constant
+			ast->d = evaluateConstant(*ast);
 			return;
-		double d;
-		bool is_operator = true;
-		switch (ast->op) {
-		case OP_POWI:
-			d = pow(ast->children[0].d, ast->i);
-			break;
-		case OP_ARG:
-		case OP_CONST:
-			is_operator = false;
-			break;
-		default:
-			switch (getOperandNumber(ast->op)) {
-				case 0: {
-					ast->d = op0_impl<double>(ast->op);
-					is_operator = false;
-					break;
-				}
-				case 1: {
-					double x = ast->children[0].d;
-					d = op1_impl(ast->op, x);
-					break;
-				}
-				case 2: {
-					double x = ast->children[0].d;
-					double y = ast->children[1].d;
-					d = op2_impl<double>(ast->op, x, y);
-					break;
-				}
-			}
-		} // switch (ast->op)
-		if (is_operator) {
-			ast->children.clear();
-			ast->op = OP_CONST;
-			ast->d = d;
 		}
+		double d = evaluateConstant(*ast);
+		ast->children.clear();
+		ast->op = OP_CONST;
+		ast->d = d;
 	}, ast);
 }
 
@@ -128,6 +154,59 @@ void Optimizer::foldDoubleMinus(Ast *ast) {
 	}, ast);
 }
 
+static Ast makeConstant(double value) {
+	Ast ast(OP_CONST);
+	ast.d = value;
+	return ast;
+}
+
+// The rewrites of powi, fold-double-minus and fold-constants as rules, so they are all applied
+// in one traversal, and a constant folded below a power is seen by the power.
+static RuleSet makeNormalizingRules() {
+	RuleSet rules;
+	for (Op op : { OP_POW, OP_RPOW }) {
+		size_t exponent = op == OP_POW ? 1 : 0;
+		rules.addRule(op, 2, [exponent](RuleSet::Match &match) {
+			const Ast &node = match.getNode();
+			int pos = node.pos;
+			int len = node.len;
+			Ast power = makeIntegerPower(match.take(1 - exponent), long(match[exponent].d));
+			power.pos = pos;
+			power.len = len;
+			return power;
+		}, [exponent](const RuleSet::Match &match) {
+			return isIntegerExponent(match[exponent]);
+		});
+	}
+	rules.addRule("-(-x)", "x");
+
+	rules.addRule(OP_STORE, 1, [](RuleSet::Match &match) {
+		return match.take(0);
+	}, [](const RuleSet::Match &match) {
+		return isOperatorConstant(match[0].op);
+	});
+	for (int op = 0; op < OP_INVALID; ++op) {
+		int operands = isOperatorValid(op) ? getOperandNumber(op) : 0;
+		if (operands == 0)
+			continue;
+		rules.addRule(Op(op), size_t(operands), [](RuleSet::Match &match) {
+			const Ast &node = match.getNode();
+			Ast constant = makeConstant(evaluateConstant(node));
+			constant.pos = node.pos;
+			constant.len = node.len;
+			return constant;
+		}, [](const RuleSet::Match &match) {
+			return isFoldable(match.getNode());
+		});
+	}
+	return rules;
+}
+
+void Optimizer::normalize(Ast *ast) {
+	static const RuleSet rules = makeNormalizingRules();
+	rules.rewrite(ast);
+}
+
 void Optimizer::SubtractionToSum(Ast *ast) {
 	matchAll([](Ast *ast) {
 		if (ast->op == OP_SUB && ast->children.size() == 2) {
@@ -144,41 +223,721 @@ void Optimizer::SubtractionToSum(Ast *ast) {
 }
 
 void Optimizer::FlattenSum(Ast *ast) {
-	matchAll([](Ast *ast) {
-		if (ast->op == OP_ADD) {
-			// TODO: As an optimization, only copy the children to temp and move back to ast,
-			// if there is actually at least one child that is OP_ADD
-			Ast temp(OP_ADD);
-			for (Ast &child : ast->children) {
-				if (child.op == OP_ADD) {
-					for (Ast &grandchild : child.children) {
-						temp.children.emplace_back(move(grandchild));
+	// Top down, so every nested sum is taken apart by the outermost sum containing it, and
+	// every term is moved once.  The terms keep their order from left to right.
+	std::vector<Ast *> stack;
+	stack.push_back(ast);
+	while (stack.size() > 0) {
+		Ast *node = stack.back();
+		stack.pop_back();
+		if (node->op == OP_ADD) {
+			bool nested = false;
+			for (const Ast &child : node->children)
+				nested = nested || child.op == OP_ADD;
+			if (nested) {
+				std::vector<Ast> sums = move(node->children);
+				std::vector<Ast> terms;
+				std::vector<Ast *> pending;
+				for (size_t i = sums.size(); i-- > 0;)
+					pending.push_back(&sums[i]);
+				while (pending.size() > 0) {
+					Ast *term = pending.back();
+					pending.pop_back();
+					if (term->op == OP_ADD) {
+						for (size_t i = term->children.size(); i-- > 0;)
+							pending.push_back(&term->children[i]);
+					} else {
+						terms.emplace_back(move(*term));
 					}
 				}
-				else {
-					temp.children.emplace_back(move(child));
-				}
+				node->children = move(terms);
 			}
-			*ast = move(temp);
 		}
-	}, ast);
+		for (Ast &child : node->children)
+			stack.push_back(&child);
+	}
 }
 
-void Optimizer::compressStack(Ast *ast) {
+void Optimizer::foldConstantOperands(Ast *ast) {
 	matchAll([](Ast *ast) {
-		if (ast->op == OP_ADD || ast->op == OP_MUL) {
-			auto &lhs = ast->children[0];
-			auto &rhs = ast->children[1];
-			if (lhs.stack_size_needed < rhs.stack_size_needed)
-				swap(lhs, rhs);
+		auto &children = ast->children;
+		if ((ast->op != OP_ADD && ast->op != OP_MUL) || children.size() < 3)
+			return;
+		// the first constant takes the values of the others
+		size_t first = children.size();
+		size_t kept = 0;
+		for (size_t i = 0; i < children.size(); ++i) {
+			if (children[i].op != OP_CONST || first == children.size()) {
+				if (children[i].op == OP_CONST)
+					first = kept;
+				if (kept != i)
+					children[kept] = move(children[i]);
+				++kept;
+			} else if (ast->op == OP_ADD) {
+				children[first].d += children[i].d;
+			} else {
+				children[first].d *= children[i].d;
+			}
+		}
+		children.resize(kept);
+		if (children.size() == 1) {
+			Ast single = move(children[0]);
+			*ast = move(single);
 		}
+	}, ast);
+}
+
+static bool isCommutative(Op op) {
+	return op == OP_ADD || op == OP_MUL || op == OP_EQ || op == OP_NE || op == OP_AND
+		|| op == OP_OR || op == OP_HYPOT;
+}
+
+// Returns the reversed version of a non-commutative binary operator and vice versa, or OP_INVALID
+// if the operator has no reversed version.
+static Op reversedOperator(Op op) {
+	switch (op) {
+	case OP_SUB:  return OP_RSUB;
+	case OP_DIV:  return OP_RDIV;
+	case OP_POW:  return OP_RPOW;
+	case OP_RSUB: return OP_SUB;
+	case OP_RDIV: return OP_DIV;
+	case OP_RPOW: return OP_POW;
+	case OP_LT:   return OP_GT;
+	case OP_LE:   return OP_GE;
+	case OP_GT:   return OP_LT;
+	case OP_GE:   return OP_LE;
+	default:      return OP_INVALID;
+	}
+}
+
+// Sethi-Ullman numbering for compressStack and compressStackRelaxed.  Sums and products with
+// more than two operands are only reordered if relaxed, as that reassociates them.
+static void numberForStack(Ast *ast, bool relaxed) {
+	matchAll([relaxed](Ast *ast) {
+		auto &children = ast->children;
+		bool is_chain = (ast->op == OP_ADD || ast->op == OP_MUL) && children.size() >= 2;
+
+		if (is_chain && (relaxed || children.size() == 2)) {
+			// the chain is evaluated as c0, c1, op, c2, op, ... so only the first child can use
+			// the whole stack.  Move the most demanding child to the front.
+			size_t max_index = 0;
+			for (size_t i = 1; i < children.size(); ++i) {
+				if (children[max_index].stack_size_needed < children[i].stack_size_needed)
+					max_index = i;
+			}
+			if (max_index != 0) {
+				Ast tmp = move(children[max_index]);
+				children.erase(children.begin() + max_index);
+				children.insert(children.begin(), move(tmp));
+			}
+		} else if (children.size() == 2 && isCommutative(ast->op)) {
+			if (children[0].stack_size_needed < children[1].stack_size_needed)
+				swap(children[0], children[1]);
+		} else if (children.size() == 2 && reversedOperator(ast->op) != OP_INVALID) {
+			// evaluate the more demanding operand first and use the reversed operator
+			if (children[0].stack_size_needed < children[1].stack_size_needed) {
+				swap(children[0], children[1]);
+				ast->op = reversedOperator(ast->op);
+			}
+		}
+
 		size_t max_size = 1;
-		for (unsigned i = 0; i < ast->children.size(); ++i) {
-			auto &child = ast->children[i];
-			size_t cur_size = child.stack_size_needed + i;
+		for (size_t i = 0; i < children.size(); ++i) {
+			size_t offset = is_chain ? (i > 0 ? 1 : 0) : i;
+			size_t cur_size = children[i].stack_size_needed + offset;
 			if (max_size < cur_size)
 				max_size = cur_size;
 		}
 		ast->stack_size_needed = max_size;
 	}, ast);
 }
+
+void Optimizer::compressStack(Ast *ast) {
+	numberForStack(ast, false);
+}
+
+void Optimizer::compressStackRelaxed(Ast *ast) {
+	numberForStack(ast, true);
+}
+
+// true if multiplying with 1/c gives the same results as dividing by c
+static bool hasExactReciprocal(double c) {
+	int exponent;
+	double mantissa = std::frexp(c, &exponent);
+	return std::isfinite(c) && std::abs(mantissa) == 0.5 && std::isnormal(1.0 / c);
+}
+
+static void chooseCheaperForms(Ast *ast, const CostModel &model, bool relaxed) {
+	matchAll([&model, relaxed](Ast *ast) {
+		auto &children = ast->children;
+
+		// x / c => x * (1 / c), and the same for the reversed division c \ x
+		size_t divisor = ast->op == OP_DIV ? 1 : 0;
+		if ((ast->op == OP_DIV || ast->op == OP_RDIV) && children.size() == 2 &&
+			children[divisor].op == OP_CONST &&
+			(relaxed || hasExactReciprocal(children[divisor].d)) &&
+			model.getCost(OP_MUL) < model.getCost(ast->op))
+		{
+			ast->op = OP_MUL;
+			children[divisor].d = 1.0 / children[divisor].d;
+			return;
+		}
+
+		if (!relaxed)
+			return;
+
+		double separate = 2 * model.getCost(OP_EXP) + model.getCost(OP_MUL);
+		double merged = model.getCost(OP_EXP) + model.getCost(OP_ADD);
+
+		// exp(a) * exp(b) => exp(a + b)
+		if (ast->op == OP_MUL && children.size() == 2 && children[0].op == OP_EXP &&
+			children[1].op == OP_EXP && merged < separate)
+		{
+			Ast sum(OP_ADD);
+			sum.children.reserve(2);
+			sum.children.emplace_back(move(children[0].children[0]));
+			sum.children.emplace_back(move(children[1].children[0]));
+			Ast exp(OP_EXP);
+			exp.children.emplace_back(move(sum));
+			*ast = move(exp);
+			return;
+		}
+
+		// exp(a + b) => exp(a) * exp(b)
+		if (ast->op == OP_EXP && children[0].op == OP_ADD && children[0].children.size() == 2 &&
+			separate < merged)
+		{
+			Ast sum = move(children[0]);
+			Ast product(OP_MUL);
+			product.children.reserve(2);
+			for (Ast &term : sum.children) {
+				Ast exp(OP_EXP);
+				exp.children.emplace_back(move(term));
+				product.children.emplace_back(move(exp));
+			}
+			*ast = move(product);
+		}
+	}, ast);
+}
+
+void Optimizer::rewriteByCost(Ast *ast) {
+	chooseCheaperForms(ast, cost_model, false);
+}
+
+void Optimizer::rewriteByCostRelaxed(Ast *ast) {
+	chooseCheaperForms(ast, cost_model, true);
+}
+
+static bool isConstant(const Ast &ast, double value) {
+	return ast.op == OP_CONST && ast.d == value;
+}
+
+static RuleSet makeIntrinsicRules() {
+	RuleSet rules;
+	rules.addRule("log(1 + x)", "log1p(x)");
+	rules.addRule("log(x + 1)", "log1p(x)");
+	rules.addRule("exp(x) - 1", "expm1(x)");
+	rules.addRule("exp(x) + -1", "expm1(x)");
+	rules.addRule("-1 + exp(x)", "expm1(x)");
+	rules.addRule("sqrt(x^2 + y^2)", "hypot(x, y)");
+	rules.addRule("sqrt(x*x + y^2)", "hypot(x, y)");
+	rules.addRule("sqrt(x^2 + y*y)", "hypot(x, y)");
+	rules.addRule("sqrt(x*x + y*y)", "hypot(x, y)");
+
+	// exp(x) - 1 with reversed operands, as left behind by compressStack
+	Ast x(OP_ARG);
+	Ast reversed(OP_RSUB);
+	reversed.children.emplace_back(OP_CONST);
+	reversed.children[0].d = 1.0;
+	reversed.children.emplace_back(OP_EXP);
+	reversed.children[1].children.push_back(x);
+	Ast expm1(OP_EXPM1);
+	expm1.children.push_back(x);
+	rules.addRule(reversed, expm1);
+	return rules;
+}
+
+void Optimizer::recognizeIntrinsics(Ast *ast) {
+	static const RuleSet rules = makeIntrinsicRules();
+	rules.rewrite(ast);
+}
+
+void Optimizer::applyRules(Ast *ast) {
+	rules.rewrite(ast);
+}
+
+// Numbers the distinct subtrees of a tree.  Two nodes are in the same class if they have the
+// same operator and immediate and their children are in the same classes, i.e. if the subtrees
+// are equal.  The classes are found bottom up, so every node is looked up once.
+struct SubtreeKeyHash {
+	size_t operator()(const std::vector<uint64_t> &key) const {
+		uint64_t hash = 0;
+		for (uint64_t word : key) {
+			hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+			hash ^= hash >> 32;
+		}
+		return size_t(hash);
+	}
+};
+
+static std::unordered_map<const Ast *, size_t> classifySubtrees(Ast *ast) {
+	std::unordered_map<const Ast *, size_t> classes;
+	std::unordered_map<std::vector<uint64_t>, size_t, SubtreeKeyHash> ids;
+	std::vector<uint64_t> key;
+	matchAll([&](Ast *node) {
+		uint64_t bits;
+		memcpy(&bits, &node->str, sizeof(bits));
+		key.assign({ uint64_t(node->op), bits });
+		for (const Ast &child : node->children)
+			key.push_back(classes[&child]);
+		auto inserted = ids.emplace(key, ids.size());
+		classes[node] = inserted.first->second;
+	}, ast);
+	return classes;
+}
+
+void Optimizer::shareSinCos(Ast *ast) {
+	// pair indices already used, e.g. by an earlier run
+	long next_pair = 0;
+	std::vector<Ast *> unpaired;
+	matchAll([&](Ast *ast) {
+		if (ast->op == OP_SINCOS || ast->op == OP_COSSIN || ast->op == OP_STORE) {
+			if (next_pair <= ast->i)
+				next_pair = ast->i + 1;
+		} else if (ast->op == OP_SIN || ast->op == OP_COS) {
+			unpaired.push_back(ast);
+		}
+	}, ast);
+	if (unpaired.size() < 2)
+		return;
+
+	// a sine waits for a cosine of the same argument and vice versa
+	std::unordered_map<const Ast *, size_t> classes = classifySubtrees(ast);
+	std::unordered_multimap<size_t, Ast *> waiting[2]; // sines and cosines by argument class
+	for (Ast *node : unpaired) {
+		if (next_pair > UINT8_MAX)
+			break;
+		size_t id = classes[&node->children[0]];
+		bool is_sine = node->op == OP_SIN;
+		auto partner = waiting[is_sine ? 1 : 0].find(id);
+		if (partner == waiting[is_sine ? 1 : 0].end()) {
+			waiting[is_sine ? 0 : 1].emplace(id, node);
+			continue;
+		}
+		for (Ast *paired : { node, partner->second }) {
+			paired->op = paired->op == OP_SIN ? OP_SINCOS : OP_COSSIN;
+			paired->i = next_pair;
+		}
+		++next_pair;
+		waiting[is_sine ? 1 : 0].erase(partner);
+	}
+}
+
+void Optimizer::shareSubexpressions(Ast *ast) {
+	// an earlier run is undone, as the tree may have changed since
+	matchAll([](Ast *node) {
+		if (node->op == OP_STORE) {
+			Ast child = move(node->children[0]);
+			*node = move(child);
+		}
+	}, ast);
+
+	// slots already used by pairs of sine and cosine
+	long next_slot = 0;
+	matchAll([&](Ast *node) {
+		if ((node->op == OP_SINCOS || node->op == OP_COSSIN) && next_slot <= node->i)
+			next_slot = node->i + 1;
+	}, ast);
+
+	// Equal subtrees form a class.  Leaves are as cheap to compute as to load, and subtrees
+	// without arguments are left to constant folding, so neither can be shared.
+	std::unordered_map<const Ast *, size_t> classes = classifySubtrees(ast);
+	std::vector<size_t> counts(classes.size(), 0);
+	std::vector<char> shareable(classes.size(), 0);
+	std::vector<char> variable(classes.size(), 0);
+	matchAll([&](Ast *node) {
+		size_t id = classes[node];
+		bool depends = node->op == OP_ARG || node->op == OP_CALL;
+		for (const Ast &child : node->children)
+			depends = depends || variable[classes[&child]];
+		variable[id] = depends;
+		shareable[id] = depends && !node->children.empty() && node->op != OP_HLT;
+		counts[id]++;
+	}, ast);
+
+	// top down, so the largest repeated subtrees are shared first.  Moving a node keeps the
+	// addresses of its children, which are looked up later.
+	struct SharingState {
+		Ast *ast;
+		size_t parent_count; // occurrences of the nearest enclosing subtree
+	};
+	std::vector<long> slots(counts.size(), -1);
+	std::vector<SharingState> stack;
+	stack.push_back({ ast, 1 });
+	while (stack.size() > 0) {
+		Ast *node = stack.back().ast;
+		size_t count = stack.back().parent_count;
+		stack.pop_back();
+		size_t id = classes[node];
+		if (shareable[id]) {
+			if (counts[id] > count && (slots[id] >= 0 || next_slot <= UINT8_MAX)) {
+				if (slots[id] < 0)
+					slots[id] = next_slot++;
+				Ast store(OP_STORE);
+				store.i = slots[id];
+				store.pos = node->pos;
+				store.len = node->len;
+				store.children.push_back(move(*node));
+				*node = move(store);
+				node = &node->children[0];
+			}
+			count = counts[id];
+		}
+		for (Ast &child : node->children)
+			stack.push_back({ &child, count });
+	}
+}
+
+static Ast makeUnary(Op op, Ast &&x) {
+	Ast ast(op);
+	ast.children.emplace_back(move(x));
+	return ast;
+}
+
+// true if outer(inner(x)) is x wherever inner(x) is defined
+static bool isInverse(Op outer, Op inner) {
+	switch (outer) {
+	case OP_NEG:   return inner == OP_NEG;
+	case OP_INV:   return inner == OP_INV;
+	case OP_EXP:   return inner == OP_LOG;
+	case OP_LOG:   return inner == OP_EXP;
+	case OP_SIN:   return inner == OP_ASIN;
+	case OP_COS:   return inner == OP_ACOS;
+	case OP_TAN:   return inner == OP_ATAN;
+	case OP_SINH:  return inner == OP_ASINH;
+	case OP_ASINH: return inner == OP_SINH;
+	case OP_TANH:  return inner == OP_ATANH;
+	case OP_SQ:    return inner == OP_SQRT;
+	case OP_CU:    return inner == OP_CBRT;
+	case OP_CBRT:  return inner == OP_CU;
+	default:       return false;
+	}
+}
+
+// above this number of products in one sum, common factors are not searched for
+static const size_t MAX_FACTORED_TERMS = 64;
+
+struct Term {
+	double coefficient;
+	Ast rest;
+};
+
+// builds coefficient * rest, with the constant as the first factor of a product
+static Ast buildTerm(double coefficient, Ast &&rest) {
+	if (coefficient == 1.0)
+		return move(rest);
+	if (coefficient == -1.0)
+		return makeUnary(OP_NEG, move(rest));
+	if (rest.op == OP_MUL) {
+		rest.children.insert(rest.children.begin(), makeConstant(coefficient));
+		return move(rest);
+	}
+	Ast product(OP_MUL);
+	product.children.reserve(2);
+	product.children.emplace_back(makeConstant(coefficient));
+	product.children.emplace_back(move(rest));
+	return product;
+}
+
+// splits a term without signs into its constant factors and the product of the other factors
+static Term splitTerm(Ast &&term) {
+	if (term.op != OP_MUL)
+		return { 1.0, move(term) };
+	double coefficient = 1.0;
+	std::vector<Ast> factors;
+	for (Ast &factor : term.children) {
+		if (factor.op == OP_CONST)
+			coefficient *= factor.d;
+		else
+			factors.emplace_back(move(factor));
+	}
+	if (factors.empty())
+		return { coefficient, makeConstant(1.0) };
+	if (factors.size() == 1)
+		return { coefficient, move(factors[0]) };
+	term.children = move(factors);
+	return { coefficient, move(term) };
+}
+
+// removes one factor from a product of at least two factors
+static Ast removeFactor(Ast &&product, size_t index) {
+	product.children.erase(product.children.begin() + index);
+	if (product.children.size() == 1) {
+		Ast factor = move(product.children[0]);
+		return factor;
+	}
+	return move(product);
+}
+
+static void simplifySum(Ast *ast) {
+	// flatten nested sums, pushing signs into the terms
+	std::vector<std::pair<Ast, double>> pending;
+	for (size_t i = ast->children.size(); i-- > 0;)
+		pending.emplace_back(move(ast->children[i]), 1.0);
+
+	double constant = 0.0;
+	std::vector<Term> terms;
+	std::unordered_multimap<size_t, size_t> term_index;
+	while (pending.size() > 0) {
+		Ast term = move(pending.back().first);
+		double sign = pending.back().second;
+		pending.pop_back();
+		while (term.op == OP_NEG) {
+			sign = -sign;
+			Ast inner = move(term.children[0]);
+			term = move(inner);
+		}
+		if (term.op == OP_ADD) {
+			for (size_t i = term.children.size(); i-- > 0;)
+				pending.emplace_back(move(term.children[i]), sign);
+			continue;
+		}
+		if (term.op == OP_CONST) {
+			constant += sign * term.d;
+			continue;
+		}
+
+		// merge like terms
+		Term split = splitTerm(move(term));
+		split.coefficient *= sign;
+		if (split.rest.op == OP_CONST) {
+			constant += split.coefficient * split.rest.d;
+			continue;
+		}
+		size_t hash = split.rest.hash();
+		auto range = term_index.equal_range(hash);
+		auto match = range.first;
+		while (match != range.second && terms[match->second].rest != split.rest)
+			++match;
+		if (match != range.second) {
+			terms[match->second].coefficient += split.coefficient;
+		} else {
+			term_index.emplace(hash, terms.size());
+			terms.emplace_back(move(split));
+		}
+	}
+
+	// a*x + b*x => x*(a + b)
+	size_t products = 0;
+	for (Term &term : terms)
+		products += term.rest.op == OP_MUL;
+	std::vector<bool> merged(terms.size(), false);
+	for (size_t i = 0; i < terms.size() && products <= MAX_FACTORED_TERMS; ++i) {
+		if (merged[i] || terms[i].coefficient == 0.0 || terms[i].rest.op != OP_MUL)
+			continue;
+		for (size_t f = 0; f < terms[i].rest.children.size(); ++f) {
+			const Ast &factor = terms[i].rest.children[f];
+			std::vector<std::pair<size_t, size_t>> sharing;
+			for (size_t j = i + 1; j < terms.size(); ++j) {
+				if (merged[j] || terms[j].coefficient == 0.0 || terms[j].rest.op != OP_MUL)
+					continue;
+				auto &other = terms[j].rest.children;
+				for (size_t k = 0; k < other.size(); ++k) {
+					if (other[k] == factor) {
+						sharing.emplace_back(j, k);
+						break;
+					}
+				}
+			}
+			if (sharing.empty())
+				continue;
+			Ast common = factor;
+			Ast sum(OP_ADD);
+			sum.children.emplace_back(buildTerm(terms[i].coefficient,
+				removeFactor(move(terms[i].rest), f)));
+			for (auto &share : sharing) {
+				Term &other = terms[share.first];
+				sum.children.emplace_back(buildTerm(other.coefficient,
+					removeFactor(move(other.rest), share.second)));
+				merged[share.first] = true;
+			}
+			Ast product(OP_MUL);
+			product.children.reserve(2);
+			product.children.emplace_back(move(common));
+			product.children.emplace_back(move(sum));
+			terms[i] = { 1.0, move(product) };
+			break;
+		}
+	}
+
+	Ast sum(OP_ADD);
+	for (size_t i = 0; i < terms.size(); ++i) {
+		if (!merged[i] && terms[i].coefficient != 0.0)
+			sum.children.emplace_back(buildTerm(terms[i].coefficient, move(terms[i].rest)));
+	}
+	if (constant != 0.0 || sum.children.empty())
+		sum.children.emplace_back(makeConstant(constant));
+	if (sum.children.size() == 1) {
+		Ast single = move(sum.children[0]);
+		*ast = move(single);
+	} else {
+		*ast = move(sum);
+	}
+}
+
+static void simplifyProduct(Ast *ast) {
+	// flatten nested products, collecting constants and signs
+	std::vector<Ast> pending;
+	for (size_t i = ast->children.size(); i-- > 0;)
+		pending.emplace_back(move(ast->children[i]));
+
+	double constant = 1.0;
+	std::vector<std::pair<Ast, int>> factors; // base and exponent
+	std::unordered_multimap<size_t, size_t> factor_index;
+	while (pending.size() > 0) {
+		Ast factor = move(pending.back());
+		pending.pop_back();
+		while (factor.op == OP_NEG) {
+			constant = -constant;
+			Ast inner = move(factor.children[0]);
+			factor = move(inner);
+		}
+		if (factor.op == OP_MUL) {
+			for (size_t i = factor.children.size(); i-- > 0;)
+				pending.emplace_back(move(factor.children[i]));
+			continue;
+		}
+		if (factor.op == OP_CONST) {
+			constant *= factor.d;
+			continue;
+		}
+		// powers from products simplified before, e.g. sq(x) in sq(x)*x
+		int exponent = 1;
+		if (factor.op == OP_SQ || factor.op == OP_CU || (factor.op == OP_POWI && factor.i > 0)) {
+			exponent = factor.op == OP_SQ ? 2 : factor.op == OP_CU ? 3 : int(factor.i);
+			Ast base = move(factor.children[0]);
+			factor = move(base);
+		}
+		size_t hash = factor.hash();
+		auto range = factor_index.equal_range(hash);
+		auto match = range.first;
+		while (match != range.second && factors[match->second].first != factor)
+			++match;
+		if (match != range.second) {
+			factors[match->second].second += exponent;
+		} else {
+			factor_index.emplace(hash, factors.size());
+			factors.emplace_back(move(factor), exponent);
+		}
+	}
+
+	if (constant == 0.0) {
+		*ast = makeConstant(0.0);
+		return;
+	}
+
+	Ast product(OP_MUL);
+	if (constant != 1.0 && constant != -1.0)
+		product.children.emplace_back(makeConstant(constant));
+	for (auto &entry : factors) {
+		// x*x => sq(x), x*x*x => cu(x), other exponents => powi
+		int count = entry.second;
+		if (count == 1) {
+			product.children.emplace_back(move(entry.first));
+		} else if (count == 2) {
+			product.children.emplace_back(makeUnary(OP_SQ, move(entry.first)));
+		} else if (count == 3) {
+			product.children.emplace_back(makeUnary(OP_CU, move(entry.first)));
+		} else {
+			while (count > 0) {
+				int exponent = count < SCHAR_MAX ? count : SCHAR_MAX;
+				Ast power = makeUnary(OP_POWI, Ast(entry.first));
+				power.i = exponent;
+				product.children.emplace_back(move(power));
+				count -= exponent;
+			}
+		}
+	}
+
+	if (product.children.empty()) {
+		*ast = makeConstant(constant);
+		return;
+	}
+	Ast result;
+	if (product.children.size() == 1)
+		result = move(product.children[0]);
+	else
+		result = move(product);
+	if (constant == -1.0)
+		result = makeUnary(OP_NEG, move(result));
+	*ast = move(result);
+}
+
+void Optimizer::simplifyRelaxed(Ast *ast) {
+	matchAll([](Ast *ast) {
+		auto &children = ast->children;
+		switch (ast->op) {
+		case OP_ADD:
+			simplifySum(ast);
+			return;
+		case OP_MUL:
+			simplifyProduct(ast);
+			return;
+		case OP_SUB:
+		case OP_RSUB: {
+			size_t x = ast->op == OP_SUB ? 0 : 1;
+			if (children[0] == children[1]) {
+				*ast = makeConstant(0.0);
+			} else if (isConstant(children[1 - x], 0.0)) {
+				Ast minuend = move(children[x]);
+				*ast = move(minuend);
+			} else if (isConstant(children[x], 0.0)) {
+				Ast subtrahend = move(children[1 - x]);
+				*ast = makeUnary(OP_NEG, move(subtrahend));
+			}
+			return;
+		}
+		case OP_DIV:
+		case OP_RDIV: {
+			size_t x = ast->op == OP_DIV ? 0 : 1;
+			if (children[0] == children[1]) {
+				*ast = makeConstant(1.0);
+			} else if (isConstant(children[1 - x], 1.0)) {
+				Ast dividend = move(children[x]);
+				*ast = move(dividend);
+			} else if (isConstant(children[x], 0.0)) {
+				*ast = makeConstant(0.0);
+			}
+			return;
+		}
+		case OP_POW:
+			if (isConstant(children[1], 0.0))
+				*ast = makeConstant(1.0);
+			return;
+		case OP_RPOW:
+			if (isConstant(children[0], 0.0))
+				*ast = makeConstant(1.0);
+			return;
+		case OP_ABS:
+			// abs(abs(x)) => abs(x), abs(-x) => abs(x)
+			if (children[0].op == OP_ABS || children[0].op == OP_NEG) {
+				Ast x = move(children[0].children[0]);
+				children[0] = move(x);
+			}
+			return;
+		case OP_SQRT:
+			// sqrt(sq(x)) => abs(x)
+			if (children[0].op == OP_SQ) {
+				Ast x = move(children[0].children[0]);
+				*ast = makeUnary(OP_ABS, move(x));
+			}
+			return;
+		default:
+			if (children.size() == 1 && isInverse(ast->op, children[0].op)) {
+				Ast x = move(children[0].children[0]);
+				*ast = move(x);
+			}
+			return;
+		}
+	}, ast);
+}
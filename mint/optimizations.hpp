@@ -6,6 +6,8 @@
 #define OPTIMIZATIONS_HPP_
 
 #include "ast.hpp"
+#include "cost.hpp"
+#include "rules.hpp"
 
 #include <vector>
 
@@ -23,15 +25,75 @@ public:
 	/// -(-(x)) => x
 	void foldDoubleMinus(Ast *);
 
+	/// The three passes above as one rule set, applied in a single traversal.  Constants are
+	/// folded bottom up before the powers above them are rewritten, so pow(x, 1+1) => sq(x).
+	void normalize(Ast *);
+
 	/// a-b => a+(-b)
 	void SubtractionToSum(Ast *);
 
 	/// a+(b+c) => a+b+c
 	void FlattenSum(Ast *);
 
-	/// rebalances the AST, so calculations which require lots of space are done first.  This
-	/// can sometimes reduce the total necessary amount of space on the stack.
+	/// a+1+b+2 => a+3+b, and the same for the constant factors of products with more than two
+	/// operands.  Reassociates the constants, which can change the rounding.
+	void foldConstantOperands(Ast *);
+
+	/// Reorders operands, so calculations which require lots of space are done first
+	/// (Sethi-Ullman numbering).  Commutative binary operators swap their operands and SUB, DIV,
+	/// POW and the comparisons are replaced by their reversed versions, which gives the same
+	/// results.  The operands of n-ary sums and products produced by FlattenSum keep their
+	/// order.  Afterwards, stack_size_needed of every node is the stack depth needed to
+	/// evaluate it.
 	void compressStack(Ast *);
+
+	/// Like compressStack, but n-ary sums and products also move their most demanding child to
+	/// the front, which reassociates them and may change the rounding.
+	void compressStackRelaxed(Ast *);
+
+	/// Chooses between equivalent forms by their cost in the cost model.  Only uses rewrites that
+	/// give exactly the same results: x/c => x*(1/c) if 1/c is a power of two.
+	void rewriteByCost(Ast *);
+
+	/// Like rewriteByCost, but also uses rewrites that may change the rounding:
+	/// x/c => x*(1/c) for any c and exp(a)*exp(b) <=> exp(a+b).
+	void rewriteByCostRelaxed(Ast *);
+
+	/// cost model used by the cost driven rewrites
+	void setCostModel(const CostModel &model) { cost_model = model; }
+	const CostModel &getCostModel() const { return cost_model; }
+
+	/// Replaces common shapes with functions that are faster and more accurate, which may change
+	/// the rounding: log(1+x) => log1p(x), exp(x)-1 => expm1(x) and
+	/// sqrt(x*x+y*y) => hypot(x,y).
+	void recognizeIntrinsics(Ast *);
+
+	/// Applies the rules added to getRules() in a single traversal, see RuleSet.
+	void applyRules(Ast *);
+
+	/// user defined rewrite rules for applyRules
+	RuleSet &getRules() { return rules; }
+
+	/// Pairs sin(t) and cos(t) of the same t, so both are computed by a single OP_SINCOS or
+	/// OP_COSSIN node and t is evaluated once.  Each pair gets its own slot index.
+	void shareSinCos(Ast *);
+
+	/// Computes repeated subexpressions once, within an expression and across the outputs of a
+	/// program.  Every copy is wrapped in an OP_STORE node with the slot of the subexpression,
+	/// and the code generator loads the stored value for all copies but the first.  A copy is
+	/// only shared on its own if it occurs more often than its parent.
+	void shareSubexpressions(Ast *);
+
+	/// Algebraic simplifications that may change the results, e.g. for NaN, infinite or
+	/// rounded values: identities like x*1 and x-x, constants collected across flattened sums
+	/// and products, like terms merged (2*x + x => 3*x), common factors extracted
+	/// (a*x + b*x => x*(a+b)), repeated factors turned into powers and inverse functions
+	/// cancelled (exp(log(x)) => x).
+	void simplifyRelaxed(Ast *);
+
+private:
+	CostModel cost_model;
+	RuleSet rules;
 };
 
 #endif // OPTIMIZATIONS_HPP_
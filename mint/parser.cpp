@@ -5,12 +5,19 @@
 #include "parser.hpp"
 
 #include <stack>
+#include <stdexcept>
 
 #include "ast.hpp"
+#include "functions.hpp"
 #include "ops.hpp"
 
 using std::move;
 
+// functions of several arguments and user functions are only called with an argument list
+static bool needsArgumentList(int id) {
+	return id == TOK_F_POW || id == TOK_F_HYPOT || id == TOK_F_IF || id == TOK_F_CALL;
+}
+
 int Parser::parse() {
 	std::stack<Token> stack;
 	ast.op = OP_HLT;
@@ -21,12 +28,18 @@ int Parser::parse() {
 	while (tok.id != TOK_EOF) {
 		bool expectUnary = lastTokenId == TOK_LPAREN
 			|| lastTokenId == TOK_NONE
+			|| lastTokenId == TOK_COMMA
 			|| canBePrefix(lastTokenId)
 			|| canBeInfix(lastTokenId);
 		bool expectExpr = lastTokenId == TOK_NONE
 			|| lastTokenId == TOK_LPAREN
+			|| lastTokenId == TOK_COMMA
 			|| canBePrefix(lastTokenId)
 			|| canBeInfix(lastTokenId);
+		if (needsArgumentList(lastTokenId) && tok.id != TOK_LPAREN) {
+			raiseError("missing argument list");
+			return 1;
+		}
 		switch (tok.id) {
 
 			default:
@@ -56,13 +69,51 @@ int Parser::parse() {
 					raiseError("unexpected primary value");
 					return 1;
 				}
-				if (tok.i > UCHAR_MAX) {
+				if (findParameter(tok) >= 0) {
+					emitOp(OP_ARG, -(findParameter(tok) + 1));
+					break;
+				}
+				if (tok.i < 0) {
 					raiseError("argument number out of range");
 					return 1;
 				}
-				emitOp(OP_ARG, (unsigned char)(tok.i));
+				emitOp(OP_ARG, tok.i);
 				break;
 
+			case TOK_IDENT: {
+				if (findParameter(tok) >= 0) {
+					if (canBeValue(lastTokenId)) {
+						raiseError("unexpected primary value");
+						return 1;
+					}
+					emitOp(OP_ARG, -(findParameter(tok) + 1));
+					break;
+				}
+				size_t function = FunctionRegistry::NONE;
+				if (functions)
+					function = functions->find(std::string(tok.start, tok.len));
+				if (function == FunctionRegistry::NONE) {
+					raiseError("unknown identifier");
+					return 1;
+				}
+				if (functions->getParameterNumber(function) > 0) {
+					tok.id = TOK_F_CALL;
+					tok.i = long(function);
+					continue;
+				}
+
+				// named constants are values
+				if (canBeValue(lastTokenId)) {
+					raiseError("unexpected primary value");
+					return 1;
+				}
+				Ast value = functions->expand(function, {});
+				value.pos = tok.pos;
+				value.len = tok.len;
+				emitTree(move(value));
+				break;
+			}
+
 			case TOK_LIT:
 				if (canBeValue(lastTokenId)) {
 					raiseError("unexpected primary value");
@@ -96,6 +147,7 @@ int Parser::parse() {
 					raiseError("unexpected open parenthesis");
 					return 1;
 				}
+				tok.i = 1; // number of arguments, if this is a call
 				stack.push(tok);
 				break;
 
@@ -121,8 +173,15 @@ int Parser::parse() {
 			case TOK_F_CEIL:
 			case TOK_F_ROUND:
 			case TOK_F_TRUNC:
+			case TOK_F_LOG1P:
+			case TOK_F_EXPM1:
+			case TOK_F_CBRT:
 			case TOK_F_POW:
+			case TOK_F_HYPOT:
+			case TOK_F_IF:
+			case TOK_F_CALL:
 			case TOK_UN_NEG:
+			case TOK_UN_NOT:
 				if (canBeValue(lastTokenId)) {
 					raiseError("unexpected prefix operator");
 					return 1;
@@ -131,28 +190,53 @@ int Parser::parse() {
 				break;
 
 			case TOK_COMMA:
+				if (!canBeValue(lastTokenId)) {
+					raiseError("missing argument");
+					return 1;
+				}
 				while (stack.size() > 0 && stack.top().id != TOK_LPAREN) {
-					emitOp(getOperator(stack.top().id));
+					emitOperator(stack.top());
 					stack.pop();
 				}
-				if (stack.size() <= 0 || stack.top().id != TOK_LPAREN) {
-					raiseError("misplaced comma");
-					return 1;
-				}
+				// a comma at the top level separates the outputs, which are the children of the
+				// root
+				if (stack.size() <= 0)
+					break;
+				stack.top().i++;
 				break;
 
 			case TOK_RPAREN:
 				while (stack.size() > 0 && stack.top().id != TOK_LPAREN) {
-					emitOp(getOperator(stack.top().id));
+					emitOperator(stack.top());
 					stack.pop();
 				}
 				if (stack.size() <= 0 || stack.top().id != TOK_LPAREN) {
 					raiseError("mismatched parenthesis");
 					return 1;
 				}
-				stack.pop();
+				{
+					long arguments = stack.top().i;
+					stack.pop();
+					if (stack.size() > 0 && needsArgumentList(stack.top().id)) {
+						if (!canBeValue(lastTokenId)) {
+							raiseError("missing argument");
+							return 1;
+						}
+						size_t expected = stack.top().id == TOK_F_CALL ?
+							functions->getParameterNumber(stack.top().i) :
+							size_t(getOperandNumber(getOperator(stack.top().id)));
+						if (size_t(arguments) != expected) {
+							raiseError("wrong number of arguments");
+							return 1;
+						}
+					} else if (arguments != 1) {
+						// commas only separate outputs and the arguments of the functions above
+						raiseError("wrong number of arguments");
+						return 1;
+					}
+				}
 				while (stack.size() > 0 && canBePrefix(stack.top().id)) {
-					emitOp(getOperator(stack.top().id));
+					emitOperator(stack.top());
 					stack.pop();
 				}
 				break;
@@ -162,6 +246,14 @@ int Parser::parse() {
 			case TOK_OP_MUL:
 			case TOK_OP_DIV:
 			case TOK_OP_POW:
+			case TOK_OP_LT:
+			case TOK_OP_LE:
+			case TOK_OP_GT:
+			case TOK_OP_GE:
+			case TOK_OP_EQ:
+			case TOK_OP_NE:
+			case TOK_OP_AND:
+			case TOK_OP_OR:
 				if (!canBeValue(lastTokenId)) {
 					raiseError("unexpected operator");
 					return 1;
@@ -169,13 +261,13 @@ int Parser::parse() {
 				while (stack.size() > 0 && canBeOperation(stack.top().id)) {
 					if (isRightAssociative(tok.id)) {
 						if (getPrecedence(tok.id) < getPrecedence(stack.top().id)) {
-							emitOp(getOperator(stack.top().id));
+							emitOperator(stack.top());
 							stack.pop();
 						} else
 							break;
 					} else {
 						if (getPrecedence(tok.id) <= getPrecedence(stack.top().id)) {
-							emitOp(getOperator(stack.top().id));
+							emitOperator(stack.top());
 							stack.pop();
 						} else
 							break;
@@ -185,6 +277,8 @@ int Parser::parse() {
 				break;
 		}
 
+		if (error)
+			return 1;
 		lastTokenId = tok.id;
 		tok = tokenizer.getNextToken();
 	}
@@ -199,22 +293,54 @@ int Parser::parse() {
 			raiseError("mismatched parenthesis");
 			return 1;
 		} else {
-			emitOp(getOperator(stack.top().id));
+			emitOperator(stack.top());
 			stack.pop();
 		}
 	}
-	return 0;
+	return error ? 1 : 0;
 }
 
-void Parser::emitOp(Op op, int i) {
+// values are emitted while their token is the current one
+void Parser::emitOp(Op op, long i) {
 	Ast ast(op);
 	ast.i = i;
+	ast.pos = tok.pos;
+	ast.len = tok.len;
 	emitOp(move(ast));
 }
 
 void Parser::emitOp(Op op, double d) {
 	Ast ast(op);
 	ast.d = d;
+	ast.pos = tok.pos;
+	ast.len = tok.len;
+	emitOp(move(ast));
+}
+
+void Parser::emitOperator(const Token &token) {
+	if (token.id == TOK_F_CALL) {
+		size_t n = functions->getParameterNumber(size_t(token.i));
+		std::vector<Ast> arguments(n);
+		for (size_t i = 0; i < n; ++i) {
+			arguments[n - i - 1] = move(this->ast.children.back());
+			this->ast.children.pop_back();
+		}
+		Ast call;
+		try {
+			call = functions->expand(size_t(token.i), move(arguments));
+		} catch (const std::invalid_argument &) {
+			// the parse stops after this operator, a placeholder keeps the operands balanced
+			raiseError("function call expands to too many nodes");
+			call = Ast(OP_CONST);
+		}
+		call.pos = token.pos;
+		call.len = token.len;
+		emitTree(move(call));
+		return;
+	}
+	Ast ast(getOperator(token.id));
+	ast.pos = token.pos;
+	ast.len = token.len;
 	emitOp(move(ast));
 }
 
@@ -229,11 +355,32 @@ void Parser::emitOp(Ast &&ast) {
 	int n = getOperandNumber(ast.op);
 	ast.children.resize(n);
 	for (int i = 0; i < n; ++i) {
-		ast.children[n - i - 1] = this->ast.children.back();
+		ast.children[n - i - 1] = move(this->ast.children.back());
 		this->ast.children.pop_back();
 	}
-	this->ast.children.push_back(ast);
 	lastOp = ast.op;
+	this->ast.children.push_back(move(ast));
+}
+
+// emits a complete subtree, e.g. an inlined function
+void Parser::emitTree(Ast &&ast) {
+	lastOp = ast.op;
+	this->ast.children.push_back(move(ast));
+}
+
+// index of the parameter named by the token, or -1
+long Parser::findParameter(const Token &token) const {
+	if (!parameters)
+		return -1;
+	for (size_t k = 0; k < parameters->size(); ++k) {
+		const std::string &name = (*parameters)[k];
+		if (name.size() == size_t(token.len) && name.compare(0, name.size(), token.start,
+			token.len) == 0)
+		{
+			return long(k);
+		}
+	}
+	return -1;
 }
 
 void Parser::raiseError(const char *reason) {
@@ -10,11 +10,20 @@
 #include "ast.hpp"
 #include "tokenizer.hpp"
 
+#include <string>
 #include <vector>
 
+class FunctionRegistry;
+
 class Parser {
 public:
 	Parser(const char * str) : tokenizer(str) {}
+
+	/// Parses with calls to the given functions.  Names in parameters are parsed as the
+	/// parameters of a function body, see FunctionRegistry.
+	Parser(const char *str, const FunctionRegistry *functions,
+		const std::vector<std::string> *parameters = nullptr) :
+		tokenizer(str), functions(functions), parameters(parameters) {}
 	
 	int parse();
 	const char * getError() { return error; }
@@ -25,12 +34,17 @@ public:
 private:
 	void raiseError(const char * reason);
 	
-	void emitOp(Op op, int i = 0);
+	void emitOp(Op op, long i = 0);
 	void emitOp(Op op, double d);
 	void emitOp(const Ast &ast);
 	void emitOp(Ast &&ast);
+	void emitOperator(const Token &token);
+	void emitTree(Ast &&ast);
+	long findParameter(const Token &token) const;
 
 	Tokenizer tokenizer;
+	const FunctionRegistry *functions = nullptr;
+	const std::vector<std::string> *parameters = nullptr;
 	Token tok;
 	Ast ast;
 	int lastTokenId;
@@ -0,0 +1,148 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "passes.hpp"
+
+#include "program.hpp"
+
+#include <chrono>
+#include <stdexcept>
+
+struct PassData {
+	const char *name;
+	void (Optimizer::*pass)(Ast *);
+};
+
+static const PassData PASS_TABLE[] = {
+	{ "powi",               &Optimizer::optimizePowersToIntegerExponents },
+	{ "fold-constants",     &Optimizer::foldConstants },
+	{ "fold-double-minus",  &Optimizer::foldDoubleMinus },
+	{ "normalize",          &Optimizer::normalize },
+	{ "subtraction-to-sum", &Optimizer::SubtractionToSum },
+	{ "flatten-sum",        &Optimizer::FlattenSum },
+	{ "fold-constant-operands", &Optimizer::foldConstantOperands },
+	{ "rewrite-by-cost",    &Optimizer::rewriteByCost },
+	{ "rewrite-by-cost-relaxed", &Optimizer::rewriteByCostRelaxed },
+	{ "simplify-relaxed",   &Optimizer::simplifyRelaxed },
+	{ "intrinsics",         &Optimizer::recognizeIntrinsics },
+	{ "rules",              &Optimizer::applyRules },
+	{ "share-sincos",       &Optimizer::shareSinCos },
+	{ "share-subexpressions", &Optimizer::shareSubexpressions },
+	{ "compress-stack",     &Optimizer::compressStack },
+	{ "compress-stack-relaxed", &Optimizer::compressStackRelaxed },
+};
+
+static size_t countNodes(const Ast &root) {
+	size_t count = 0;
+	std::vector<const Ast *> stack;
+	stack.push_back(&root);
+	while (stack.size() > 0) {
+		const Ast *ast = stack.back();
+		stack.pop_back();
+		++count;
+		for (const Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	return count;
+}
+
+PassManager PassManager::forLevel(int optimize, PassGroup group) {
+	// the passes that rewrite the tree, and the ones that share work and order the operands
+	// for the stack, which run last
+	const char *rewrites = "";
+	const char *sharing = "";
+	size_t iterations = 8;
+	switch (optimize) {
+	default:
+	case Program::OPTIMIZE_NOTHING:
+		break;
+	case Program::OPTIMIZE_MANDATORY:
+		rewrites = "powi";
+		iterations = 1;
+		break;
+	case Program::OPTIMIZE_STRICT:
+		rewrites = "normalize,rewrite-by-cost";
+		sharing = "share-sincos,share-subexpressions,compress-stack";
+		iterations = 1;
+		break;
+	case Program::OPTIMIZE_PRECISE:
+		// the strict passes until the tree stops changing, none of them changes the rounding
+		rewrites = "normalize,rewrite-by-cost";
+		sharing = "share-sincos,share-subexpressions,compress-stack";
+		break;
+	case Program::OPTIMIZE_FAST:
+		// rewrites are chosen by cost even if they change the rounding
+		rewrites = "normalize,subtraction-to-sum,flatten-sum,simplify-relaxed,intrinsics,"
+			"rewrite-by-cost-relaxed,normalize,fold-constant-operands";
+		sharing = "share-sincos,share-subexpressions,compress-stack-relaxed";
+		break;
+	}
+
+	PassManager manager;
+	if (group != SHARING_PASSES)
+		manager.addPasses(rewrites);
+	if (group != REWRITE_PASSES)
+		manager.addPasses(sharing);
+	manager.setMaxIterations(group == SHARING_PASSES ? 1 : iterations);
+	return manager;
+}
+
+std::vector<std::string> PassManager::getPassNames() {
+	std::vector<std::string> names;
+	for (const PassData &data : PASS_TABLE)
+		names.push_back(data.name);
+	return names;
+}
+
+void PassManager::addPass(const std::string &name) {
+	for (const PassData &data : PASS_TABLE) {
+		if (name == data.name) {
+			passes.push_back(data.pass);
+			statistics.emplace_back();
+			statistics.back().name = name;
+			return;
+		}
+	}
+	throw std::invalid_argument("unknown optimization pass");
+}
+
+void PassManager::addPasses(const char *pipeline) {
+	std::string name;
+	for (const char *c = pipeline; ; ++c) {
+		if (*c == ',' || *c == '\0') {
+			if (!name.empty())
+				addPass(name);
+			name.clear();
+			if (*c == '\0')
+				break;
+		} else if (*c != ' ') {
+			name += *c;
+		}
+	}
+}
+
+void PassManager::run(Ast *ast) {
+	typedef std::chrono::steady_clock Clock;
+	iterations = 0;
+	size_t nodes = countNodes(*ast);
+	while (iterations < max_iterations && passes.size() > 0) {
+		// The pipeline is repeated while the tree changes, which is detected by its hash, as a
+		// copy to compare with would take as long to make as some of the passes.
+		bool repeat = iterations + 1 < max_iterations;
+		size_t before = repeat ? ast->hash() : 0;
+		for (size_t i = 0; i < passes.size(); ++i) {
+			Statistics &stats = statistics[i];
+			Clock::time_point start = Clock::now();
+			(optimizer.*passes[i])(ast);
+			stats.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+			stats.runs++;
+			stats.nodes_before = nodes;
+			nodes = countNodes(*ast);
+			stats.nodes_after = nodes;
+		}
+		++iterations;
+		if (!repeat || ast->hash() == before)
+			break;
+	}
+}
@@ -0,0 +1,76 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef PASSES_HPP_
+#define PASSES_HPP_
+
+#include "ast.hpp"
+#include "optimizations.hpp"
+
+#include <string>
+#include <vector>
+
+/// Runs a pipeline of named optimizer passes on a tree.  The pipeline is repeated until the tree
+/// stops changing or the iteration limit is reached, and the time spent in every pass and the
+/// number of nodes it leaves behind are recorded.
+class PassManager {
+public:
+	struct Statistics {
+		std::string name;
+		size_t runs = 0;
+		double seconds = 0.0;
+		size_t nodes_before = 0; // number of nodes before and after the last run
+		size_t nodes_after = 0;
+	};
+
+	/// parts of the pipeline of an optimization level
+	enum PassGroup {
+		ALL_PASSES,
+		REWRITE_PASSES, // the passes that rewrite the tree
+		SHARING_PASSES, // the passes that share work and order operands, which come last
+	};
+
+	PassManager() = default;
+
+	/// The pipeline used by Program for one of the Program::Optimizations levels, or a part of
+	/// it.  The sharing passes on their own are run once.
+	static PassManager forLevel(int optimize, PassGroup group = ALL_PASSES);
+
+	/// names of all passes that can be added to a pipeline
+	static std::vector<std::string> getPassNames();
+
+	/// Appends the pass with the given name.  Throws std::invalid_argument for unknown names.
+	void addPass(const std::string &name);
+
+	/// Appends a comma separated list of pass names, e.g. "powi,fold-constants".
+	void addPasses(const char *pipeline);
+
+	/// maximum number of times the pipeline is run, 1 runs every pass once
+	void setMaxIterations(size_t iterations) { max_iterations = iterations; }
+
+	/// cost model for the rewrite-by-cost passes
+	void setCostModel(const CostModel &model) { optimizer.setCostModel(model); }
+
+	/// rules applied by the "rules" pass, e.g. getRules().addRule("x*0", "0")
+	RuleSet &getRules() { return optimizer.getRules(); }
+
+	void run(Ast *ast);
+
+	/// statistics per pass of the pipeline, accumulated over all runs
+	const std::vector<Statistics> &getStatistics() const { return statistics; }
+
+	/// number of times the pipeline was run by the last call to run()
+	size_t getIterations() const { return iterations; }
+
+private:
+	typedef void (Optimizer::*Pass)(Ast *);
+
+	Optimizer optimizer;
+	std::vector<Pass> passes;
+	std::vector<Statistics> statistics;
+	size_t max_iterations = 8;
+	size_t iterations = 0;
+};
+
+#endif // PASSES_HPP_
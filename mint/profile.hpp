@@ -0,0 +1,81 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef PROFILE_HPP_
+#define PROFILE_HPP_
+
+// Profiling is compiled in only if MINT_PROFILE is defined.  Otherwise, this header only
+// declares the data types and the interpreter is not instrumented at all.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef MINT_PROFILE
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+#endif
+
+/// Execution counts and time stamp counter cycles, collected per bytecode offset.
+struct Profile {
+	struct Counter {
+		uint64_t executions = 0; // once per row for scalar runs and once per block otherwise
+		uint64_t rows = 0;
+		uint64_t cycles = 0;
+	};
+	std::vector<Counter> offsets;
+
+	void reset() { offsets.assign(offsets.size(), Counter()); }
+	void add(const Profile &other) {
+		if (offsets.size() < other.offsets.size())
+			offsets.resize(other.offsets.size());
+		for (size_t i = 0; i < other.offsets.size(); ++i) {
+			offsets[i].executions += other.offsets[i].executions;
+			offsets[i].rows += other.offsets[i].rows;
+			offsets[i].cycles += other.offsets[i].cycles;
+		}
+	}
+};
+
+#ifdef MINT_PROFILE
+
+inline uint64_t readTimestamp() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return uint64_t(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/// Charges the cycles between two dispatched instructions to the earlier one.
+class ProfileTimer {
+public:
+	ProfileTimer(Profile &profile, size_t rows) : profile(profile), rows(rows) {}
+
+	void dispatch(size_t offset) {
+		uint64_t now = readTimestamp();
+		if (last != SIZE_MAX)
+			profile.offsets[last].cycles += now - time;
+		Profile::Counter &counter = profile.offsets[offset];
+		counter.executions++;
+		counter.rows += rows;
+		last = offset;
+		time = now;
+	}
+
+private:
+	Profile &profile;
+	size_t rows;
+	size_t last = SIZE_MAX;
+	uint64_t time = 0;
+};
+
+#endif // MINT_PROFILE
+
+#endif // PROFILE_HPP_
@@ -9,81 +9,347 @@
 #include "tokens.hpp"
 #include "parser.hpp"
 
-#include "optimizations.hpp"
+#include "passes.hpp"
+#include "verifier.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
 #include <climits>
 #include <cmath>
-#include <functional>
+#include <cstdint>
+#include <unordered_map>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using std::move;
+
+const size_t Program::BLOCK_SIZE;
+
+// number of rows the batch interpreter processes with each instruction
+static const size_t BLOCK_SIZE = Program::BLOCK_SIZE;
 
 Program::Program(const char * src, int optimize) {
-	Parser parser(src);
+#ifdef MINT_PROFILE
+	source = src;
+#endif
+	Ast ast = parse(src);
+	applyOptimizations(&ast, optimize);
+	generateCode(ast);
+	verify();
+}
+
+Program::Program(const char *src, const FunctionRegistry &functions, int optimize) {
+#ifdef MINT_PROFILE
+	source = src;
+#endif
+	Ast ast = parse(src, &functions);
+	applyOptimizations(&ast, optimize);
+	generateCode(ast, &functions);
+	verify();
+}
+
+Program::Program(const char *src, PassManager &passes) {
+#ifdef MINT_PROFILE
+	source = src;
+#endif
+	Ast ast = parse(src);
+	passes.run(&ast);
+	generateCode(ast);
+	verify();
+}
+
+Program::Program(const Ast &ast, const FunctionRegistry *functions) {
+	generateCode(ast, functions);
+	verify();
+}
+
+Ast Program::parse(const char *src, const FunctionRegistry *functions) {
+	Parser parser(src, functions);
 	if (parser.parse()) {
 		//printf("Error: %s\n", parser.getError());
 		//printf("%s\n", src);
 		//printf("%*s\n\n", parser.getLastToken().pos + 1, "^");
 		throw std::invalid_argument("parsing error");
 	}
+	return move(parser.getAst());
+}
 
-	Ast ast = parser.getAst();
-
-	Optimizer optimizer;
-	switch (optimize) {
-	default:
-	case OPTIMIZE_NOTHING:
-		break;
-	case OPTIMIZE_MANDATORY:
-		optimizer.optimizePowersToIntegerExponents(&ast);
-		break;
-	case OPTIMIZE_STRICT:
-		optimizer.optimizePowersToIntegerExponents(&ast);
-		optimizer.foldConstants(&ast);
-		optimizer.foldDoubleMinus(&ast);
-		optimizer.compressStack(&ast);
-		break;
-	}
-
-	auto program_p = &program;
-	auto constants_p = &constants;
-	std::function<void(const Ast &ast)> visitor_lambda =
-	[program_p, constants_p, &visitor_lambda](const Ast &ast) {
-		for (const Ast &child : ast.children) {
-			visitor_lambda(child);
-		}
-		if (ast.op != OP_NOOP)
-			program_p->push_back(ast.op);
-		switch (ast.op) {
-		case OP_CONST: {
-			// prevent the exact same constant from being stored twice
-			int constant_index = -1;
-			for (unsigned i = 0; i < constants_p->size(); ++i) {
-				double c = (*constants_p)[i];
-				if (ast.d == c) {
-					constant_index = i;
-					break;
-				}
+void Program::applyOptimizations(Ast *ast, int optimize) {
+	PassManager passes = PassManager::forLevel(optimize);
+	passes.run(ast);
+}
+
+void Program::generateCode(const Ast &root, const FunctionRegistry *functions) {
+	// constants are pooled by their bit pattern, so -0.0 and 0.0 stay distinct
+	std::unordered_map<uint64_t, size_t> constant_pool;
+	// index of every called native function in the table of this program
+	std::unordered_map<long, size_t> native_table;
+
+	// post-order traversal with an explicit stack, so deep expressions can't overflow the
+	// native stack
+	struct CodegenState {
+		const Ast *ast;
+		size_t index;
+	};
+	// operations with several results store their second result in the slot given by their
+	// pair index.  Whichever node of a pair comes first computes both results, the other one
+	// just loads the stored value.  Shared subexpressions work the same way, every copy of the
+	// subexpression is wrapped in an OP_STORE node and all but the first one are loaded.
+	bool slot_stored[UINT8_MAX + 1] = {};
+	output_number = root.op == OP_HLT && root.children.size() > 1 ? root.children.size() : 1;
+
+	std::vector<CodegenState> stack;
+	stack.push_back({ &root, 0 });
+	while (stack.size() > 0) {
+		const Ast *ast = stack.back().ast;
+		size_t index = stack.back().index;
+
+		bool has_slot = ast->op == OP_SINCOS || ast->op == OP_COSSIN || ast->op == OP_STORE;
+		if (has_slot && index == 0 && slot_stored[ast->i]) {
+			stack.pop_back();
+			program.push_back(OP_LOAD);
+			program.push_back((unsigned char)ast->i);
+#ifdef MINT_PROFILE
+			source_ranges.resize(program.size(), { ast->pos, ast->len });
+#endif
+			continue;
+		}
+
+		// n-ary sums and products are evaluated as a chain of binary operations
+		bool is_chain = (ast->op == OP_ADD || ast->op == OP_MUL) && ast->children.size() > 2;
+
+		if (index < ast->children.size()) {
+			if (is_chain && index >= 2) {
+				program.push_back(ast->op);
+#ifdef MINT_PROFILE
+				source_ranges.resize(program.size(), { ast->pos, ast->len });
+#endif
 			}
-			if (constant_index >= 0) {
-				program_p->push_back((unsigned char)constant_index);
+			stack.back().index++;
+			stack.push_back({ &ast->children[index], 0 });
+			continue;
+		}
+		stack.pop_back();
+
+		switch (ast->op) {
+		case OP_NOOP:
+			break;
+		case OP_CONST: {
+			uint64_t bits;
+			memcpy(&bits, &ast->d, sizeof(bits));
+			auto it = constant_pool.find(bits);
+			size_t constant_index;
+			if (it != constant_pool.end()) {
+				constant_index = it->second;
 			} else {
-				program_p->push_back((unsigned char)constants_p->size());
-				constants_p->push_back(ast.d);
+				constant_index = constants.size();
+				constants.push_back(ast->d);
+				constant_pool.emplace(bits, constant_index);
 			}
+			emitIndexed(OP_CONST, OP_CONST16, OP_CONST32, constant_index);
 			break;
 		}
 		case OP_ARG:
-			program_p->push_back((unsigned char)(ast.i));
+			emitIndexed(OP_ARG, OP_ARG16, OP_ARG32, size_t(ast->i));
 			break;
 		case OP_POWI:
-			program_p->push_back((unsigned char)(ast.i - SCHAR_MIN));
+			program.push_back(ast->op);
+			program.push_back((unsigned char)(ast->i - SCHAR_MIN));
 			break;
+		case OP_SINCOS:
+		case OP_COSSIN:
+		case OP_STORE:
+			program.push_back(ast->op);
+			program.push_back((unsigned char)ast->i);
+			slot_stored[ast->i] = true;
+			break;
+		case OP_CALL: {
+			if (!functions || ast->i < 0 || size_t(ast->i) >= functions->getFunctionNumber() ||
+				!functions->isNative(size_t(ast->i)) ||
+				functions->getParameterNumber(size_t(ast->i)) != ast->children.size())
+			{
+				throw std::invalid_argument("call to an unknown native function");
+			}
+			auto it = native_table.find(ast->i);
+			if (it == native_table.end()) {
+				if (natives.size() > UINT8_MAX)
+					throw std::invalid_argument("too many native functions");
+				it = native_table.emplace(ast->i, natives.size()).first;
+				natives.push_back(functions->getNative(size_t(ast->i)));
+			}
+			program.push_back(OP_CALL);
+			program.push_back((unsigned char)it->second);
+			program.push_back((unsigned char)ast->children.size());
+			break;
+		}
 		default:
+			program.push_back(ast->op);
 			break;
 		}
+#ifdef MINT_PROFILE
+		source_ranges.resize(program.size(), { ast->pos, ast->len });
+#endif
+	}
+}
+
+// emits an instruction with the smallest encoding that can hold the index
+void Program::emitIndexed(Op op8, Op op16, Op op32, size_t index) {
+	int size;
+	if (index <= UINT8_MAX) {
+		program.push_back(op8);
+		size = 1;
+	} else if (index <= UINT16_MAX) {
+		program.push_back(op16);
+		size = 2;
+	} else if (index <= UINT32_MAX) {
+		program.push_back(op32);
+		size = 4;
+	} else {
+		throw std::invalid_argument("index out of range");
+	}
+	for (int i = 0; i < size; ++i)
+		program.push_back((unsigned char)(index >> (8 * i)));
+}
+
+void Program::verify() {
+	std::vector<size_t> arities;
+	for (const NativeFunction &native : natives)
+		arities.push_back(native.parameters);
+	Verifier verifier(program.data(), program.size(), constants.size(), move(arities),
+		output_number);
+	if (verifier.verify()) {
+		//printf("Error: %s at offset %d\n", verifier.getError(), (int)verifier.getErrorOffset());
+		throw std::invalid_argument("verification error");
+	}
+	stack.assign(verifier.getStackSize(), 0.0);
+	slots.assign(verifier.getSlotNumber(), 0.0);
+	argument_number = verifier.getArgumentNumber();
+	used_arguments = verifier.getUsedArguments();
+	buildTape();
+}
+
+// Translates the verified bytecode into single assignment form by tracking which tape entry
+// each stack value and slot holds.
+void Program::buildTape() {
+	tape.clear();
+	argument_entries.assign(argument_number, size_t(-1));
+	std::vector<size_t> entries; // the stack
+	std::vector<size_t> slot_entries(slots.size());
+	auto add = [this](Op op, std::initializer_list<size_t> operands) {
+		TapeEntry entry = { op, false, 0, 0.0, { 0, 0, 0 } };
+		size_t k = 0;
+		for (size_t operand : operands) {
+			entry.operands[k++] = operand;
+			entry.depends = entry.depends || tape[operand].depends;
+		}
+		tape.push_back(entry);
+		return tape.size() - 1;
 	};
 
-	visitor_lambda(ast);
+	for (size_t offset = 0; offset < program.size();
+		offset += 1 + getImmediateSize(program[offset]))
+	{
+		Op op = Op(program[offset]);
+		const unsigned char *ip = program.data() + offset + 1;
+		switch (op) {
+		case OP_HLT:
+			output_entry = entries[0];
+			break;
+		case OP_NOOP:
+			break;
+		case OP_CONST:
+		case OP_CONST16:
+		case OP_CONST32:
+		case OP_PI:
+		case OP_E: {
+			size_t entry = add(OP_CONST, {});
+			if (op == OP_PI)
+				tape[entry].value = pi_impl<double>();
+			else if (op == OP_E)
+				tape[entry].value = e_impl<double>();
+			else
+				tape[entry].value = constants[readImmediate(ip, getImmediateSize(op))];
+			entries.push_back(entry);
+			break;
+		}
+		case OP_ARG:
+		case OP_ARG16:
+		case OP_ARG32: {
+			size_t index = readImmediate(ip, getImmediateSize(op));
+			if (argument_entries[index] == size_t(-1)) {
+				argument_entries[index] = add(OP_ARG, {});
+				tape.back().immediate = long(index);
+				tape.back().depends = true;
+			}
+			entries.push_back(argument_entries[index]);
+			break;
+		}
+		case OP_LOAD:
+			entries.push_back(slot_entries[*ip]);
+			break;
+		case OP_STORE:
+			slot_entries[*ip] = entries.back();
+			break;
+		case OP_SINCOS:
+		case OP_COSSIN: {
+			size_t x = entries.back();
+			size_t sin = add(OP_SIN, { x });
+			size_t cos = add(OP_COS, { x });
+			entries.back() = op == OP_SINCOS ? sin : cos;
+			slot_entries[*ip] = op == OP_SINCOS ? cos : sin;
+			break;
+		}
+		case OP_CALL:
+			// native functions have no derivative, the gradient can't be evaluated
+			has_calls = true;
+			tape.clear();
+			return;
+		default: {
+			size_t n = getOperandNumber(op);
+			size_t operands[3] = { 0, 0, 0 };
+			for (size_t k = 0; k < n; ++k)
+				operands[k] = entries[entries.size() - n + k];
+			entries.resize(entries.size() - n);
+			size_t entry;
+			if (n == 1)
+				entry = add(op, { operands[0] });
+			else if (n == 2)
+				entry = add(op, { operands[0], operands[1] });
+			else
+				entry = add(op, { operands[0], operands[1], operands[2] });
+			if (op == OP_POWI)
+				tape[entry].immediate = SCHAR_MIN + long(*ip);
+			switch (op) {
+			case OP_FLOOR: case OP_CEIL: case OP_ROUND: case OP_TRUNC: case OP_NOT:
+			case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE:
+			case OP_AND: case OP_OR:
+				tape[entry].depends = false; // step functions
+				break;
+			case OP_SELECT:
+				tape[entry].depends = tape[operands[1]].depends || tape[operands[2]].depends;
+				break;
+			default:
+				break;
+			}
+			entries.push_back(entry);
+			break;
+		}
+		}
+	}
+	for (size_t &entry : argument_entries) {
+		if (entry == size_t(-1))
+			entry = tape.size();
+	}
+}
+
+double Program::estimateCost(const CostModel &model) const {
+	double cost = 0.0;
+	for (size_t offset = 0; offset < program.size(); offset += 1 + getImmediateSize(program[offset]))
+		cost += model.getCost(program[offset]);
+	return cost;
 }
 
 void Program::print() {
@@ -94,109 +360,825 @@ void Program::print() {
 		printf("%-6s", getOperatorName(op));
 		switch (op) {
 		case OP_CONST:
-			printf("%-3i (%g)\n", (int) *ip, constants[*ip]);
-			ip++;
+		case OP_CONST16:
+		case OP_CONST32: {
+			size_t index = readImmediate(ip, getImmediateSize(op));
+			printf("%-3i (%g)\n", (int)index, constants[index]);
 			break;
+		}
 		case OP_ARG:
-			printf("%-3i\n", (int) *ip++);
+		case OP_ARG16:
+		case OP_ARG32:
+			printf("%-3i\n", (int)readImmediate(ip, getImmediateSize(op)));
 			break;
 		case OP_POWI:
-			printf("%-3i\n", SCHAR_MIN + int(*ip++));
+			printf("%-3i\n", SCHAR_MIN + int(*ip));
+			break;
+		case OP_LOAD:
+		case OP_SINCOS:
+		case OP_COSSIN:
+		case OP_STORE:
+			printf("%-3i\n", int(*ip));
+			break;
+		case OP_CALL:
+			printf("%-3i (%i arguments)\n", int(ip[0]), int(ip[1]));
 			break;
 		default:
 			printf("\n");
 			break;
 		}
+		ip += getImmediateSize(op);
 	} while (*ip != OP_HLT);
 }
 
-double Program::run(const double *arguments) {
-	unsigned char const *ip = program.data(); // instruction pointer
+std::string Program::getProfileReport(const Profile &profile) const {
+	std::string report;
+	char line[256];
+	size_t size = program.size() < profile.offsets.size() ? program.size() : profile.offsets.size();
+
+	// totals per opcode, most expensive first
+	std::vector<Profile::Counter> opcodes(OP_INVALID);
+	uint64_t total_cycles = 0;
+	for (size_t offset = 0; offset < size; offset += 1 + getImmediateSize(program[offset])) {
+		const Profile::Counter &counter = profile.offsets[offset];
+		Profile::Counter &sum = opcodes[program[offset]];
+		sum.executions += counter.executions;
+		sum.rows += counter.rows;
+		sum.cycles += counter.cycles;
+		total_cycles += counter.cycles;
+	}
+	std::vector<int> order;
+	for (int op = 0; op < OP_INVALID; ++op) {
+		if (opcodes[op].executions > 0)
+			order.push_back(op);
+	}
+	std::stable_sort(order.begin(), order.end(), [&opcodes](int lhs, int rhs) {
+		return opcodes[lhs].cycles > opcodes[rhs].cycles;
+	});
+	double scale = total_cycles > 0 ? 100.0 / double(total_cycles) : 0.0;
+
+	report += "opcode    executions         rows           cycles  cycles/row   share\n";
+	for (int op : order) {
+		const Profile::Counter &sum = opcodes[op];
+		snprintf(line, sizeof(line), "%-6s %13llu %12llu %16llu %11.2f %6.2f%%\n",
+			getOperatorName(op), (unsigned long long)sum.executions,
+			(unsigned long long)sum.rows, (unsigned long long)sum.cycles,
+			sum.rows > 0 ? double(sum.cycles) / double(sum.rows) : 0.0, sum.cycles * scale);
+		report += line;
+	}
+
+	report += "\noffset  opcode    executions         rows           cycles   share  source\n";
+	for (size_t offset = 0; offset < size; offset += 1 + getImmediateSize(program[offset])) {
+		const Profile::Counter &counter = profile.offsets[offset];
+		std::string text;
+		if (offset < source_ranges.size() && source_ranges[offset].first >= 0) {
+			size_t pos = size_t(source_ranges[offset].first);
+			text = std::to_string(pos);
+			if (pos < source.size())
+				text += " " + source.substr(pos, size_t(source_ranges[offset].second));
+		}
+		snprintf(line, sizeof(line), "%6u  %-6s %13llu %12llu %16llu %6.2f%%  ",
+			(unsigned)offset, getOperatorName(program[offset]),
+			(unsigned long long)counter.executions, (unsigned long long)counter.rows,
+			(unsigned long long)counter.cycles, counter.cycles * scale);
+		report += line;
+		report += text;
+		report += "\n";
+	}
+	return report;
+}
+
+// Runs a program that passed the Verifier.  Every opcode is known, every constant index is in
+// range and the stack has exactly the size the program needs, so this loop has no checks and no
+// exception paths, except for those thrown by native functions.  The argument loader maps an
+// argument index to its value.
+template <typename ArgumentLoader>
+static inline double execute(const unsigned char *ip, const double *constants,
+	const NativeFunction *natives, double *stack, double *slots, ArgumentLoader load_argument,
+	Profile *profile)
+{
 	double *sp = stack - 1; // stack pointer
+#ifdef MINT_PROFILE
+	const unsigned char *code = ip;
+	ProfileTimer timer(*profile, 1);
+#else
+	(void)profile;
+#endif
 
-	while (*ip != OP_HLT) {
+	for (;;) {
+#ifdef MINT_PROFILE
+		timer.dispatch(ip - code);
+#endif
 		Op op = Op(*ip++);
 		switch (op) {
-		case OP_NOOP:
+		case OP_HLT:   return stack[0];
+		case OP_NOOP:  break;
+
+		case OP_CONST: *++sp = constants[*ip++]; break;
+		case OP_ARG:   *++sp = load_argument(*ip++); break;
+
+		case OP_CONST16: *++sp = constants[readImmediate(ip, 2)]; ip += 2; break;
+		case OP_CONST32: *++sp = constants[readImmediate(ip, 4)]; ip += 4; break;
+		case OP_ARG16:   *++sp = load_argument(readImmediate(ip, 2)); ip += 2; break;
+		case OP_ARG32:   *++sp = load_argument(readImmediate(ip, 4)); ip += 4; break;
+		case OP_LOAD:    *++sp = slots[*ip++]; break;
+
+		case OP_PI:    *++sp = pi_impl<double>(); break;
+		case OP_E:     *++sp = e_impl<double>(); break;
+
+		case OP_NEG:   *sp = neg_impl(*sp); break;
+		case OP_INV:   *sp = inv_impl(*sp); break;
+		case OP_SQ:    *sp = sq_impl(*sp); break;
+		case OP_CU:    *sp = cu_impl(*sp); break;
+		case OP_SQRT:  *sp = sqrt_impl(*sp); break;
+		case OP_SIN:   *sp = sin_impl(*sp); break;
+		case OP_COS:   *sp = cos_impl(*sp); break;
+		case OP_TAN:   *sp = tan_impl(*sp); break;
+		case OP_ASIN:  *sp = asin_impl(*sp); break;
+		case OP_ACOS:  *sp = acos_impl(*sp); break;
+		case OP_ATAN:  *sp = atan_impl(*sp); break;
+		case OP_SINH:  *sp = sinh_impl(*sp); break;
+		case OP_COSH:  *sp = cosh_impl(*sp); break;
+		case OP_TANH:  *sp = tanh_impl(*sp); break;
+		case OP_ASINH: *sp = asinh_impl(*sp); break;
+		case OP_ACOSH: *sp = acosh_impl(*sp); break;
+		case OP_ATANH: *sp = atanh_impl(*sp); break;
+		case OP_EXP:   *sp = exp_impl(*sp); break;
+		case OP_LOG:   *sp = log_impl(*sp); break;
+		case OP_ERF:   *sp = erf_impl(*sp); break;
+		case OP_ERFC:  *sp = erfc_impl(*sp); break;
+		case OP_LOG1P: *sp = log1p_impl(*sp); break;
+		case OP_EXPM1: *sp = expm1_impl(*sp); break;
+		case OP_CBRT:  *sp = cbrt_impl(*sp); break;
+		case OP_ABS:   *sp = abs_impl(*sp); break;
+		case OP_FLOOR: *sp = floor_impl(*sp); break;
+		case OP_CEIL:  *sp = ceil_impl(*sp); break;
+		case OP_ROUND: *sp = round_impl(*sp); break;
+		case OP_TRUNC: *sp = trunc_impl(*sp); break;
+		case OP_NOT:   *sp = not_impl(*sp); break;
+		case OP_POWI:  *sp = pow(*sp, SCHAR_MIN + int(*ip++)); break;
+
+		case OP_ADD:   --sp; sp[0] = add_impl(sp[0], sp[1]); break;
+		case OP_SUB:   --sp; sp[0] = sub_impl(sp[0], sp[1]); break;
+		case OP_MUL:   --sp; sp[0] = mul_impl(sp[0], sp[1]); break;
+		case OP_DIV:   --sp; sp[0] = div_impl(sp[0], sp[1]); break;
+		case OP_POW:   --sp; sp[0] = pow_impl(sp[0], sp[1]); break;
+		case OP_HYPOT: --sp; sp[0] = hypot_impl(sp[0], sp[1]); break;
+		case OP_RSUB:  --sp; sp[0] = rsub_impl(sp[0], sp[1]); break;
+		case OP_RDIV:  --sp; sp[0] = rdiv_impl(sp[0], sp[1]); break;
+		case OP_RPOW:  --sp; sp[0] = rpow_impl(sp[0], sp[1]); break;
+		case OP_LT:    --sp; sp[0] = lt_impl(sp[0], sp[1]); break;
+		case OP_LE:    --sp; sp[0] = le_impl(sp[0], sp[1]); break;
+		case OP_GT:    --sp; sp[0] = gt_impl(sp[0], sp[1]); break;
+		case OP_GE:    --sp; sp[0] = ge_impl(sp[0], sp[1]); break;
+		case OP_EQ:    --sp; sp[0] = eq_impl(sp[0], sp[1]); break;
+		case OP_NE:    --sp; sp[0] = ne_impl(sp[0], sp[1]); break;
+		case OP_AND:   --sp; sp[0] = and_impl(sp[0], sp[1]); break;
+		case OP_OR:    --sp; sp[0] = or_impl(sp[0], sp[1]); break;
+
+		case OP_SELECT: sp -= 2; sp[0] = select_impl(sp[0], sp[1], sp[2]); break;
+
+		case OP_SINCOS: sincos_impl(*sp, sp, &slots[*ip++]); break;
+		case OP_COSSIN: sincos_impl(*sp, &slots[*ip++], sp); break;
+		case OP_STORE:  slots[*ip++] = *sp; break;
+
+		case OP_CALL: {
+			const NativeFunction &function = natives[ip[0]];
+			size_t n = ip[1];
+			ip += 2;
+			sp -= n - 1;
+			if (function.scalar) {
+				*sp = function.scalar(sp);
+			} else {
+				const double *arguments[FunctionRegistry::MAX_NATIVE_PARAMETERS];
+				for (size_t k = 0; k < n; ++k)
+					arguments[k] = sp + k;
+				double result;
+				function.block(arguments, &result, 1);
+				*sp = result;
+			}
 			break;
-		case OP_CONST:
-			*++sp = constants[*ip++];
+		}
+
+		default:       break; // rejected by the verifier
+		}
+	}
+}
+
+double Program::run(const double *arguments) {
+#ifdef MINT_PROFILE
+	context.profile.offsets.resize(program.size());
+#endif
+	return execute(program.data(), constants.data(), natives.data(), stack.data(), slots.data(),
+		[arguments](size_t i) { return arguments[i]; }, &context.profile);
+}
+
+// the outputs are left on the stack in order
+void Program::run(const double *arguments, double *outputs) {
+	outputs[0] = run(arguments);
+	for (size_t k = 1; k < output_number; ++k)
+		outputs[k] = stack[k];
+}
+
+// The block interpreter executes each instruction on a whole block of rows before moving on to
+// the next one, so dispatch overhead is paid once per block and the inner loops can be
+// vectorized.  Every stack slot owns one block sized buffer.  The stack holds pointers to the
+// current values of each slot, which lets dense double columns be used without copying them.
+
+template <double (*F)(double)>
+static inline void applyUnary(const double **sp, double *buffer, size_t count) {
+	const double *x = sp[0];
+	for (size_t j = 0; j < count; ++j)
+		buffer[j] = F(x[j]);
+	sp[0] = buffer;
+}
+
+template <double (*F)(double, double)>
+static inline void applyBinary(const double **sp, double *buffer, size_t count) {
+	const double *x = sp[0];
+	const double *y = sp[1];
+	for (size_t j = 0; j < count; ++j)
+		buffer[j] = F(x[j], y[j]);
+	sp[0] = buffer;
+}
+
+template <double (*F)(double, double, double)>
+static inline void applyTernary(const double **sp, double *buffer, size_t count) {
+	const double *x = sp[0];
+	const double *y = sp[1];
+	const double *z = sp[2];
+	for (size_t j = 0; j < count; ++j)
+		buffer[j] = F(x[j], y[j], z[j]);
+	sp[0] = buffer;
+}
+
+// computes the sine and the cosine of a block, the first result of the pair into buffer and the
+// second one into other
+template <bool SINE_FIRST>
+static inline void applySinCos(const double **sp, double *buffer, double *other, size_t count) {
+	const double *x = sp[0];
+	double *sines = SINE_FIRST ? buffer : other;
+	double *cosines = SINE_FIRST ? other : buffer;
+	for (size_t j = 0; j < count; ++j)
+		sincos_impl(x[j], &sines[j], &cosines[j]);
+	sp[0] = buffer;
+}
+
+static inline void fill(double *buffer, size_t count, double value) {
+	for (size_t j = 0; j < count; ++j)
+		buffer[j] = value;
+}
+
+// Runs a verified program on a block of count rows and returns the stack, which holds a pointer
+// to the results of each output.  The
+// argument loader gets an argument index and a scratch buffer and returns a pointer to the
+// block of argument values, which either points to the scratch buffer or into the input.
+// buffers holds one more block than the stack has slots, for the results of native functions.
+template <typename ArgumentLoader>
+static inline const double **executeBlock(const unsigned char *ip, const double *constants,
+	const NativeFunction *natives, double *buffers, const double **stack, double *slots,
+	size_t count, ArgumentLoader load_argument, Profile *profile)
+{
+	const double **sp = stack - 1; // stack pointer
+#ifdef MINT_PROFILE
+	const unsigned char *code = ip;
+	ProfileTimer timer(*profile, count);
+#else
+	(void)profile;
+#endif
+
+	for (;;) {
+#ifdef MINT_PROFILE
+		timer.dispatch(ip - code);
+#endif
+		Op op = Op(*ip++);
+		// pushed values go to next, unary operations write to the buffer of the top slot and
+		// binary operations to the buffer of the slot below
+		double *next = buffers + (sp + 1 - stack) * BLOCK_SIZE;
+		double *buffer = next - BLOCK_SIZE;
+		switch (op) {
+		case OP_HLT:   return stack;
+		case OP_NOOP:  break;
+
+		case OP_CONST:   fill(next, count, constants[*ip++]); *++sp = next; break;
+		case OP_CONST16: fill(next, count, constants[readImmediate(ip, 2)]); ip += 2; *++sp = next; break;
+		case OP_CONST32: fill(next, count, constants[readImmediate(ip, 4)]); ip += 4; *++sp = next; break;
+		case OP_ARG:     *++sp = load_argument(*ip++, next); break;
+		case OP_ARG16:   *++sp = load_argument(readImmediate(ip, 2), next); ip += 2; break;
+		case OP_ARG32:   *++sp = load_argument(readImmediate(ip, 4), next); ip += 4; break;
+		case OP_LOAD:    *++sp = slots + *ip++ * BLOCK_SIZE; break;
+
+		case OP_PI:    fill(next, count, pi_impl<double>()); *++sp = next; break;
+		case OP_E:     fill(next, count, e_impl<double>()); *++sp = next; break;
+
+		case OP_NEG:   applyUnary<neg_impl<double>>(sp, buffer, count); break;
+		case OP_INV:   applyUnary<inv_impl<double>>(sp, buffer, count); break;
+		case OP_SQ:    applyUnary<sq_impl<double>>(sp, buffer, count); break;
+		case OP_CU:    applyUnary<cu_impl<double>>(sp, buffer, count); break;
+		case OP_SQRT:  applyUnary<sqrt_impl<double>>(sp, buffer, count); break;
+		case OP_SIN:   applyUnary<sin_impl<double>>(sp, buffer, count); break;
+		case OP_COS:   applyUnary<cos_impl<double>>(sp, buffer, count); break;
+		case OP_TAN:   applyUnary<tan_impl<double>>(sp, buffer, count); break;
+		case OP_ASIN:  applyUnary<asin_impl<double>>(sp, buffer, count); break;
+		case OP_ACOS:  applyUnary<acos_impl<double>>(sp, buffer, count); break;
+		case OP_ATAN:  applyUnary<atan_impl<double>>(sp, buffer, count); break;
+		case OP_SINH:  applyUnary<sinh_impl<double>>(sp, buffer, count); break;
+		case OP_COSH:  applyUnary<cosh_impl<double>>(sp, buffer, count); break;
+		case OP_TANH:  applyUnary<tanh_impl<double>>(sp, buffer, count); break;
+		case OP_ASINH: applyUnary<asinh_impl<double>>(sp, buffer, count); break;
+		case OP_ACOSH: applyUnary<acosh_impl<double>>(sp, buffer, count); break;
+		case OP_ATANH: applyUnary<atanh_impl<double>>(sp, buffer, count); break;
+		case OP_EXP:   applyUnary<exp_impl<double>>(sp, buffer, count); break;
+		case OP_LOG:   applyUnary<log_impl<double>>(sp, buffer, count); break;
+		case OP_ERF:   applyUnary<erf_impl<double>>(sp, buffer, count); break;
+		case OP_ERFC:  applyUnary<erfc_impl<double>>(sp, buffer, count); break;
+		case OP_LOG1P: applyUnary<log1p_impl<double>>(sp, buffer, count); break;
+		case OP_EXPM1: applyUnary<expm1_impl<double>>(sp, buffer, count); break;
+		case OP_CBRT:  applyUnary<cbrt_impl<double>>(sp, buffer, count); break;
+		case OP_ABS:   applyUnary<abs_impl<double>>(sp, buffer, count); break;
+		case OP_FLOOR: applyUnary<floor_impl<double>>(sp, buffer, count); break;
+		case OP_CEIL:  applyUnary<ceil_impl<double>>(sp, buffer, count); break;
+		case OP_ROUND: applyUnary<round_impl<double>>(sp, buffer, count); break;
+		case OP_TRUNC: applyUnary<trunc_impl<double>>(sp, buffer, count); break;
+		case OP_NOT:   applyUnary<not_impl<double>>(sp, buffer, count); break;
+		case OP_POWI: {
+			const double *x = sp[0];
+			int exponent = SCHAR_MIN + int(*ip++);
+			for (size_t j = 0; j < count; ++j)
+				buffer[j] = pow(x[j], exponent);
+			sp[0] = buffer;
+			break;
+		}
+
+		case OP_ADD:   --sp; applyBinary<add_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_SUB:   --sp; applyBinary<sub_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_MUL:   --sp; applyBinary<mul_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_DIV:   --sp; applyBinary<div_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_POW:   --sp; applyBinary<pow_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_HYPOT: --sp; applyBinary<hypot_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_RSUB:  --sp; applyBinary<rsub_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_RDIV:  --sp; applyBinary<rdiv_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_RPOW:  --sp; applyBinary<rpow_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_LT:    --sp; applyBinary<lt_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_LE:    --sp; applyBinary<le_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_GT:    --sp; applyBinary<gt_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_GE:    --sp; applyBinary<ge_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_EQ:    --sp; applyBinary<eq_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_NE:    --sp; applyBinary<ne_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_AND:   --sp; applyBinary<and_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+		case OP_OR:    --sp; applyBinary<or_impl<double>>(sp, buffer - BLOCK_SIZE, count); break;
+
+		case OP_SELECT: sp -= 2; applyTernary<select_impl<double>>(sp, buffer - 2 * BLOCK_SIZE, count); break;
+
+		case OP_SINCOS: applySinCos<true>(sp, buffer, slots + *ip++ * BLOCK_SIZE, count); break;
+		case OP_COSSIN: applySinCos<false>(sp, buffer, slots + *ip++ * BLOCK_SIZE, count); break;
+		case OP_STORE:  memcpy(slots + *ip++ * BLOCK_SIZE, sp[0], count * sizeof(double)); break;
+
+		case OP_CALL: {
+			// the arguments may point into the buffer of the result slot, so the function writes
+			// to the free buffer above the top and the results are copied down
+			const NativeFunction &function = natives[ip[0]];
+			size_t n = ip[1];
+			ip += 2;
+			sp -= n - 1;
+			function.block(sp, next, count);
+			double *result = buffer - (n - 1) * BLOCK_SIZE;
+			memcpy(result, next, count * sizeof(double));
+			sp[0] = result;
 			break;
+		}
+
+		default:       break; // rejected by the verifier
+		}
+	}
+}
+
+static inline int countTrailingZeros(uint64_t bits) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return int(index);
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+static inline void checkResultType(const ResultView &result) {
+	if (result.type != TYPE_FLOAT64 && result.type != TYPE_FLOAT32)
+		throw std::invalid_argument("unsupported result type");
+}
+
+const double *Program::runBlock(Context &context, const ColumnView *arguments, size_t first,
+	const size_t *rows, size_t count) const
+{
+	return runBlockOutputs(context, arguments, first, rows, count)[0];
+}
+
+const double *const *Program::runBlockOutputs(Context &context, const ColumnView *arguments,
+	size_t first, const size_t *rows, size_t count) const
+{
+	// one block of values per stack slot, and a pointer to the current values of each slot,
+	// which may point directly into an input column
+	if (context.stack.size() < stack.size()) {
+		context.buffers.resize((stack.size() + 1) * BLOCK_SIZE);
+		context.stack.resize(stack.size());
+	}
+	if (context.slots.size() < slots.size() * BLOCK_SIZE)
+		context.slots.resize(slots.size() * BLOCK_SIZE);
+#ifdef MINT_PROFILE
+	context.profile.offsets.resize(program.size());
+#endif
+	return executeBlock(program.data(), constants.data(), natives.data(), context.buffers.data(),
+		context.stack.data(), context.slots.data(), count,
+		[arguments, first, rows, count](size_t index, double *buffer) {
+			return loadColumn(arguments[index], first, rows, count, buffer);
+		}, &context.profile);
+}
+
+void Program::run(double **arguments, double *result, size_t n) {
+	std::vector<ColumnView> views(argument_number);
+	for (size_t i = 0; i < argument_number; ++i)
+		views[i] = ColumnView(arguments[i]);
+	run(views.data(), ResultView(result), n);
+}
+
+void Program::run(const ColumnView *arguments, const ResultView &result, size_t n) {
+	runRange(context, arguments, result, 0, n);
+}
+
+void Program::run(const ColumnView *arguments, const ResultView *results, size_t n) {
+	for (size_t k = 0; k < output_number; ++k)
+		checkResultType(results[k]);
+	for (size_t first = 0; first < n; first += BLOCK_SIZE) {
+		size_t count = n - first < BLOCK_SIZE ? n - first : BLOCK_SIZE;
+		const double *const *outputs = runBlockOutputs(context, arguments, first, nullptr, count);
+		for (size_t k = 0; k < output_number; ++k)
+			storeColumn(results[k], first, nullptr, count, outputs[k]);
+	}
+}
+
+void Program::runRange(Context &context, const ColumnView *arguments, const ResultView &result,
+	size_t first, size_t end) const
+{
+	checkResultType(result);
+	for (; first < end; first += BLOCK_SIZE) {
+		size_t count = end - first < BLOCK_SIZE ? end - first : BLOCK_SIZE;
+		const double *values = runBlock(context, arguments, first, nullptr, count);
+		storeColumn(result, first, nullptr, count, values);
+	}
+}
+
+void Program::runSelected(const ColumnView *arguments, const ResultView &result,
+	const size_t *selection, size_t n, ResultPlacement placement)
+{
+	checkResultType(result);
+	for (size_t first = 0; first < n; first += BLOCK_SIZE) {
+		size_t count = n - first < BLOCK_SIZE ? n - first : BLOCK_SIZE;
+		const size_t *rows = selection + first;
+		const double *values = runBlock(context, arguments, 0, rows, count);
+		if (placement == RESULT_SCATTERED)
+			storeColumn(result, 0, rows, count, values);
+		else
+			storeColumn(result, first, nullptr, count, values);
+	}
+}
+
+void Program::runMasked(const ColumnView *arguments, const ResultView &result,
+	const uint64_t *mask, size_t n, ResultPlacement placement)
+{
+	checkResultType(result);
+	size_t rows[BLOCK_SIZE];
+	size_t count = 0;
+	size_t dense_first = 0;
+	auto flush = [&]() {
+		const double *values = runBlock(context, arguments, 0, rows, count);
+		if (placement == RESULT_SCATTERED)
+			storeColumn(result, 0, rows, count, values);
+		else
+			storeColumn(result, dense_first, nullptr, count, values);
+		dense_first += count;
+		count = 0;
+	};
+
+	// collect the indices of the set bits until a block is full
+	for (size_t word = 0; word * 64 < n; ++word) {
+		uint64_t bits = mask[word];
+		if (word * 64 + 64 > n)
+			bits &= (uint64_t(1) << (n - word * 64)) - 1;
+		while (bits) {
+			rows[count++] = word * 64 + countTrailingZeros(bits);
+			bits &= bits - 1;
+			if (count == BLOCK_SIZE)
+				flush();
+		}
+	}
+	if (count > 0)
+		flush();
+}
+
+// Evaluates every tape entry on a block of count rows starting at first.  The values of
+// arguments in dense double columns are not copied.
+void Program::forwardSweep(Context &context, const ColumnView *arguments, size_t first,
+	size_t count) const
+{
+	const double **values = context.tape_values.data();
+	for (size_t e = 0; e < tape.size(); ++e) {
+		const TapeEntry &entry = tape[e];
+		double *r = context.tape.data() + e * BLOCK_SIZE;
+		const double *a[3] = { values[entry.operands[0]], values[entry.operands[1]],
+			values[entry.operands[2]] };
+		values[e] = r;
+		switch (entry.op) {
+		case OP_CONST: fill(r, count, entry.value); break;
 		case OP_ARG:
-			*++sp = arguments[*ip++];
+			values[e] = loadColumn(arguments[entry.immediate], first, nullptr, count, r);
 			break;
+
+		case OP_NEG:   applyUnary<neg_impl<double>>(a, r, count); break;
+		case OP_INV:   applyUnary<inv_impl<double>>(a, r, count); break;
+		case OP_SQ:    applyUnary<sq_impl<double>>(a, r, count); break;
+		case OP_CU:    applyUnary<cu_impl<double>>(a, r, count); break;
+		case OP_SQRT:  applyUnary<sqrt_impl<double>>(a, r, count); break;
+		case OP_SIN:   applyUnary<sin_impl<double>>(a, r, count); break;
+		case OP_COS:   applyUnary<cos_impl<double>>(a, r, count); break;
+		case OP_TAN:   applyUnary<tan_impl<double>>(a, r, count); break;
+		case OP_ASIN:  applyUnary<asin_impl<double>>(a, r, count); break;
+		case OP_ACOS:  applyUnary<acos_impl<double>>(a, r, count); break;
+		case OP_ATAN:  applyUnary<atan_impl<double>>(a, r, count); break;
+		case OP_SINH:  applyUnary<sinh_impl<double>>(a, r, count); break;
+		case OP_COSH:  applyUnary<cosh_impl<double>>(a, r, count); break;
+		case OP_TANH:  applyUnary<tanh_impl<double>>(a, r, count); break;
+		case OP_ASINH: applyUnary<asinh_impl<double>>(a, r, count); break;
+		case OP_ACOSH: applyUnary<acosh_impl<double>>(a, r, count); break;
+		case OP_ATANH: applyUnary<atanh_impl<double>>(a, r, count); break;
+		case OP_EXP:   applyUnary<exp_impl<double>>(a, r, count); break;
+		case OP_LOG:   applyUnary<log_impl<double>>(a, r, count); break;
+		case OP_ERF:   applyUnary<erf_impl<double>>(a, r, count); break;
+		case OP_ERFC:  applyUnary<erfc_impl<double>>(a, r, count); break;
+		case OP_LOG1P: applyUnary<log1p_impl<double>>(a, r, count); break;
+		case OP_EXPM1: applyUnary<expm1_impl<double>>(a, r, count); break;
+		case OP_CBRT:  applyUnary<cbrt_impl<double>>(a, r, count); break;
+		case OP_ABS:   applyUnary<abs_impl<double>>(a, r, count); break;
+		case OP_FLOOR: applyUnary<floor_impl<double>>(a, r, count); break;
+		case OP_CEIL:  applyUnary<ceil_impl<double>>(a, r, count); break;
+		case OP_ROUND: applyUnary<round_impl<double>>(a, r, count); break;
+		case OP_TRUNC: applyUnary<trunc_impl<double>>(a, r, count); break;
+		case OP_NOT:   applyUnary<not_impl<double>>(a, r, count); break;
 		case OP_POWI:
-			sp[0] = pow(sp[0], SCHAR_MIN + int(*ip++));
+			for (size_t j = 0; j < count; ++j)
+				r[j] = pow(a[0][j], int(entry.immediate));
 			break;
-		default: {
-			int num_operands = getOperandNumber(op);
-			switch (num_operands) {
-			case 0: {
-				*++sp = op0_impl<double>(op);
-				break;
-			}
-			case 1: {
-				double x = *sp;
-				*sp = op1_impl(op, x);
-				break;
+
+		case OP_ADD:   applyBinary<add_impl<double>>(a, r, count); break;
+		case OP_SUB:   applyBinary<sub_impl<double>>(a, r, count); break;
+		case OP_MUL:   applyBinary<mul_impl<double>>(a, r, count); break;
+		case OP_DIV:   applyBinary<div_impl<double>>(a, r, count); break;
+		case OP_POW:   applyBinary<pow_impl<double>>(a, r, count); break;
+		case OP_HYPOT: applyBinary<hypot_impl<double>>(a, r, count); break;
+		case OP_RSUB:  applyBinary<rsub_impl<double>>(a, r, count); break;
+		case OP_RDIV:  applyBinary<rdiv_impl<double>>(a, r, count); break;
+		case OP_RPOW:  applyBinary<rpow_impl<double>>(a, r, count); break;
+		case OP_LT:    applyBinary<lt_impl<double>>(a, r, count); break;
+		case OP_LE:    applyBinary<le_impl<double>>(a, r, count); break;
+		case OP_GT:    applyBinary<gt_impl<double>>(a, r, count); break;
+		case OP_GE:    applyBinary<ge_impl<double>>(a, r, count); break;
+		case OP_EQ:    applyBinary<eq_impl<double>>(a, r, count); break;
+		case OP_NE:    applyBinary<ne_impl<double>>(a, r, count); break;
+		case OP_AND:   applyBinary<and_impl<double>>(a, r, count); break;
+		case OP_OR:    applyBinary<or_impl<double>>(a, r, count); break;
+
+		case OP_SELECT: applyTernary<select_impl<double>>(a, r, count); break;
+
+		default:       break; // not on the tape
+		}
+	}
+}
+
+// State of the reverse sweep over a block.  A row of an entry is live if the first output
+// depends on the entry in that row through the taken branches of if(), only live rows add to
+// the adjoints, like the derivatives of differentiate() select the derivative of the taken
+// branch.
+struct Sweep {
+	double *adjoints; // one block per tape entry, 0 in the rows that aren't live
+	char *live;       // one block per tape entry
+	char *reached;    // the adjoint of the entry was written
+	size_t result;    // the entry whose adjoint is propagated
+	size_t count;
+};
+
+// Adds the adjoint of the result times the partial derivative of the result with respect to an
+// operand to the adjoint of the operand, in the live rows of the result for which taken(j) is
+// true.
+template <typename Partial, typename Taken>
+static inline void propagate(Sweep &sweep, size_t operand, Partial partial, Taken taken) {
+	const double *result_adjoint = sweep.adjoints + sweep.result * BLOCK_SIZE;
+	const char *result_live = sweep.live + sweep.result * BLOCK_SIZE;
+	double *adjoint = sweep.adjoints + operand * BLOCK_SIZE;
+	char *live = sweep.live + operand * BLOCK_SIZE;
+	if (sweep.reached[operand]) {
+		for (size_t j = 0; j < sweep.count; ++j) {
+			if (result_live[j] && taken(j)) {
+				adjoint[j] += result_adjoint[j] * partial(j);
+				live[j] = 1;
 			}
-			case 2: {
-				double y = *sp--;
-				double x = *sp;
-				*sp = op2_impl<double>(op, x, y);
-				break;
+		}
+	} else {
+		for (size_t j = 0; j < sweep.count; ++j) {
+			live[j] = result_live[j] && taken(j);
+			adjoint[j] = live[j] ? result_adjoint[j] * partial(j) : 0.0;
+		}
+		sweep.reached[operand] = 1;
+	}
+}
+
+template <typename Partial>
+static inline void propagate(Sweep &sweep, size_t operand, Partial partial) {
+	propagate(sweep, operand, partial, [](size_t) { return true; });
+}
+
+// Whether a tape entry is the literal constant 0.
+bool Program::isConstantZero(size_t entry) const {
+	return tape[entry].op == OP_CONST && tape[entry].value == 0.0;
+}
+
+// Propagates the adjoint of the first output back to the arguments, from the last tape entry to
+// the first one.  Entries that don't depend on an argument are skipped.
+void Program::reverseSweep(Context &context, size_t count) const {
+	const double *const *values = context.tape_values.data();
+	Sweep sweep = { context.adjoints.data(), context.live.data(), context.reached.data(), 0,
+		count };
+	std::fill(context.reached.begin(), context.reached.begin() + tape.size(), 0);
+	fill(sweep.adjoints + output_entry * BLOCK_SIZE, count, 1.0);
+	std::fill(sweep.live + output_entry * BLOCK_SIZE, sweep.live + output_entry * BLOCK_SIZE + count,
+		1);
+	sweep.reached[output_entry] = 1;
+
+	for (size_t e = output_entry + 1; e-- > 0;) {
+		const TapeEntry &entry = tape[e];
+		if (!sweep.reached[e] || !entry.depends)
+			continue;
+		sweep.result = e;
+		const double *r = values[e];
+		const double *x = values[entry.operands[0]];
+		const double *y = values[entry.operands[1]];
+		size_t a = entry.operands[0];
+		size_t b = entry.operands[1];
+		bool has_x = tape[a].depends;
+		bool has_y = tape[b].depends; // only read for binary operations
+		switch (entry.op) {
+		case OP_NEG:   propagate(sweep, a, [](size_t) { return -1.0; }); break;
+		case OP_INV:   propagate(sweep, a, [r](size_t j) { return -r[j] * r[j]; }); break;
+		case OP_SQ:    propagate(sweep, a, [x](size_t j) { return 2.0 * x[j]; }); break;
+		case OP_CU:    propagate(sweep, a, [x](size_t j) { return 3.0 * x[j] * x[j]; }); break;
+		case OP_SQRT:  propagate(sweep, a, [r](size_t j) { return 0.5 / r[j]; }); break;
+		case OP_SIN:   propagate(sweep, a, [x](size_t j) { return cos(x[j]); }); break;
+		case OP_COS:   propagate(sweep, a, [x](size_t j) { return -sin(x[j]); }); break;
+		case OP_TAN:   propagate(sweep, a, [r](size_t j) { return 1.0 + r[j] * r[j]; }); break;
+		case OP_ASIN:  propagate(sweep, a, [x](size_t j) { return 1.0 / sqrt(1.0 - x[j] * x[j]); }); break;
+		case OP_ACOS:  propagate(sweep, a, [x](size_t j) { return -1.0 / sqrt(1.0 - x[j] * x[j]); }); break;
+		case OP_ATAN:  propagate(sweep, a, [x](size_t j) { return 1.0 / (1.0 + x[j] * x[j]); }); break;
+		case OP_SINH:  propagate(sweep, a, [x](size_t j) { return cosh(x[j]); }); break;
+		case OP_COSH:  propagate(sweep, a, [x](size_t j) { return sinh(x[j]); }); break;
+		case OP_TANH:  propagate(sweep, a, [r](size_t j) { return 1.0 - r[j] * r[j]; }); break;
+		case OP_ASINH: propagate(sweep, a, [x](size_t j) { return 1.0 / sqrt(x[j] * x[j] + 1.0); }); break;
+		case OP_ACOSH: propagate(sweep, a, [x](size_t j) { return 1.0 / sqrt(x[j] * x[j] - 1.0); }); break;
+		case OP_ATANH: propagate(sweep, a, [x](size_t j) { return 1.0 / (1.0 - x[j] * x[j]); }); break;
+		case OP_EXP:   propagate(sweep, a, [r](size_t j) { return r[j]; }); break;
+		case OP_LOG:   propagate(sweep, a, [x](size_t j) { return 1.0 / x[j]; }); break;
+		case OP_ERF:   propagate(sweep, a, [x](size_t j) { return 2.0 / sqrt(pi_impl<double>()) * exp(-x[j] * x[j]); }); break;
+		case OP_ERFC:  propagate(sweep, a, [x](size_t j) { return -2.0 / sqrt(pi_impl<double>()) * exp(-x[j] * x[j]); }); break;
+		case OP_LOG1P: propagate(sweep, a, [x](size_t j) { return 1.0 / (1.0 + x[j]); }); break;
+		case OP_EXPM1: propagate(sweep, a, [r](size_t j) { return r[j] + 1.0; }); break;
+		case OP_CBRT:  propagate(sweep, a, [r](size_t j) { return 1.0 / (3.0 * r[j] * r[j]); }); break;
+		case OP_ABS:   propagate(sweep, a, [x](size_t j) { return x[j] < 0.0 ? -1.0 : 1.0; }); break;
+		case OP_POWI: {
+			int exponent = int(entry.immediate);
+			propagate(sweep, a, [x, exponent](size_t j) {
+				return exponent * pow(x[j], exponent - 1);
+			});
+			break;
+		}
+
+		case OP_ADD:
+			if (has_x) propagate(sweep, a, [](size_t) { return 1.0; });
+			if (has_y) propagate(sweep, b, [](size_t) { return 1.0; });
+			break;
+		case OP_SUB:
+		case OP_RSUB: {
+			double sign = entry.op == OP_SUB ? 1.0 : -1.0;
+			if (has_x) propagate(sweep, a, [sign](size_t) { return sign; });
+			if (has_y) propagate(sweep, b, [sign](size_t) { return -sign; });
+			break;
+		}
+		case OP_MUL:
+			// a constant factor 0 drops the other factor's term, like in differentiate(), even
+			// where the adjoint is infinite, as for sqrt(x*0).  Other factors that don't depend
+			// on an argument, like floor(y), can be 0 in some rows only.
+			if (has_x && !isConstantZero(b))
+				propagate(sweep, a, [y](size_t j) { return y[j]; });
+			if (has_y && !isConstantZero(a))
+				propagate(sweep, b, [x](size_t j) { return x[j]; });
+			break;
+		case OP_DIV:
+		case OP_RDIV: {
+			// numerator n and denominator d of r = n / d
+			size_t n = entry.op == OP_DIV ? a : b;
+			size_t d = entry.op == OP_DIV ? b : a;
+			const double *denominator = values[d];
+			if (tape[n].depends)
+				propagate(sweep, n, [denominator](size_t j) { return 1.0 / denominator[j]; });
+			if (tape[d].depends)
+				propagate(sweep, d, [r, denominator](size_t j) { return -r[j] / denominator[j]; });
+			break;
+		}
+		case OP_POW:
+		case OP_RPOW: {
+			// base u and exponent v of r = u^v, with the partials v * u^(v-1) and u^v * log(u)
+			// of differentiate().  The derivative with respect to the exponent is NaN for bases
+			// that aren't positive, and a constant exponent 0 drops the base.
+			size_t u = entry.op == OP_POW ? a : b;
+			size_t v = entry.op == OP_POW ? b : a;
+			const double *base = values[u];
+			const double *exponent = values[v];
+			if (tape[u].depends && !isConstantZero(v)) {
+				propagate(sweep, u, [base, exponent](size_t j) {
+					return exponent[j] * pow(base[j], exponent[j] - 1.0);
+				});
 			}
+			if (tape[v].depends) {
+				propagate(sweep, v, [base, r](size_t j) {
+					return r[j] * log(base[j]);
+				});
 			}
-		} // default case
-		} // switch (*ip++)
-	} // while (*ip != OP_HLT)
+			break;
+		}
+		case OP_HYPOT:
+			if (has_x) propagate(sweep, a, [x, r](size_t j) { return r[j] == 0.0 ? 0.0 : x[j] / r[j]; });
+			if (has_y) propagate(sweep, b, [y, r](size_t j) { return r[j] == 0.0 ? 0.0 : y[j] / r[j]; });
+			break;
+		case OP_SELECT: {
+			// the condition is a step function
+			size_t c = entry.operands[2];
+			auto one = [](size_t) { return 1.0; };
+			if (tape[b].depends)
+				propagate(sweep, b, one, [x](size_t j) { return x[j] != 0.0; });
+			if (tape[c].depends)
+				propagate(sweep, c, one, [x](size_t j) { return x[j] == 0.0; });
+			break;
+		}
 
-	return stack[0];
+		default:       break; // step functions, arguments and constants
+		}
+	}
 }
 
+double Program::runGradient(const double *arguments, double *gradient) {
+	std::vector<ColumnView> views(argument_number);
+	std::vector<ResultView> gradient_views(argument_number);
+	for (size_t k = 0; k < argument_number; ++k) {
+		views[k] = ColumnView(arguments + k);
+		gradient_views[k] = ResultView(gradient + k);
+	}
+	double result;
+	runGradientRange(context, views.data(), ResultView(&result), gradient_views.data(), 0, 1);
+	return result;
+}
 
-void Program::run(double **arguments, double *result, size_t n) {
-	for (size_t i = 0; i < n; ++i) {
-		unsigned char const *ip = program.data(); // instruction pointer
-		double *sp = stack - 1; // stack pointer
+void Program::runGradient(const ColumnView *arguments, const ResultView &result,
+	const ResultView *gradient, size_t n)
+{
+	runGradientRange(context, arguments, result, gradient, 0, n);
+}
 
-		while (*ip != OP_HLT) {
-			Op op = Op(*ip++);
-			switch (op) {
-			case OP_NOOP:
-				break;
-			case OP_CONST:
-				*++sp = constants[*ip++];
-				break;
-			case OP_ARG:
-				*++sp = arguments[*ip++][i];
-				break;
-			case OP_POWI:
-				sp[0] = pow(sp[0], SCHAR_MIN + int(*ip++));
-				break;
-			default: {
-				int num_operands = getOperandNumber(op);
-				switch (num_operands) {
-				case 0: {
-					*++sp = op0_impl<double>(op);
-					break;
-				}
-				case 1: {
-					double x = *sp;
-					*sp = op1_impl(op, x);
-					break;
-				}
-				case 2: {
-					double y = *sp--;
-					double x = *sp;
-					*sp = op2_impl<double>(op, x, y);
-					break;
-				}
-				}
-			} // default case
-			} // switch (*ip++)
-		} // while (*ip != OP_HLT)
-
-		result[i] = stack[0];
+void Program::runGradientRange(Context &context, const ColumnView *arguments,
+	const ResultView &result, const ResultView *gradient, size_t first, size_t end) const
+{
+	if (has_calls)
+		throw std::invalid_argument("native functions can't be differentiated");
+	checkResultType(result);
+	for (size_t k = 0; k < argument_number; ++k)
+		checkResultType(gradient[k]);
+	if (context.tape_values.size() < tape.size()) {
+		context.tape.resize(tape.size() * BLOCK_SIZE);
+		context.tape_values.resize(tape.size());
+		context.adjoints.resize(tape.size() * BLOCK_SIZE);
+		context.live.resize(tape.size() * BLOCK_SIZE);
+		context.reached.resize(tape.size());
+	}
+
+	// a block of zeros for the arguments the result doesn't depend on
+	double zeros[BLOCK_SIZE] = {};
+	for (; first < end; first += BLOCK_SIZE) {
+		size_t count = end - first < BLOCK_SIZE ? end - first : BLOCK_SIZE;
+		forwardSweep(context, arguments, first, count);
+		reverseSweep(context, count);
+		storeColumn(result, first, nullptr, count, context.tape_values[output_entry]);
+		for (size_t k = 0; k < argument_number; ++k) {
+			size_t entry = argument_entries[k];
+			const double *values = zeros;
+			if (entry < tape.size() && context.reached[entry])
+				values = context.adjoints.data() + entry * BLOCK_SIZE;
+			storeColumn(gradient[k], first, nullptr, count, values);
+		}
 	}
 }
@@ -5,9 +5,19 @@
 #ifndef PROGRAM_HPP_
 #define PROGRAM_HPP_
 
+#include "ast.hpp"
+#include "columns.hpp"
+#include "cost.hpp"
+#include "functions.hpp"
+#include "profile.hpp"
+
 #include <exception>
+#include <string>
+#include <utility>
 #include <vector>
 
+class PassManager;
+
 class Program {
 public:
 	enum Optimizations {
@@ -15,20 +25,181 @@ public:
 		OPTIMIZE_MANDATORY = 1,
 		OPTIMIZE_STRICT = 2,
 		OPTIMIZE_PRECISE = 3,
+		OPTIMIZE_FAST = 4,
 
 	};
 	Program(const char * src, int optimize = OPTIMIZE_STRICT);
+
+	/// Compiles src with calls to the given functions, which are inlined before optimizing.  The
+	/// program keeps a copy of the native functions it calls.
+	Program(const char *src, const FunctionRegistry &functions, int optimize = OPTIMIZE_STRICT);
+
+	/// Compiles src with a custom pipeline of optimizations, see PassManager.
+	Program(const char *src, PassManager &passes);
+
+	/// Compiles a tree as returned by parse(), without optimizing it any further.  Trees with
+	/// calls to native functions need the registry they were parsed with.
+	Program(const Ast &ast, const FunctionRegistry *functions = nullptr);
 	~Program() = default;
 
 	void print();
+
+	/// maximum number of values on the stack while running this program
+	size_t getStackSize() const { return stack.size(); }
+
+	/// number of arguments this program reads, i.e. the highest argument index plus one
+	size_t getArgumentNumber() const { return argument_number; }
+
+	/// indices of the arguments this program reads, in increasing order, e.g. only 2 for "z"
+	const std::vector<size_t> &getUsedArguments() const { return used_arguments; }
+
+	/// Number of results per row.  A source with several comma separated expressions at the top
+	/// level, e.g. "hypot(x, y), arctan(y/x)", compiles to one program with one output per
+	/// expression, and subexpressions are shared between them.  Methods that write a single
+	/// result write the first output.
+	size_t getOutputNumber() const { return output_number; }
+
+	/// estimated cost of evaluating one row, in the units of the cost model
+	double estimateCost(const CostModel &model = CostModel()) const;
 	
 	double run(const double *arguments);
 	void run(double **arguments, double *result, size_t n);
 
+	/// Evaluates a single row and writes getOutputNumber() results to outputs.
+	void run(const double *arguments, double *outputs);
+
+	/// Evaluates n rows.  The values of argument k are read from arguments[k] and result i is
+	/// written to result, both in place.  arguments must hold getArgumentNumber() views.
+	void run(const ColumnView *arguments, const ResultView &result, size_t n);
+
+	/// Evaluates n rows in one pass and writes output k to results[k], which must hold
+	/// getOutputNumber() views.
+	void run(const ColumnView *arguments, const ResultView *results, size_t n);
+
+	/// Evaluates only the n rows listed in selection, see ResultPlacement for where the results
+	/// go.  The rows are gathered from the argument columns, nothing is evaluated for the rest.
+	void runSelected(const ColumnView *arguments, const ResultView &result,
+		const size_t *selection, size_t n, ResultPlacement placement = RESULT_DENSE);
+
+	/// Evaluates the rows i < n for which bit i % 64 of mask[i / 64] is set.
+	void runMasked(const ColumnView *arguments, const ResultView &result, const uint64_t *mask,
+		size_t n, ResultPlacement placement = RESULT_DENSE);
+
+	/// Scratch space of the block interpreter.  The run methods use a context owned by the
+	/// program, so they must not be called concurrently.  To evaluate the same program on
+	/// several threads, give each thread its own context and call runBlock().
+	class Context {
+	public:
+		/// instructions executed with this context, only collected if MINT_PROFILE is defined
+		const Profile &getProfile() const { return profile; }
+		void resetProfile() { profile.reset(); }
+
+	private:
+		friend class Program;
+		std::vector<double> buffers;
+		std::vector<const double *> stack;
+		std::vector<double> slots; // one block per slot
+		Profile profile;
+
+		// scratch space of the gradient evaluation, one block per tape entry
+		std::vector<double> tape;
+		std::vector<const double *> tape_values; // points into tape or into an input column
+		std::vector<double> adjoints;
+		std::vector<char> live; // the rows of each entry the first output depends on
+		std::vector<char> reached; // the adjoint of the entry was written
+	};
+
+	/// maximum number of rows evaluated by runBlock()
+	static const size_t BLOCK_SIZE = 256;
+
+	/// Evaluates count <= BLOCK_SIZE rows, either the given rows or, if rows is null, the rows
+	/// starting at first.  Returns a pointer to the results, which stays valid until the context
+	/// is used again.  This is the building block for all batch evaluations.
+	const double *runBlock(Context &context, const ColumnView *arguments, size_t first,
+		const size_t *rows, size_t count) const;
+
+	/// Like runBlock(), but returns getOutputNumber() pointers to the results of each output.
+	const double *const *runBlockOutputs(Context &context, const ColumnView *arguments,
+		size_t first, const size_t *rows, size_t count) const;
+
+	/// Evaluates the rows first <= i < end with the given context and writes result i, so
+	/// disjoint ranges can be evaluated concurrently with one context per thread.
+	void runRange(Context &context, const ColumnView *arguments, const ResultView &result,
+		size_t first, size_t end) const;
+
+	/// Evaluates a single row and writes the partial derivatives of the first output with
+	/// respect to each of the getArgumentNumber() arguments to gradient, by reverse mode automatic
+	/// differentiation.  Returns the value of the first output.  Step functions and comparisons
+	/// have the derivative 0.  Agrees with compileGradient() at the edges of the domains: only
+	/// the taken branch of an if() contributes, a partial derivative that is infinite or NaN
+	/// makes the derivative NaN even where it is multiplied by 0, as for sqrt(x)*y at (0, 0),
+	/// u^v has the derivative NaN with respect to v where u isn't positive, and a constant
+	/// factor 0 drops the derivative of the other factor, so sqrt(x*0) has the derivative 0.
+	/// Throws std::invalid_argument if the program calls native functions.
+	double runGradient(const double *arguments, double *gradient);
+
+	/// Evaluates n rows and writes result i and the partial derivative with respect to argument
+	/// k to gradient[k], which must hold getArgumentNumber() views.  Every block is evaluated in
+	/// one forward sweep, which records the values of all instructions on a tape in the
+	/// context, and one reverse sweep over the tape.
+	void runGradient(const ColumnView *arguments, const ResultView &result,
+		const ResultView *gradient, size_t n);
+
+	/// Like runGradient() for the rows first <= i < end, with the given context.
+	void runGradientRange(Context &context, const ColumnView *arguments,
+		const ResultView &result, const ResultView *gradient, size_t first, size_t end) const;
+
+	/// instructions executed by the run methods, only collected if MINT_PROFILE is defined
+	const Profile &getProfile() const { return context.profile; }
+	void resetProfile() { context.resetProfile(); }
+
+	/// Formats a profile of this program as a table of opcodes and a table of instructions,
+	/// each with its execution count, rows and cycles and the source text it was compiled from.
+	std::string getProfileReport(const Profile &profile) const;
+	std::string getProfileReport() const { return getProfileReport(context.profile); }
+
+	/// Parses src into a tree with an OP_HLT root, inlining calls to functions.  Throws
+	/// std::invalid_argument on errors.
+	static Ast parse(const char *src, const FunctionRegistry *functions = nullptr);
+
+	/// Applies the optimizations of the given level to a tree returned by parse().
+	static void applyOptimizations(Ast *ast, int optimize);
+
 private:
+	/// An instruction of the program in single assignment form, for the gradient evaluation.
+	/// Loaded and stored values and repeated arguments refer to the same entry.
+	struct TapeEntry {
+		Op op;
+		bool depends;  // the value depends on an argument, with a derivative other than 0
+		long immediate; // argument index or exponent of OP_POWI
+		double value;  // of constants
+		size_t operands[3];
+	};
+
+	void generateCode(const Ast &ast, const FunctionRegistry *functions = nullptr);
+	void emitIndexed(Op op8, Op op16, Op op32, size_t index);
+	void verify();
+	void buildTape();
+	void forwardSweep(Context &context, const ColumnView *arguments, size_t first,
+		size_t count) const;
+	void reverseSweep(Context &context, size_t count) const;
+	bool isConstantZero(size_t entry) const;
+
 	std::vector<unsigned char> program;
 	std::vector<double> constants;
-	double stack[100];
+	std::vector<NativeFunction> natives; // called by OP_CALL
+	std::string source;
+	std::vector<std::pair<int, int>> source_ranges; // position and length per bytecode offset
+	std::vector<double> stack;
+	std::vector<double> slots;
+	size_t argument_number = 0;
+	std::vector<size_t> used_arguments;
+	size_t output_number = 1;
+	std::vector<TapeEntry> tape;
+	std::vector<size_t> argument_entries; // tape entry of each argument, or tape.size()
+	size_t output_entry = 0;
+	bool has_calls = false;
+	Context context;
 };
 
 #endif
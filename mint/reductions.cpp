@@ -0,0 +1,113 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "reductions.hpp"
+
+#include "scheduler.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// below this, pairwise summation adds values one by one
+static const size_t PAIRWISE_BASE = 16;
+
+// Neumaier's variant of Kahan summation
+static inline void addCompensated(ReductionPartial &partial, double value) {
+	double sum = partial.sum + value;
+	if (std::abs(partial.sum) >= std::abs(value))
+		partial.compensation += (partial.sum - sum) + value;
+	else
+		partial.compensation += (value - sum) + partial.sum;
+	partial.sum = sum;
+}
+
+static double pairwiseSum(const double *values, size_t count) {
+	if (count <= PAIRWISE_BASE) {
+		double sum = 0.0;
+		for (size_t j = 0; j < count; ++j)
+			sum += values[j];
+		return sum;
+	}
+	size_t half = count / 2;
+	return pairwiseSum(values, half) + pairwiseSum(values + half, count - half);
+}
+
+static void accumulate(ReductionPartial &partial, Reduction reduction, const double *values,
+	size_t count)
+{
+	switch (reduction) {
+	case REDUCE_SUM:
+	case REDUCE_MEAN:
+		addCompensated(partial, pairwiseSum(values, count));
+		break;
+	case REDUCE_MIN:
+		for (size_t j = 0; j < count; ++j)
+			partial.min = std::fmin(partial.min, values[j]);
+		break;
+	case REDUCE_MAX:
+		for (size_t j = 0; j < count; ++j)
+			partial.max = std::fmax(partial.max, values[j]);
+		break;
+	case REDUCE_COUNT:
+		for (size_t j = 0; j < count; ++j)
+			partial.count += values[j] != 0.0;
+		break;
+	}
+}
+
+static void combine(ReductionPartial &total, const ReductionPartial &partial) {
+	addCompensated(total, partial.sum);
+	addCompensated(total, partial.compensation);
+	total.min = std::fmin(total.min, partial.min);
+	total.max = std::fmax(total.max, partial.max);
+	total.count += partial.count;
+}
+
+void reduceChunk(const Program &program, Program::Context &context, Reduction reduction,
+	const ColumnView *arguments, size_t first, size_t end, ReductionPartial &partial)
+{
+	for (; first < end; first += Program::BLOCK_SIZE) {
+		size_t count = end - first < Program::BLOCK_SIZE ? end - first : Program::BLOCK_SIZE;
+		const double *values = program.runBlock(context, arguments, first, nullptr, count);
+		accumulate(partial, reduction, values, count);
+	}
+}
+
+double combinePartials(const std::vector<ReductionPartial> &partials, Reduction reduction,
+	size_t n)
+{
+	ReductionPartial total;
+	for (const ReductionPartial &partial : partials)
+		combine(total, partial);
+
+	double sum = total.sum;
+	if (std::isfinite(sum))
+		sum += total.compensation;
+
+	switch (reduction) {
+	case REDUCE_SUM:   return sum;
+	case REDUCE_MIN:   return total.min;
+	case REDUCE_MAX:   return total.max;
+	case REDUCE_MEAN:  return n > 0 ? sum / double(n) : std::numeric_limits<double>::quiet_NaN();
+	case REDUCE_COUNT: return double(total.count);
+	default:           return std::numeric_limits<double>::quiet_NaN();
+	}
+}
+
+double reduce(const Program &program, Reduction reduction, const ColumnView *arguments,
+	size_t n, unsigned threads)
+{
+	const size_t chunks = (n + REDUCTION_CHUNK_ROWS - 1) / REDUCTION_CHUNK_ROWS;
+	std::vector<ReductionPartial> partials(chunks);
+	std::vector<Program::Context> contexts(threads > 1 ? threads : 1);
+	runChunks(chunks, threads, [&](unsigned w, size_t chunk) {
+		size_t first = chunk * REDUCTION_CHUNK_ROWS;
+		size_t end = n - first < REDUCTION_CHUNK_ROWS ? n : first + REDUCTION_CHUNK_ROWS;
+		reduceChunk(program, contexts[w], reduction, arguments, first, end, partials[chunk]);
+	});
+
+	// combine the partial results in a fixed order
+	return combinePartials(partials, reduction, n);
+}
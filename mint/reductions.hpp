@@ -0,0 +1,52 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef REDUCTIONS_HPP_
+#define REDUCTIONS_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+#include <limits>
+#include <vector>
+
+enum Reduction {
+	REDUCE_SUM,   // sum of all results
+	REDUCE_MIN,   // smallest result, NaN results are ignored
+	REDUCE_MAX,   // largest result, NaN results are ignored
+	REDUCE_MEAN,  // sum divided by the number of rows
+	REDUCE_COUNT, // number of rows with a result other than zero, e.g. rows passing a filter
+};
+
+/// Evaluates the program over n rows and reduces the results, without storing them.  Results are
+/// accumulated per block with pairwise summation, and the partial sums are combined with
+/// compensated summation.  Work is split into chunks of a fixed size regardless of the number of
+/// threads, and the chunks are combined in order, so the result does not depend on threads.  An
+/// exception thrown by a native function stops all threads and is rethrown.
+double reduce(const Program &program, Reduction reduction, const ColumnView *arguments,
+	size_t n, unsigned threads = 1);
+
+/// number of rows reduced into one partial result by reduce()
+static const size_t REDUCTION_CHUNK_ROWS = 64 * Program::BLOCK_SIZE;
+
+/// partial result of a chunk of rows, see reduceChunk()
+struct ReductionPartial {
+	double sum = 0.0;
+	double compensation = 0.0;
+	double min = std::numeric_limits<double>::quiet_NaN();
+	double max = std::numeric_limits<double>::quiet_NaN();
+	size_t count = 0;
+};
+
+/// Evaluates the rows first <= i < end with the given context and adds them to partial.
+/// reduce() reduces every chunk of REDUCTION_CHUNK_ROWS rows like this and then calls
+/// combinePartials(), so chunks reduced elsewhere give the same result bit for bit.
+void reduceChunk(const Program &program, Program::Context &context, Reduction reduction,
+	const ColumnView *arguments, size_t first, size_t end, ReductionPartial &partial);
+
+/// Combines the partial results of the chunks of n rows in order.
+double combinePartials(const std::vector<ReductionPartial> &partials, Reduction reduction,
+	size_t n);
+
+#endif // REDUCTIONS_HPP_
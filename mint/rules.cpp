@@ -0,0 +1,295 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "rules.hpp"
+
+#include "optimizations.hpp"
+#include "program.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+using std::move;
+
+const int RuleSet::MAX_REWRITES;
+const size_t RuleSet::NONE;
+
+// parses a pattern or replacement and normalizes it like the subject trees are
+static Ast parseRule(const char *src) {
+	Ast root = Program::parse(src);
+	if (root.children.size() != 1)
+		throw std::invalid_argument("a pattern must be a single expression");
+	Optimizer optimizer;
+	optimizer.optimizePowersToIntegerExponents(&root);
+	optimizer.foldConstants(&root);
+	Ast ast = move(root.children[0]);
+	return ast;
+}
+
+RuleSet::RuleSet() {
+	nodes.push_back({ {}, NONE, {} });
+}
+
+RuleSet::Key RuleSet::getKey(const Ast &ast) {
+	Key key = { int(ast.op), ast.children.size(), 0, false };
+	memcpy(&key.value, &ast.str, sizeof(key.value));
+	return key;
+}
+
+void RuleSet::addRule(const char *pattern, const char *replacement, Guard guard) {
+	addRule(parseRule(pattern), parseRule(replacement), move(guard));
+}
+
+void RuleSet::addRule(const char *pattern, Builder build, Guard guard) {
+	Rule rule;
+	rule.build = move(build);
+	rule.guard = move(guard);
+	addRule(parseRule(pattern), move(rule));
+}
+
+void RuleSet::addRule(const Ast &pattern, const Ast &replacement, Guard guard) {
+	Rule rule;
+	rule.replacement = replacement;
+	rule.guard = move(guard);
+
+	// positions in the replacement would point into the rule, not into the rewritten source
+	std::vector<Ast *> stack;
+	stack.push_back(&rule.replacement);
+	while (stack.size() > 0) {
+		Ast *ast = stack.back();
+		stack.pop_back();
+		ast->pos = -1;
+		ast->len = 0;
+		if (ast->op == OP_ARG) {
+			size_t wildcard = size_t(ast->i);
+			if (rule.uses.size() <= wildcard)
+				rule.uses.resize(wildcard + 1, 0);
+			rule.uses[wildcard]++;
+		}
+		for (Ast &child : ast->children)
+			stack.push_back(&child);
+	}
+	addRule(pattern, move(rule));
+}
+
+void RuleSet::addRule(Op op, size_t operands, Builder build, Guard guard) {
+	Ast pattern(op);
+	for (size_t k = 0; k < operands; ++k) {
+		pattern.children.emplace_back(OP_ARG);
+		pattern.children.back().i = long(k);
+	}
+	Rule rule;
+	rule.build = move(build);
+	rule.guard = move(guard);
+	addRule(pattern, move(rule), true);
+}
+
+// any_value only applies to the root of the pattern
+void RuleSet::addRule(const Ast &pattern, Rule &&rule, bool any_value) {
+	// walk the pattern in pre-order, adding the missing nodes of the decision tree
+	size_t node = 0;
+	std::vector<const Ast *> stack;
+	stack.push_back(&pattern);
+	while (stack.size() > 0) {
+		const Ast *ast = stack.back();
+		stack.pop_back();
+		if (ast->op == OP_ARG) {
+			size_t wildcard = size_t(ast->i);
+			rule.wildcards.push_back(wildcard);
+			if (rule.wildcard_number <= wildcard)
+				rule.wildcard_number = wildcard + 1;
+			if (nodes[node].wildcard == NONE) {
+				nodes[node].wildcard = nodes.size();
+				nodes.push_back({ {}, NONE, {} });
+			}
+			node = nodes[node].wildcard;
+			continue;
+		}
+		Key key = getKey(*ast);
+		if (ast == &pattern && any_value) {
+			key.value = 0;
+			key.any_value = true;
+		}
+		size_t next = NONE;
+		for (auto &edge : nodes[node].edges) {
+			if (edge.first == key)
+				next = edge.second;
+		}
+		if (next == NONE) {
+			next = nodes.size();
+			nodes[node].edges.emplace_back(key, next);
+			nodes.push_back({ {}, NONE, {} });
+		}
+		node = next;
+		for (size_t i = ast->children.size(); i-- > 0;)
+			stack.push_back(&ast->children[i]);
+	}
+
+	for (size_t wildcard = 0; wildcard < rule.uses.size(); ++wildcard) {
+		bool bound = false;
+		for (size_t w : rule.wildcards)
+			bound = bound || w == wildcard;
+		if (rule.uses[wildcard] > 0 && !bound)
+			throw std::invalid_argument("replacement uses a wildcard that is not in the pattern");
+	}
+	nodes[node].rules.push_back(rules.size());
+	rules.emplace_back(move(rule));
+}
+
+bool RuleSet::bind(const Rule &rule, const Ast *root, const std::vector<Ast *> &captured,
+	Match &match) const
+{
+	match.bound.assign(rule.wildcard_number, nullptr);
+	match.node = root;
+	for (size_t i = 0; i < captured.size(); ++i) {
+		Ast *&bound = match.bound[rule.wildcards[i]];
+		if (bound && *bound != *captured[i])
+			return false;
+		if (!bound)
+			bound = captured[i];
+	}
+	return !rule.guard || rule.guard(match);
+}
+
+// Pending holds the subtrees that are still to be matched, the next one on top.  A node can
+// follow several edges, one for its value and one for its whole operator.
+void RuleSet::search(size_t node, const Ast *root, std::vector<Ast *> &pending,
+	std::vector<Ast *> &captured, Candidate &best) const
+{
+	if (pending.empty()) {
+		for (size_t rule : nodes[node].rules) {
+			if (rule >= best.rule)
+				break;
+			Match match;
+			if (bind(rules[rule], root, captured, match)) {
+				best.rule = rule;
+				best.match = move(match);
+			}
+		}
+		return;
+	}
+
+	Ast *ast = pending.back();
+	pending.pop_back();
+	Key key = getKey(*ast);
+	for (auto &edge : nodes[node].edges) {
+		if (edge.first.matches(key)) {
+			size_t size = pending.size();
+			for (size_t i = ast->children.size(); i-- > 0;)
+				pending.push_back(&ast->children[i]);
+			search(edge.second, root, pending, captured, best);
+			pending.resize(size);
+		}
+	}
+	if (nodes[node].wildcard != NONE) {
+		captured.push_back(ast);
+		search(nodes[node].wildcard, root, pending, captured, best);
+		captured.pop_back();
+	}
+	pending.push_back(ast);
+}
+
+// wildcards are copied, except for their last use, which moves the bound subtree
+Ast RuleSet::instantiate(const Ast &replacement, Match &match, std::vector<int> &uses) const {
+	if (replacement.op == OP_ARG) {
+		size_t wildcard = size_t(replacement.i);
+		if (--uses[wildcard] == 0)
+			return match.take(wildcard);
+		return match[wildcard];
+	}
+	Ast ast(replacement.op);
+	memcpy(&ast.str, &replacement.str, sizeof(ast.str));
+	ast.children.reserve(replacement.children.size());
+	for (const Ast &child : replacement.children)
+		ast.children.emplace_back(instantiate(child, match, uses));
+	return ast;
+}
+
+// true if no pattern can match a tree with this root
+bool RuleSet::isRejected(const Ast &ast) const {
+	if (nodes[0].wildcard != NONE)
+		return false;
+	Key key = getKey(ast);
+	for (auto &edge : nodes[0].edges) {
+		if (edge.first.matches(key))
+			return false;
+	}
+	return true;
+}
+
+void RuleSet::rewriteNode(Ast *ast, size_t &rewrites) const {
+	for (int i = 0; i < MAX_REWRITES; ++i) {
+		if (isRejected(*ast))
+			return;
+		std::vector<Ast *> pending(1, ast);
+		std::vector<Ast *> captured;
+		Candidate best = { NONE, Match() };
+		search(0, ast, pending, captured, best);
+		if (best.rule == NONE)
+			return;
+
+		const Rule &rule = rules[best.rule];
+		int pos = ast->pos;
+		int len = ast->len;
+		Ast result;
+		if (rule.build) {
+			result = rule.build(best.match);
+		} else {
+			std::vector<int> uses = rule.uses;
+			result = instantiate(rule.replacement, best.match, uses);
+		}
+		*ast = move(result);
+		++rewrites;
+
+		// only the new nodes need to be rewritten, the bound subtrees already were.  The operands
+		// a builder returns are taken to be final, which saves traversing bound subtrees again.
+		if (rule.build) {
+			continue;
+		} else if (rule.replacement.op != OP_ARG) {
+			ast->pos = pos;
+			ast->len = len;
+			for (size_t k = 0; k < ast->children.size(); ++k)
+				rewriteFresh(&ast->children[k], rule.replacement.children[k], rewrites);
+		} else {
+			return;
+		}
+	}
+}
+
+void RuleSet::rewriteFresh(Ast *ast, const Ast &replacement, size_t &rewrites) const {
+	if (replacement.op == OP_ARG)
+		return;
+	for (size_t k = 0; k < ast->children.size(); ++k)
+		rewriteFresh(&ast->children[k], replacement.children[k], rewrites);
+	rewriteNode(ast, rewrites);
+}
+
+// post-order traversal with an explicit stack, so deep expressions can't overflow the call stack
+void RuleSet::rewriteTree(Ast *root, size_t &rewrites) const {
+	struct State {
+		Ast *ast;
+		size_t index;
+	};
+	std::vector<State> stack;
+	stack.push_back({ root, 0 });
+	while (stack.size() > 0) {
+		State &state = stack.back();
+		size_t index = state.index;
+		if (index < state.ast->children.size()) {
+			state.index++;
+			stack.push_back({ &state.ast->children[index], 0 });
+		} else {
+			Ast *ast = state.ast;
+			stack.pop_back();
+			rewriteNode(ast, rewrites);
+		}
+	}
+}
+
+size_t RuleSet::rewrite(Ast *ast) const {
+	size_t rewrites = 0;
+	if (rules.size() > 0)
+		rewriteTree(ast, rewrites);
+	return rewrites;
+}
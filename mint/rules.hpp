@@ -0,0 +1,138 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef RULES_HPP_
+#define RULES_HPP_
+
+#include "ast.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/// A set of rewrite rules pattern => replacement, applied together in a single bottom-up
+/// traversal.  Patterns are written in the expression syntax, with the arguments as wildcards:
+/// x, y, z, w (or a, b, c, d) and $1, $2, ... match any subtree.  A wildcard that occurs more
+/// than once only matches equal subtrees, e.g. "x*x" matches sin(t)*sin(t) but not sin(t)*t.
+/// Everything else matches nodes with the same operator, value and number of operands, so a
+/// binary pattern "x+y" does not match a sum flattened to three operands.  Rules for a whole
+/// operator match its nodes whatever their value.
+///
+/// The patterns are compiled into a decision tree, which is walked once per node of the
+/// rewritten tree, so adding rules does not add traversals.  If several rules match, the rule
+/// added first is used.  A rewritten node is matched again, after its new operands were
+/// rewritten, until no rule matches or a node was rewritten MAX_REWRITES times.
+class RuleSet {
+public:
+	/// the subtrees bound to the wildcards of a matched pattern, indexed by argument number
+	class Match {
+	public:
+		const Ast &operator [] (size_t wildcard) const { return *bound[wildcard]; }
+
+		/// the matched node, e.g. for its immediate value
+		const Ast &getNode() const { return *node; }
+
+		/// moves the bound subtree out of the matched tree, it may only be taken once
+		Ast take(size_t wildcard) { return std::move(*bound[wildcard]); }
+
+		size_t size() const { return bound.size(); }
+
+	private:
+		friend class RuleSet;
+		std::vector<Ast *> bound;
+		const Ast *node = nullptr;
+	};
+
+	typedef std::function<bool(const Match &)> Guard;
+	typedef std::function<Ast(Match &)> Builder;
+
+	/// maximum number of rewrites of a single node, which stops rules that undo each other
+	static const int MAX_REWRITES = 64;
+
+	RuleSet();
+
+	/// Adds pattern => replacement, which is only applied if guard returns true.  Both are
+	/// parsed and normalized like the mandatory optimizations do, so "x^2" matches sq(x).
+	/// Throws std::invalid_argument if they can't be parsed, or if the replacement uses a
+	/// wildcard the pattern does not bind.
+	void addRule(const char *pattern, const char *replacement, Guard guard = Guard());
+
+	/// Adds a rule whose replacement is computed from the match, e.g. to fold constants.  Only
+	/// the root of the replacement is matched again, its operands are left as they are built.
+	void addRule(const char *pattern, Builder build, Guard guard = Guard());
+
+	/// Adds a rule given as trees, for operators without syntax like OP_SQ or OP_RSUB.  Nodes
+	/// with OP_ARG are wildcards.
+	void addRule(const Ast &pattern, const Ast &replacement, Guard guard = Guard());
+
+	/// Adds a rule for all nodes with the given operator and number of operands, whatever their
+	/// value, e.g. to fold constants for every operator.  The operands are bound to the
+	/// wildcards 0, 1, ... in order, and the node is Match::getNode().
+	void addRule(Op op, size_t operands, Builder build, Guard guard = Guard());
+
+	size_t getRuleNumber() const { return rules.size(); }
+
+	/// Rewrites the whole tree and returns the number of rewrites.
+	size_t rewrite(Ast *ast) const;
+
+private:
+	struct Key {
+		int op;
+		size_t operands;
+		uint64_t value;
+		bool any_value; // set for the rules of a whole operator
+
+		bool operator == (const Key &other) const {
+			return op == other.op && operands == other.operands && value == other.value &&
+				any_value == other.any_value;
+		}
+
+		// true if a node with the given key follows this edge
+		bool matches(const Key &node) const {
+			return op == node.op && operands == node.operands &&
+				(any_value || value == node.value);
+		}
+	};
+
+	// node of the decision tree, which tests the next node of the pattern in pre-order
+	struct Node {
+		std::vector<std::pair<Key, size_t>> edges; // next node for a node with this key
+		size_t wildcard; // next node if a wildcard is bound here, or NONE
+		std::vector<size_t> rules; // rules whose pattern ends here, in the order they were added
+	};
+
+	struct Rule {
+		std::vector<size_t> wildcards; // argument number of every wildcard, in pre-order
+		size_t wildcard_number = 0;
+		Ast replacement;
+		std::vector<int> uses; // number of times the replacement uses every wildcard
+		Builder build;
+		Guard guard;
+	};
+
+	struct Candidate {
+		size_t rule;
+		Match match;
+	};
+
+	static const size_t NONE = size_t(-1);
+
+	static Key getKey(const Ast &ast);
+
+	void addRule(const Ast &pattern, Rule &&rule, bool any_value = false);
+	bool isRejected(const Ast &ast) const;
+	void search(size_t node, const Ast *root, std::vector<Ast *> &pending,
+		std::vector<Ast *> &captured, Candidate &best) const;
+	bool bind(const Rule &rule, const Ast *root, const std::vector<Ast *> &captured,
+		Match &match) const;
+	Ast instantiate(const Ast &replacement, Match &match, std::vector<int> &uses) const;
+	void rewriteTree(Ast *ast, size_t &rewrites) const;
+	void rewriteNode(Ast *ast, size_t &rewrites) const;
+	void rewriteFresh(Ast *ast, const Ast &replacement, size_t &rewrites) const;
+
+	std::vector<Node> nodes;
+	std::vector<Rule> rules;
+};
+
+#endif // RULES_HPP_
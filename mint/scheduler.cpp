@@ -0,0 +1,222 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "scheduler.hpp"
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#ifdef MINT_NUMA
+#include <numa.h>
+#include <numaif.h>
+
+static unsigned getNodeNumber() {
+	if (numa_available() < 0)
+		return 1;
+	return unsigned(numa_max_node() + 1);
+}
+
+// node holding the page of address, or -1 if unknown, e.g. because it was never touched
+static int getNodeOfAddress(const void *address) {
+	int node = -1;
+	if (get_mempolicy(&node, nullptr, 0, const_cast<void *>(address),
+		MPOL_F_NODE | MPOL_F_ADDR) != 0)
+	{
+		return -1;
+	}
+	return node;
+}
+
+static void bindToNode(unsigned node) {
+	numa_run_on_node(int(node));
+}
+#else
+static unsigned getNodeNumber() {
+	return 1;
+}
+
+static int getNodeOfAddress(const void *) {
+	return -1;
+}
+
+static void bindToNode(unsigned) {
+}
+#endif
+
+struct Task {
+	size_t program;
+	size_t chunk;
+};
+
+struct Worker {
+	unsigned node;
+	std::mutex mutex;
+	std::deque<Task> tasks; // the owner takes from the front, thieves from the back
+};
+
+static bool takeOwn(Worker &worker, Task &task) {
+	std::lock_guard<std::mutex> lock(worker.mutex);
+	if (worker.tasks.empty())
+		return false;
+	task = worker.tasks.front();
+	worker.tasks.pop_front();
+	return true;
+}
+
+static bool steal(Worker &victim, Task &task) {
+	std::lock_guard<std::mutex> lock(victim.mutex);
+	if (victim.tasks.empty())
+		return false;
+	task = victim.tasks.back();
+	victim.tasks.pop_back();
+	return true;
+}
+
+GridStatistics runGrid(const std::vector<const Program *> &programs, const ColumnView *arguments,
+	const ResultView *results, size_t n, const GridOptions &options)
+{
+	for (size_t p = 0; p < programs.size(); ++p) {
+		if (results[p].type != TYPE_FLOAT64 && results[p].type != TYPE_FLOAT32)
+			throw std::invalid_argument("unsupported result type");
+	}
+
+	GridStatistics statistics;
+	const size_t chunk_rows = (options.chunk_blocks > 0 ? options.chunk_blocks : 1)
+		* Program::BLOCK_SIZE;
+	const size_t chunks = (n + chunk_rows - 1) / chunk_rows;
+	if (chunks == 0 || programs.empty())
+		return statistics;
+
+	unsigned threads = options.threads > 0 ? options.threads : 1;
+	if (threads > chunks * programs.size())
+		threads = unsigned(chunks * programs.size());
+	unsigned nodes = options.numa ? getNodeNumber() : 1;
+	if (nodes > threads)
+		nodes = threads;
+	statistics.nodes = nodes;
+
+	// worker w runs on node w % nodes
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (unsigned w = 0; w < threads; ++w) {
+		workers.emplace_back(new Worker());
+		workers.back()->node = w % nodes;
+	}
+
+	size_t argument_number = 0;
+	for (const Program *program : programs) {
+		if (program->getArgumentNumber() > argument_number)
+			argument_number = program->getArgumentNumber();
+	}
+
+	// chunks go to the node holding their rows, or are split evenly between the nodes
+	std::vector<std::vector<size_t>> node_chunks(nodes);
+	for (size_t chunk = 0; chunk < chunks; ++chunk) {
+		int node = -1;
+		if (nodes > 1 && argument_number > 0) {
+			const char *data = (const char *)arguments[0].data;
+			node = getNodeOfAddress(data + ptrdiff_t(chunk * chunk_rows) * arguments[0].stride);
+		}
+		if (node < 0 || unsigned(node) >= nodes)
+			node = int(chunk * nodes / chunks);
+		node_chunks[node].push_back(chunk);
+	}
+
+	// every worker of a node gets a contiguous range of the node's chunks
+	for (unsigned node = 0; node < nodes; ++node) {
+		std::vector<Worker *> local;
+		for (auto &worker : workers) {
+			if (worker->node == node)
+				local.push_back(worker.get());
+		}
+		const std::vector<size_t> &list = node_chunks[node];
+		for (size_t i = 0; i < list.size(); ++i) {
+			Worker *worker = local[i * local.size() / list.size()];
+			for (size_t p = 0; p < programs.size(); ++p)
+				worker->tasks.push_back({ p, list[i] });
+		}
+	}
+	statistics.tasks = chunks * programs.size();
+
+	std::atomic<size_t> stolen(0);
+	std::atomic<bool> failed(false);
+	auto work = [&](unsigned w) {
+		Worker &self = *workers[w];
+		if (nodes > 1)
+			bindToNode(self.node);
+		Program::Context context;
+		while (!failed) {
+			Task task;
+			if (!takeOwn(self, task)) {
+				// no tasks are added while running, so if stealing fails, all tasks are taken
+				bool found = false;
+				for (unsigned pass = 0; pass < 2 && !found; ++pass) {
+					for (unsigned i = 1; i < threads && !found; ++i) {
+						Worker &victim = *workers[(w + i) % threads];
+						if ((victim.node == self.node) == (pass == 0))
+							found = steal(victim, task);
+					}
+				}
+				if (!found)
+					return;
+				++stolen;
+			}
+			size_t first = task.chunk * chunk_rows;
+			size_t end = n - first < chunk_rows ? n : first + chunk_rows;
+			programs[task.program]->runRange(context, arguments, results[task.program], first, end);
+		}
+	};
+
+	// the calling thread only works along if it doesn't need to be bound to a node
+	runWorkers(threads, nodes == 1, work, [&]() { failed = true; });
+
+	statistics.stolen = stolen;
+	return statistics;
+}
+
+void runWorkers(unsigned threads, bool caller_works, const std::function<void(unsigned)> &work,
+	const std::function<void()> &stop)
+{
+	std::vector<std::exception_ptr> errors(threads);
+	auto run = [&](unsigned w) {
+		try {
+			work(w);
+		} catch (...) {
+			errors[w] = std::current_exception();
+			stop();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned w = caller_works ? 1 : 0; w < threads; ++w)
+		pool.emplace_back(run, w);
+	if (caller_works && threads > 0)
+		run(0);
+	for (std::thread &thread : pool)
+		thread.join();
+	for (std::exception_ptr &error : errors) {
+		if (error)
+			std::rethrow_exception(error);
+	}
+}
+
+void runChunks(size_t chunks, unsigned threads,
+	const std::function<void(unsigned, size_t)> &work)
+{
+	if (threads > chunks)
+		threads = unsigned(chunks);
+	if (threads < 1)
+		threads = 1;
+	std::atomic<size_t> next_chunk(0);
+	runWorkers(threads, true, [&](unsigned w) {
+		for (size_t chunk = next_chunk++; chunk < chunks; chunk = next_chunk++)
+			work(w, chunk);
+	}, [&]() {
+		next_chunk = chunks; // no more chunks are handed out
+	});
+}
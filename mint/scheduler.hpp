@@ -0,0 +1,51 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef SCHEDULER_HPP_
+#define SCHEDULER_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+#include <functional>
+#include <vector>
+
+struct GridOptions {
+	unsigned threads = 1;
+	size_t chunk_blocks = 64; // rows per task, in blocks
+
+	/// Only used if built with MINT_NUMA: workers are bound to the NUMA nodes in turns, and
+	/// every chunk is given to a worker on the node that holds its rows of the first argument.
+	bool numa = true;
+};
+
+struct GridStatistics {
+	size_t tasks = 0;
+	size_t stolen = 0;  // tasks run by another worker than the one they were given to
+	unsigned nodes = 1; // NUMA nodes used
+};
+
+/// Evaluates every program over the same n rows of arguments and writes the results of
+/// programs[p] to results[p].  The rows are split into chunks, and every (program, chunk) pair is
+/// a task.  Every worker starts with the tasks of a contiguous range of chunks, running all
+/// programs on a chunk before moving to the next, and workers that run out of tasks steal from
+/// the others, from workers on their own NUMA node first.  Throws std::invalid_argument for
+/// unsupported result types.  An exception thrown by a native function stops all workers and is
+/// rethrown.
+GridStatistics runGrid(const std::vector<const Program *> &programs, const ColumnView *arguments,
+	const ResultView *results, size_t n, const GridOptions &options = GridOptions());
+
+/// Runs work(w) for the workers w = 0 .. threads - 1, worker 0 on the calling thread if
+/// caller_works and all others on threads of their own.  Native functions may throw: an
+/// exception ends its worker and calls stop(), which tells the others to stop taking work, and
+/// the first error of each worker is rethrown after the join.
+void runWorkers(unsigned threads, bool caller_works, const std::function<void(unsigned)> &work,
+	const std::function<void()> &stop);
+
+/// Runs work(w, chunk) for chunk = 0 .. chunks - 1 on up to threads workers, which take the
+/// chunks in order.  Worker 0 is the calling thread.  Errors are handled like by runWorkers().
+void runChunks(size_t chunks, unsigned threads,
+	const std::function<void(unsigned, size_t)> &work);
+
+#endif // SCHEDULER_HPP_
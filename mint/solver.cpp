@@ -0,0 +1,170 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "solver.hpp"
+
+#include "derivatives.hpp"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// Evaluates f for the unknowns x in all rows, or only in the given rows if rows is not null,
+// and calls store(row, value) for each.
+template <typename Store>
+static void evaluate(const Program &f, Program::Context &context, const ColumnView *arguments,
+	const size_t *rows, size_t n, Store store)
+{
+	for (size_t first = 0; first < n; first += Program::BLOCK_SIZE) {
+		size_t count = n - first < Program::BLOCK_SIZE ? n - first : Program::BLOCK_SIZE;
+		const double *values = rows ?
+			f.runBlock(context, arguments, 0, rows + first, count) :
+			f.runBlock(context, arguments, first, nullptr, count);
+		for (size_t j = 0; j < count; ++j)
+			store(rows ? rows[first + j] : first + j, values[j]);
+	}
+}
+
+// the solver behind solve() and minimize(), which only accepts rows where f increases from the
+// lower to the upper bound if increasing is set
+static size_t solveRows(const Program &f, const Program &derivative, size_t unknown,
+	const ColumnView *arguments, const ColumnView &lower, const ColumnView &upper,
+	const ResultView &root, size_t n, const SolverOptions &options, bool increasing)
+{
+	if (unknown >= f.getArgumentNumber())
+		throw std::invalid_argument("the unknown is not an argument of the program");
+	if (derivative.getArgumentNumber() > f.getArgumentNumber())
+		throw std::invalid_argument("the derivative has more arguments than the program");
+	if (root.type != TYPE_FLOAT64 && root.type != TYPE_FLOAT32)
+		throw std::invalid_argument("unsupported result type");
+	if (!arguments && f.getArgumentNumber() > 1)
+		throw std::invalid_argument("missing argument columns");
+
+	// the unknown is read from x, which holds the current estimate of each row
+	std::vector<double> x(n), low(n), high(n), roots(n, std::numeric_limits<double>::quiet_NaN());
+	std::vector<char> rising(n); // f is negative at low and positive at high
+	std::vector<ColumnView> views(f.getArgumentNumber());
+	for (size_t k = 0; k < views.size(); ++k)
+		views[k] = k == unknown ? ColumnView(x.data()) : arguments[k];
+	Program::Context contexts[2];
+
+	const double *lows = loadColumn(lower, 0, nullptr, n, low.data());
+	const double *highs = loadColumn(upper, 0, nullptr, n, high.data());
+	for (size_t i = 0; i < n; ++i) {
+		low[i] = lows[i];
+		high[i] = highs[i];
+		if (low[i] > high[i])
+			std::swap(low[i], high[i]);
+		x[i] = low[i];
+	}
+	std::vector<double> f_low(n);
+	evaluate(f, contexts[0], views.data(), nullptr, n,
+		[&](size_t i, double value) { f_low[i] = value; });
+	x = high;
+
+	// rows with a root at a bound are done, rows without a sign change are dropped
+	size_t converged = 0;
+	std::vector<size_t> active;
+	evaluate(f, contexts[0], views.data(), nullptr, n, [&](size_t i, double f_high) {
+		bool up = f_low[i] < 0.0 && f_high > 0.0;
+		bool down = f_low[i] > 0.0 && f_high < 0.0;
+		if (f_low[i] == 0.0 && (!increasing || f_high >= 0.0)) {
+			roots[i] = low[i];
+			++converged;
+		} else if (f_high == 0.0 && (!increasing || f_low[i] <= 0.0)) {
+			roots[i] = high[i];
+			++converged;
+		} else if (up || (down && !increasing)) {
+			rising[i] = up;
+			x[i] = 0.5 * (low[i] + high[i]);
+			active.push_back(i);
+		}
+	});
+
+	for (size_t iteration = 0; iteration < options.max_iterations && active.size() > 0;
+		++iteration)
+	{
+		// the rows still active are compacted in place, which never overwrites rows of the
+		// current block before they are evaluated
+		size_t kept = 0;
+		for (size_t first = 0; first < active.size(); first += Program::BLOCK_SIZE) {
+			size_t count = active.size() - first < Program::BLOCK_SIZE ?
+				active.size() - first : Program::BLOCK_SIZE;
+			const size_t *rows = active.data() + first;
+			const double *values = f.runBlock(contexts[0], views.data(), 0, rows, count);
+			const double *slopes = derivative.runBlock(contexts[1], views.data(), 0, rows, count);
+			for (size_t j = 0; j < count; ++j) {
+				size_t i = rows[j];
+				double value = values[j];
+				if (value == 0.0 || std::isnan(value)) {
+					if (value == 0.0) {
+						roots[i] = x[i];
+						++converged;
+					}
+					continue;
+				}
+				if ((value < 0.0) == bool(rising[i]))
+					low[i] = x[i];
+				else
+					high[i] = x[i];
+
+				// the Newton step, unless it leaves the bracket or the slope is 0 or NaN
+				double next = x[i] - value / slopes[j];
+				if (!(next > low[i] && next < high[i]))
+					next = 0.5 * (low[i] + high[i]);
+				double tolerance = options.tolerance * (1.0 + std::abs(next));
+				if (std::abs(next - x[i]) <= tolerance || high[i] - low[i] <= tolerance) {
+					roots[i] = next;
+					++converged;
+					continue;
+				}
+				x[i] = next;
+				active[kept++] = i;
+			}
+		}
+		active.resize(kept);
+	}
+
+	storeColumn(root, 0, nullptr, n, roots.data());
+	return converged;
+}
+
+size_t solve(const Program &f, const Program &derivative, size_t unknown,
+	const ColumnView *arguments, const ColumnView &lower, const ColumnView &upper,
+	const ResultView &root, size_t n, const SolverOptions &options)
+{
+	return solveRows(f, derivative, unknown, arguments, lower, upper, root, n, options, false);
+}
+
+size_t solve(const char *src, size_t unknown, const ColumnView *arguments,
+	const ColumnView &lower, const ColumnView &upper, const ResultView &root, size_t n,
+	const SolverOptions &options)
+{
+	Program f(src);
+	Program derivative = compileDerivative(src, unknown);
+	return solveRows(f, derivative, unknown, arguments, lower, upper, root, n, options, false);
+}
+
+size_t minimize(const char *src, size_t unknown, const ColumnView *arguments,
+	const ColumnView &lower, const ColumnView &upper, const ResultView &minimum, size_t n,
+	const SolverOptions &options)
+{
+	Ast tree = Program::parse(src);
+	if (tree.children.size() != 1)
+		throw std::invalid_argument("the objective needs a single output");
+	if (unknown >= Program(tree).getArgumentNumber())
+		throw std::invalid_argument("the unknown is not an argument of the program");
+
+	// the first derivative keeps the arguments of src, so the columns line up
+	Ast first = differentiate(tree, unknown);
+	Ast second = differentiate(first, unknown);
+	Program::applyOptimizations(&first, Program::OPTIMIZE_STRICT);
+	Program::applyOptimizations(&second, Program::OPTIMIZE_STRICT);
+	Program slope(first);
+	if (slope.getArgumentNumber() <= unknown)
+		throw std::invalid_argument("the objective is linear in the unknown");
+	return solveRows(slope, Program(second), unknown, arguments, lower, upper, minimum, n,
+		options, true);
+}
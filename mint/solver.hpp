@@ -0,0 +1,44 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef SOLVER_HPP_
+#define SOLVER_HPP_
+
+#include "program.hpp"
+#include "columns.hpp"
+
+struct SolverOptions {
+	size_t max_iterations = 100;
+
+	/// a row has converged when the step or the bracket is below tolerance * (1 + |x|)
+	double tolerance = 1e-14;
+};
+
+/// Solves f(x) = 0 in every one of n rows, where the unknown x is argument `unknown` of f and the
+/// other arguments are read from their columns as usual.  arguments must hold
+/// f.getArgumentNumber() views, the one of the unknown is ignored, and may be null if the
+/// unknown is the only argument.  f must change sign between the bounds of a row, which can be
+/// broadcast with a stride of 0.  Newton steps with the derivative of f with respect to the
+/// unknown are taken while they stay inside the bracket, otherwise the bracket is bisected.  All
+/// rows iterate in lockstep, a block at a time, and rows are retired as soon as they converge.
+/// The root of each row is written to root, or NaN if f has no sign change between the bounds
+/// or the row didn't converge.  Returns the number of converged rows.
+size_t solve(const Program &f, const Program &derivative, size_t unknown,
+	const ColumnView *arguments, const ColumnView &lower, const ColumnView &upper,
+	const ResultView &root, size_t n, const SolverOptions &options = SolverOptions());
+
+/// Like the above, with the derivative of src compiled by compileDerivative().
+size_t solve(const char *src, size_t unknown, const ColumnView *arguments,
+	const ColumnView &lower, const ColumnView &upper, const ResultView &root, size_t n,
+	const SolverOptions &options = SolverOptions());
+
+/// Finds a local minimum of src in every row by solving for a root of its first derivative with
+/// the second derivative, see solve().  The first derivative must be negative or zero at the
+/// lower bound and positive or zero at the upper bound, so the root is a minimum.  Writes NaN
+/// for other rows.
+size_t minimize(const char *src, size_t unknown, const ColumnView *arguments,
+	const ColumnView &lower, const ColumnView &upper, const ResultView &minimum, size_t n,
+	const SolverOptions &options = SolverOptions());
+
+#endif // SOLVER_HPP_
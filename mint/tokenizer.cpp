@@ -88,9 +88,24 @@ static void ident_helper(Token &tok, const char *next) {
 	else if (cmp("trunc", tok.start, next)) {
 		tok.id = TOK_F_TRUNC;
 	}
+	else if (cmp("log1p", tok.start, next)) {
+		tok.id = TOK_F_LOG1P;
+	}
+	else if (cmp("expm1", tok.start, next)) {
+		tok.id = TOK_F_EXPM1;
+	}
+	else if (cmp("cbrt", tok.start, next)) {
+		tok.id = TOK_F_CBRT;
+	}
 	else if (cmp("pow", tok.start, next)) {
 		tok.id = TOK_F_POW;
 	}
+	else if (cmp("hypot", tok.start, next)) {
+		tok.id = TOK_F_HYPOT;
+	}
+	else if (cmp("if", tok.start, next)) {
+		tok.id = TOK_F_IF;
+	}
 	else if (cmp("x", tok.start, next)) {
 		tok.id = TOK_ARG;
 		tok.i = 0;
@@ -209,10 +224,70 @@ Token Tokenizer::getNextToken() {
 		++next;
 		tok.id = TOK_OP_POW;
 	}
+	else if (*next == '<') {
+		++next;
+		if (*next == '=') {
+			++next;
+			tok.id = TOK_OP_LE;
+		}
+		else {
+			tok.id = TOK_OP_LT;
+		}
+	}
+	else if (*next == '>') {
+		++next;
+		if (*next == '=') {
+			++next;
+			tok.id = TOK_OP_GE;
+		}
+		else {
+			tok.id = TOK_OP_GT;
+		}
+	}
+	else if (*next == '=') {
+		++next;
+		if (*next == '=') {
+			++next;
+			tok.id = TOK_OP_EQ;
+		}
+		else {
+			tok.err = "expected '==' for comparison";
+		}
+	}
+	else if (*next == '!') {
+		++next;
+		if (*next == '=') {
+			++next;
+			tok.id = TOK_OP_NE;
+		}
+		else {
+			tok.id = TOK_UN_NOT;
+		}
+	}
+	else if (*next == '&') {
+		++next;
+		if (*next == '&') {
+			++next;
+			tok.id = TOK_OP_AND;
+		}
+		else {
+			tok.err = "expected '&&'";
+		}
+	}
+	else if (*next == '|') {
+		++next;
+		if (*next == '|') {
+			++next;
+			tok.id = TOK_OP_OR;
+		}
+		else {
+			tok.err = "expected '||'";
+		}
+	}
 	else if (is_alpha(*next)) {
 		// consume all alphanumeric characters
 		++next;
-		while (is_alpha(*next))
+		while (is_alpha(*next) || is_digit(*next))
 			++next;
 
 		// check if this is a known identifier, like "cos" or "pi"
@@ -36,6 +36,7 @@ static const struct {
 
 	{ TOK_UN_NEG,  0, 1, 0, 0, 1, 10, RIGHT, OP_NEG },
 	{ TOK_UN_PLUS, 0, 1, 0, 0, 1, 10, RIGHT, OP_NOOP },
+	{ TOK_UN_NOT,  0, 1, 0, 0, 1, 10, RIGHT, OP_NOT },
 
 	{ TOK_F_PI,    1, 0, 0, 1, 0, 10, NONE,  OP_PI },
 	{ TOK_F_E,     1, 0, 0, 1, 0, 10, NONE,  OP_E },
@@ -62,47 +63,69 @@ static const struct {
 	{ TOK_F_CEIL,  0, 1, 0, 1, 1, 10, RIGHT, OP_CEIL },
 	{ TOK_F_ROUND, 0, 1, 0, 1, 1, 10, RIGHT, OP_ROUND },
 	{ TOK_F_TRUNC, 0, 1, 0, 1, 1, 10, RIGHT, OP_TRUNC },
+	{ TOK_F_LOG1P, 0, 1, 0, 1, 1, 10, RIGHT, OP_LOG1P },
+	{ TOK_F_EXPM1, 0, 1, 0, 1, 1, 10, RIGHT, OP_EXPM1 },
+	{ TOK_F_CBRT,  0, 1, 0, 1, 1, 10, RIGHT, OP_CBRT },
 
 	{ TOK_F_POW,   0, 0, 0, 1, 1, 10, NONE,  OP_POW },
+	{ TOK_F_HYPOT, 0, 0, 0, 1, 1, 10, NONE,  OP_HYPOT },
+
+	{ TOK_F_IF,    0, 0, 0, 1, 1, 10, NONE,  OP_SELECT },
+
+	{ TOK_F_CALL,  0, 0, 0, 1, 1, 10, NONE,  OP_NOOP },
+
+	{ TOK_OP_ADD,  0, 0, 1, 0, 1,  5, LEFT,  OP_ADD },
+	{ TOK_OP_SUB,  0, 0, 1, 0, 1,  5, LEFT,  OP_SUB },
+	{ TOK_OP_MUL,  0, 0, 1, 0, 1,  6, LEFT,  OP_MUL },
+	{ TOK_OP_DIV,  0, 0, 1, 0, 1,  6, LEFT,  OP_DIV },
+	{ TOK_OP_POW,  0, 0, 1, 0, 1,  7, RIGHT, OP_POW },
+	{ TOK_OP_LT,   0, 0, 1, 0, 1,  4, LEFT,  OP_LT },
+	{ TOK_OP_LE,   0, 0, 1, 0, 1,  4, LEFT,  OP_LE },
+	{ TOK_OP_GT,   0, 0, 1, 0, 1,  4, LEFT,  OP_GT },
+	{ TOK_OP_GE,   0, 0, 1, 0, 1,  4, LEFT,  OP_GE },
+	{ TOK_OP_EQ,   0, 0, 1, 0, 1,  3, LEFT,  OP_EQ },
+	{ TOK_OP_NE,   0, 0, 1, 0, 1,  3, LEFT,  OP_NE },
+	{ TOK_OP_AND,  0, 0, 1, 0, 1,  2, LEFT,  OP_AND },
+	{ TOK_OP_OR,   0, 0, 1, 0, 1,  1, LEFT,  OP_OR },
 
-	{ TOK_OP_ADD,  0, 0, 1, 0, 1,  1, LEFT,  OP_ADD },
-	{ TOK_OP_SUB,  0, 0, 1, 0, 1,  1, LEFT,  OP_SUB },
-	{ TOK_OP_MUL,  0, 0, 1, 0, 1,  2, LEFT,  OP_MUL },
-	{ TOK_OP_DIV,  0, 0, 1, 0, 1,  2, LEFT,  OP_DIV },
-	{ TOK_OP_POW,  0, 0, 1, 0, 1,  3, RIGHT, OP_POW },
-
-	{ TOK_ERROR,   0, 0, 0, 0, 0, -1, NONE,  OP_NOOP },
 	{ TOK_NONE,    0, 0, 0, 0, 0, -1, NONE,  OP_NOOP },
+	{ TOK_ERROR,   0, 0, 0, 0, 0, -1, NONE,  OP_NOOP },
 };
 
+// the special tokens have negative ids and are stored at the end of the table, in reverse order
+static inline int lookup(int id) {
+	const int n = sizeof(TOKEN_DATA_TABLE) / sizeof(TOKEN_DATA_TABLE[0]);
+	return id >= 0 ? id : n + id;
+}
+
 bool canBeValue(int id) {
-	return TOKEN_DATA_TABLE[id].canBeValue != 0;
+	return TOKEN_DATA_TABLE[lookup(id)].canBeValue != 0;
 }
 
 bool canBePrefix(int id) {
-	return TOKEN_DATA_TABLE[id].canBePrefix != 0;
+	return TOKEN_DATA_TABLE[lookup(id)].canBePrefix != 0;
 }
 
 bool canBeInfix(int id) {
-	return TOKEN_DATA_TABLE[id].canBeInfix != 0;
+	return TOKEN_DATA_TABLE[lookup(id)].canBeInfix != 0;
 }
 
 bool canBeFunction(int id) {
-	return TOKEN_DATA_TABLE[id].canBeFunction != 0;
+	return TOKEN_DATA_TABLE[lookup(id)].canBeFunction != 0;
 }
 
 bool canBeOperation(int id) {
-	return TOKEN_DATA_TABLE[id].canBeOperation != 0;
+	return TOKEN_DATA_TABLE[lookup(id)].canBeOperation != 0;
 }
 
 int getPrecedence(int id) {
-	return TOKEN_DATA_TABLE[id].precedence;
+	return TOKEN_DATA_TABLE[lookup(id)].precedence;
 }
 
 bool isRightAssociative(int id) {
-	return TOKEN_DATA_TABLE[id].associativity == RIGHT;
+	return TOKEN_DATA_TABLE[lookup(id)].associativity == RIGHT;
 }
 
 Op getOperator(int id) {
-	return TOKEN_DATA_TABLE[id].op;
+	return TOKEN_DATA_TABLE[lookup(id)].op;
 }
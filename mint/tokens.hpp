@@ -26,6 +26,7 @@ enum TokenId {
 	// unary operators
 	TOK_UN_NEG,
 	TOK_UN_PLUS,
+	TOK_UN_NOT,
 
 	// constants (functions with zero arguments)
 	TOK_F_PI,
@@ -54,9 +55,19 @@ enum TokenId {
 	TOK_F_CEIL,
 	TOK_F_ROUND,
 	TOK_F_TRUNC,
+	TOK_F_LOG1P,
+	TOK_F_EXPM1,
+	TOK_F_CBRT,
 
 	// functions with two arguments
 	TOK_F_POW,
+	TOK_F_HYPOT,
+
+	// functions with three arguments
+	TOK_F_IF,
+
+	// functions defined by the user, see FunctionRegistry
+	TOK_F_CALL,
 
 	// infix operators
 	TOK_OP_ADD,
@@ -64,6 +75,14 @@ enum TokenId {
 	TOK_OP_MUL,
 	TOK_OP_DIV,
 	TOK_OP_POW,
+	TOK_OP_LT,
+	TOK_OP_LE,
+	TOK_OP_GT,
+	TOK_OP_GE,
+	TOK_OP_EQ,
+	TOK_OP_NE,
+	TOK_OP_AND,
+	TOK_OP_OR,
 
 	// special tokens
 	TOK_ERROR = -1,
@@ -0,0 +1,120 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#include "verifier.hpp"
+
+#include "ops.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+int Verifier::verify() {
+	size_t depth = 0;
+	size_t offset = 0;
+	stack_size = 0;
+	argument_number = 0;
+	used_arguments.clear();
+	slot_number = 0;
+	bool stored[UINT8_MAX + 1] = {};
+
+	while (offset < size) {
+		int op = program[offset];
+		if (!isOperatorValid(op)) {
+			raiseError("unknown opcode", offset);
+			return 1;
+		}
+
+		size_t immediate_size = getImmediateSize(op);
+		if (offset + 1 + immediate_size > size) {
+			raiseError("missing operand", offset);
+			return 1;
+		}
+		const unsigned char *immediate = program + offset + 1;
+
+		if (op == OP_HLT) {
+			if (depth != num_outputs) {
+				raiseError("program must leave one value per output on the stack", offset);
+				return 1;
+			}
+			if (offset + 1 != size) {
+				raiseError("code after end of program", offset);
+				return 1;
+			}
+			std::sort(used_arguments.begin(), used_arguments.end());
+			used_arguments.erase(std::unique(used_arguments.begin(), used_arguments.end()),
+				used_arguments.end());
+			return 0;
+		}
+
+		switch (op) {
+		case OP_CONST:
+		case OP_CONST16:
+		case OP_CONST32:
+			if (readImmediate(immediate, immediate_size) >= num_constants) {
+				raiseError("constant index out of range", offset);
+				return 1;
+			}
+			break;
+		case OP_ARG:
+		case OP_ARG16:
+		case OP_ARG32: {
+			size_t index = readImmediate(immediate, immediate_size);
+			if (argument_number < index + 1)
+				argument_number = index + 1;
+			used_arguments.push_back(index);
+			break;
+		}
+		case OP_LOAD:
+			if (!stored[*immediate]) {
+				raiseError("slot loaded before it is stored", offset);
+				return 1;
+			}
+			break;
+		case OP_SINCOS:
+		case OP_COSSIN:
+		case OP_STORE:
+			stored[*immediate] = true;
+			if (slot_number < size_t(*immediate) + 1)
+				slot_number = size_t(*immediate) + 1;
+			break;
+		case OP_CALL:
+			if (immediate[0] >= arities.size()) {
+				raiseError("function index out of range", offset);
+				return 1;
+			}
+			if (immediate[1] == 0) {
+				raiseError("call without arguments", offset);
+				return 1;
+			}
+			if (immediate[1] != arities[immediate[0]]) {
+				raiseError("wrong number of arguments", offset);
+				return 1;
+			}
+			break;
+		default:
+			break;
+		}
+
+		// every operator pops its operands and pushes one result, except for NOOP
+		size_t operands = op == OP_CALL ? immediate[1] : getOperandNumber(op);
+		if (depth < operands) {
+			raiseError("stack underflow", offset);
+			return 1;
+		}
+		if (op != OP_NOOP)
+			depth = depth - operands + 1;
+		if (stack_size < depth)
+			stack_size = depth;
+
+		offset += 1 + immediate_size;
+	}
+
+	raiseError("missing HLT at end of program", offset);
+	return 1;
+}
+
+void Verifier::raiseError(const char *reason, size_t offset) {
+	error = reason;
+	error_offset = offset;
+}
@@ -0,0 +1,61 @@
+// This file is part of MINT.  MINT is a Math INTerpreter.
+// Copyright (C) 2026 Lars Dammann
+// See LICENSE file for details
+
+#ifndef VERIFIER_HPP_
+#define VERIFIER_HPP_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// Statically checks a bytecode program before it is executed.  A program that passes
+/// verification only contains known opcodes, all operands are present, every constant index
+/// refers to an existing constant, every call refers to an existing native function with the
+/// number of arguments it was registered with, every slot
+/// is stored before it is loaded, the stack never underflows and exactly one value per output is
+/// left on the stack when OP_HLT is reached.  The interpreter relies on this and does no checking
+/// of its own.
+class Verifier {
+public:
+	/// arities holds the number of parameters of every native function the program may call
+	Verifier(const unsigned char *program, size_t size, size_t num_constants,
+		std::vector<size_t> arities = {}, size_t num_outputs = 1) :
+		program(program), size(size), num_constants(num_constants),
+		arities(std::move(arities)), num_outputs(num_outputs) {}
+
+	int verify();
+	const char *getError() { return error; }
+	size_t getErrorOffset() { return error_offset; }
+
+	/// maximum number of values on the stack at any time during execution
+	size_t getStackSize() { return stack_size; }
+
+	/// number of arguments the program expects, i.e. the highest argument index plus one
+	size_t getArgumentNumber() { return argument_number; }
+
+	/// indices of the arguments the program reads, in increasing order
+	const std::vector<size_t> &getUsedArguments() { return used_arguments; }
+
+	/// number of slots for the second results of operations with several results and for shared
+	/// subexpressions
+	size_t getSlotNumber() { return slot_number; }
+
+private:
+	void raiseError(const char *reason, size_t offset);
+
+	const unsigned char *program;
+	size_t size;
+	size_t num_constants;
+	std::vector<size_t> arities;
+	size_t num_outputs;
+
+	size_t stack_size = 0;
+	size_t argument_number = 0;
+	std::vector<size_t> used_arguments;
+	size_t slot_number = 0;
+	const char *error = nullptr;
+	size_t error_offset = 0;
+};
+
+#endif // VERIFIER_HPP_
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include "approximation.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST(ApproximationTests, Polynomials) {
+	// polynomials up to the degree are reproduced with a single piece
+	Approximation cubic(Program("x^3 - 2*x + 1"), -2.0, 3.0, 1e-12, 3);
+	EXPECT_EQ(1, cubic.getPieceNumber());
+	EXPECT_LE(cubic.getError(), 1e-12);
+	EXPECT_NEAR(1.0, cubic.evaluate(0.0), 1e-12);
+	EXPECT_NEAR(22.0, cubic.evaluate(3.0), 1e-12);
+	EXPECT_NEAR(-3.0, cubic.evaluate(-2.0), 1e-12);
+
+	Approximation constant(Program("2"), 0.0, 1.0, 1e-15, 1);
+	EXPECT_DOUBLE_EQ(2.0, constant.evaluate(0.5));
+}
+
+TEST(ApproximationTests, NestedFunctions) {
+	Program program("tan(cos(tan(cos(x))))");
+	Approximation approximation(program, 0.0, 100.0, 1e-9);
+	EXPECT_LE(approximation.getError(), 1e-9);
+	EXPECT_GT(approximation.getPieceNumber(), 1);
+
+	const size_t n = 10000;
+	std::vector<double> x(n), expected(n), results(n);
+	std::vector<float> narrow(n);
+	for (size_t i = 0; i < n; ++i)
+		x[i] = 0.01 * double(i) + 0.001;
+	ColumnView argument(x.data());
+	program.run(&argument, ResultView(expected.data()), n);
+	approximation.evaluate(x.data(), ResultView(results.data()), n);
+	approximation.evaluate(x.data(), ResultView(narrow.data()), n);
+	for (size_t i = 0; i < n; ++i) {
+		EXPECT_NEAR(expected[i], results[i], 2e-9);
+		EXPECT_EQ(float(results[i]), narrow[i]);
+	}
+
+	// a higher degree needs fewer pieces
+	Approximation higher(program, 0.0, 100.0, 1e-9, 9);
+	EXPECT_LT(higher.getPieceNumber(), approximation.getPieceNumber());
+}
+
+TEST(ApproximationTests, HighDegree) {
+	// T_15 has monomial coefficients up to 2^14, but its Chebyshev series is summed without
+	// cancellation
+	Program program("cos(15 * arccos(x))");
+	Approximation approximation(program, -1.0, 1.0, 1e-13, 15, 1);
+	EXPECT_LE(approximation.getError(), 1e-13);
+	for (int i = 0; i <= 1000; ++i) {
+		double x = -1.0 + 0.002 * i;
+		EXPECT_NEAR(program.run(&x), approximation.evaluate(x), 1e-13) << x;
+	}
+}
+
+TEST(ApproximationTests, Limits) {
+	// a pole can't be tabulated, the table stops growing at max_pieces
+	Approximation pole(Program("1/x"), -1.0, 1.0, 1e-6, 3, 64);
+	EXPECT_EQ(64, pole.getPieceNumber());
+	EXPECT_GT(pole.getError(), 1e-6);
+
+	EXPECT_THROW(Approximation(Program("x*y"), 0.0, 1.0, 1e-6), std::invalid_argument);
+	EXPECT_THROW(Approximation(Program("x, x"), 0.0, 1.0, 1e-6), std::invalid_argument);
+	EXPECT_THROW(Approximation(Program("x"), 1.0, 1.0, 1e-6), std::invalid_argument);
+	EXPECT_THROW(Approximation(Program("x"), 0.0, 1.0, 1e-6, 0), std::invalid_argument);
+	EXPECT_THROW(Approximation(Program("x"), 0.0, 1.0, 1e-6, 16), std::invalid_argument);
+}
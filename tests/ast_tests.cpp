@@ -132,3 +132,35 @@ TEST_F(AstTests, VarY_neq_Const5) {
 	EXPECT_TRUE(var_y_ast != const_5_ast);
 	EXPECT_FALSE(var_y_ast == const_5_ast);
 }
+
+TEST(AstDeepTests, CopyDeepTrees) {
+	// a right-leaning tree, where each node's second child is the next node, and a chain of
+	// unary nodes, copied and assigned without recursion
+	const size_t depth = 300000;
+	Ast right(OP_ARG);
+	Ast chain(OP_ARG);
+	for (size_t i = 0; i < depth; ++i) {
+		Ast sum(OP_ADD);
+		sum.children.emplace_back(OP_CONST);
+		sum.children[0].d = double(i);
+		sum.children.emplace_back(move(right));
+		right = move(sum);
+		Ast sin(OP_SIN);
+		sin.children.emplace_back(move(chain));
+		chain = move(sin);
+	}
+
+	Ast copy = right;
+	EXPECT_TRUE(copy == right);
+	copy.children[1].children[0].d = -1.0;
+	EXPECT_FALSE(copy == right);
+
+	Ast assigned;
+	assigned = chain;
+	EXPECT_TRUE(assigned == chain);
+
+	// assigning a descendant replaces the node with a copy of it
+	assigned = assigned.children[0];
+	EXPECT_EQ(OP_SIN, assigned.op);
+	EXPECT_TRUE(assigned == chain.children[0]);
+}
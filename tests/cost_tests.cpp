@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "cost.hpp"
+#include "optimizations.hpp"
+#include "program.hpp"
+
+#include <cmath>
+
+TEST(CostTests, DefaultTable) {
+	CostModel model;
+	EXPECT_EQ(1.0, model.getCost(OP_ADD));
+	EXPECT_EQ(50.0, model.getCost(OP_POW));
+	EXPECT_EQ(5.0 * model.getCost(OP_MUL), model.getCost(OP_DIV));
+	EXPECT_EQ(0.0, model.getCost(OP_INVALID));
+}
+
+TEST(CostTests, Estimate) {
+	CostModel model;
+	Ast ast = Program::parse("x + y + sin(z)");
+	// HLT, two ADDs, three ARGs and SIN
+	EXPECT_EQ(2 * 1.0 + 3 * 0.5 + 20.0, model.estimate(ast));
+
+	Program program("x + y + sin(z)");
+	EXPECT_EQ(model.estimate(ast), program.estimateCost(model));
+}
+
+TEST(CostTests, Calibrate) {
+	CostModel model = CostModel::calibrate();
+	EXPECT_GT(model.getCost(OP_SIN), 0.0);
+	EXPECT_GT(model.getCost(OP_POW), model.getCost(OP_MUL));
+}
+
+TEST(CostTests, ExactReciprocal) {
+	Optimizer optimizer;
+	Ast ast = Program::parse("x / 4");
+	optimizer.rewriteByCost(&ast);
+	EXPECT_EQ(OP_MUL, ast.children[0].op);
+	EXPECT_EQ(0.25, ast.children[0].children[1].d);
+
+	ast = Program::parse("x / 3");
+	optimizer.rewriteByCost(&ast);
+	EXPECT_EQ(OP_DIV, ast.children[0].op);
+
+	optimizer.rewriteByCostRelaxed(&ast);
+	EXPECT_EQ(OP_MUL, ast.children[0].op);
+}
+
+TEST(CostTests, MergeExponentials) {
+	Optimizer optimizer;
+	Ast ast = Program::parse("exp(x) * exp(y)");
+	optimizer.rewriteByCost(&ast);
+	EXPECT_EQ(OP_MUL, ast.children[0].op);
+
+	optimizer.rewriteByCostRelaxed(&ast);
+	EXPECT_EQ(OP_EXP, ast.children[0].op);
+	EXPECT_EQ(OP_ADD, ast.children[0].children[0].op);
+
+	// with a model in which exp is cheap, the product is kept
+	CostModel model;
+	model.setCost(OP_EXP, 0.1);
+	model.setCost(OP_ADD, 10.0);
+	optimizer.setCostModel(model);
+	optimizer.rewriteByCostRelaxed(&ast);
+	EXPECT_EQ(OP_MUL, ast.children[0].op);
+}
+
+TEST(CostTests, FastLevel) {
+	const char *src = "exp(x) * exp(y) / 3";
+	Program fast(src, Program::OPTIMIZE_FAST);
+	Program strict(src, Program::OPTIMIZE_STRICT);
+	double args[] = { 0.5, 1.5 };
+	EXPECT_NEAR(strict.run(args), fast.run(args), 1e-12);
+	EXPECT_LT(fast.estimateCost(), strict.estimateCost());
+}
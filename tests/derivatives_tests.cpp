@@ -0,0 +1,353 @@
+#include <gtest/gtest.h>
+
+#include "derivatives.hpp"
+#include "functions.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+// central difference quotient of src with respect to argument k of the n arguments args
+static double differenceQuotient(const char *src, const double *args, size_t n, size_t k,
+	double h)
+{
+	Program program(src, Program::OPTIMIZE_NOTHING);
+	std::vector<double> shifted(args, args + n);
+	shifted[k] = args[k] + h;
+	double upper = program.run(shifted.data());
+	shifted[k] = args[k] - h;
+	double lower = program.run(shifted.data());
+	return (upper - lower) / (2.0 * h);
+}
+
+TEST(DerivativesTests, Polynomial) {
+	double args[] = { 1.5, 2.0 };
+	EXPECT_EQ(3 * 2.25 + 4.0, compileDerivative("x^3 + 2*x*y - 7", 0).run(args));
+	EXPECT_EQ(3.0, compileDerivative("x^3 + 2*x*y - 7", 1).run(args));
+	EXPECT_EQ(0.0, compileDerivative("x^3 + 2*x*y - 7", 2).run(args));
+
+	// terms without the argument are left out
+	Ast derivative = differentiate(Program::parse("x * 2 + sin(y)"), 0);
+	EXPECT_EQ(OP_CONST, derivative.children[0].op);
+	EXPECT_EQ(2.0, derivative.children[0].d);
+}
+
+TEST(DerivativesTests, AllOperators) {
+	const char *sources[] = {
+		"-x", "1/x", "x^2", "x^3", "x^-3", "x^7", "sqrt(x)", "sin(x)", "cos(x)", "tan(x)",
+		"arcsin(x)", "arccos(x)", "arctan(x)", "sinh(x)", "cosh(x)", "tanh(x)", "arsinh(x)",
+		"arcosh(x + 1)", "artanh(x)", "exp(x)", "log(x)", "erf(x)", "erfc(x)", "log1p(x)",
+		"expm1(x)", "cbrt(x)", "abs(x)", "abs(-x)", "floor(x) * x", "x + y", "x - y", "y - x",
+		"x * y * x", "x / y", "y / x", "x ^ y", "y ^ x", "pow(x, 2.5)", "hypot(x, y)",
+		"if(x < y, x * y, x - y)", "if(x > y, x * y, x - y)", "(x < y) + x",
+	};
+	double args[] = { 0.4, 1.7 };
+	for (const char *src : sources) {
+		for (int optimize : { Program::OPTIMIZE_NOTHING, Program::OPTIMIZE_STRICT,
+			Program::OPTIMIZE_FAST })
+		{
+			for (size_t k = 0; k < 2; ++k) {
+				double expected = differenceQuotient(src, args, 2, k, 1e-6);
+				double derivative = compileDerivative(src, k, optimize).run(args);
+				EXPECT_NEAR(expected, derivative, 1e-8 * (1.0 + std::abs(expected)))
+					<< src << " with respect to argument " << k;
+			}
+		}
+	}
+}
+
+TEST(DerivativesTests, MoreAccurateThanDifferences) {
+	double args[] = { 1.0 };
+	double exact = std::exp(1.0) * std::cos(std::exp(1.0));
+	double derivative = compileDerivative("sin(exp(x))", 0).run(args);
+	EXPECT_NEAR(exact, derivative, 1e-15);
+	EXPECT_GT(std::abs(differenceQuotient("sin(exp(x))", args, 1, 0, 1e-6) - exact), 1e-12);
+}
+
+TEST(DerivativesTests, Gradient) {
+	const char *src = "exp(x*y) * sin(x*z) + y";
+	Program gradient = compileGradient(src);
+	EXPECT_EQ(3, gradient.getOutputNumber());
+
+	double args[] = { 0.3, -1.2, 2.1 };
+	double outputs[3];
+	gradient.run(args, outputs);
+	double separate_cost = 0.0;
+	for (size_t k = 0; k < 3; ++k) {
+		Program partial = compileDerivative(src, k);
+		EXPECT_EQ(partial.run(args), outputs[k]);
+		separate_cost += partial.estimateCost();
+	}
+
+	// the partial derivatives share exp(x*y), sin(x*z) and cos(x*z)
+	EXPECT_LT(gradient.estimateCost(), separate_cost);
+
+	EXPECT_THROW(compileGradient("x, y"), std::invalid_argument);
+	double row[] = { 1.3, 0.425 };
+	EXPECT_EQ(0.425, compileDerivative("(x-0.5)*y-0.5", 0, Program::OPTIMIZE_PRECISE).run(row));
+	EXPECT_EQ(0.0, compileGradient("2").run(args));
+}
+
+TEST(DerivativesTests, OptimizedTrees) {
+	// shared and paired nodes of optimized trees are differentiated like the originals
+	Ast tree = Program::parse("sin(x) * cos(x) + exp(x*y) / exp(x*y)");
+	Program::applyOptimizations(&tree, Program::OPTIMIZE_STRICT);
+	Ast derivative = differentiate(tree, 0);
+	Program::applyOptimizations(&derivative, Program::OPTIMIZE_STRICT);
+	double args[] = { 0.8, 0.5 };
+	EXPECT_NEAR(std::cos(1.6), Program(derivative).run(args), 1e-15);
+
+	// x^1 is left as a no-op node
+	const char *sources[] = { "pow(x, 1) * y", "x^1 * y + sin(x) * cos(x)", "(x*y)^2 + x*y" };
+	for (const char *src : sources) {
+		Ast original = Program::parse(src);
+		double expected = Program(differentiate(original, 0)).run(args);
+		for (int optimize : { Program::OPTIMIZE_STRICT, Program::OPTIMIZE_PRECISE,
+			Program::OPTIMIZE_FAST })
+		{
+			Ast optimized = original;
+			Program::applyOptimizations(&optimized, optimize);
+			EXPECT_NEAR(expected, Program(differentiate(optimized, 0)).run(args),
+				1e-14 * (1.0 + std::abs(expected))) << src;
+		}
+	}
+	Ast power = Program::parse("pow(x, 1) * y");
+	Program::applyOptimizations(&power, Program::OPTIMIZE_STRICT);
+	double row[] = { 2.0, 5.0 };
+	EXPECT_EQ(5.0, Program(differentiate(power, 0)).run(row));
+
+	FunctionRegistry functions;
+	functions.defineNative("twice", 1, [](const double *const *arguments, double *result,
+		size_t n)
+	{
+		for (size_t j = 0; j < n; ++j)
+			result[j] = 2.0 * arguments[0][j];
+	});
+	EXPECT_THROW(differentiate(Program::parse("twice(x)", &functions), 0),
+		std::invalid_argument);
+	EXPECT_EQ(1.0, Program(differentiate(Program::parse("twice(y) + x", &functions), 0))
+		.run(args));
+}
+
+TEST(DerivativesTests, ReverseMode) {
+	const char *sources[] = {
+		"-x", "1/x", "x^2", "x^3", "x^-3", "x^7", "sqrt(x)", "sin(x)", "cos(x)", "tan(x)",
+		"arcsin(x)", "arccos(x)", "arctan(x)", "sinh(x)", "cosh(x)", "tanh(x)", "arsinh(x)",
+		"arcosh(x + 1)", "artanh(x)", "exp(x)", "log(x)", "erf(x)", "erfc(x)", "log1p(x)",
+		"expm1(x)", "cbrt(x)", "abs(x)", "abs(-x)", "floor(x) * x", "x + y", "x - y", "y - x",
+		"x * y * x", "x / y", "y / x", "x ^ y", "y ^ x", "pow(x, 2.5)", "hypot(x, y)",
+		"if(x < y, x * y, x - y)", "if(x > y, x * y, x - y)", "(x < y) + x",
+		"sin(x) * cos(x) + exp(x*y) / exp(x*y)", "x, y * x", "2",
+	};
+	double args[] = { 0.4, 1.7 };
+	for (const char *src : sources) {
+		for (int optimize : { Program::OPTIMIZE_NOTHING, Program::OPTIMIZE_STRICT,
+			Program::OPTIMIZE_FAST })
+		{
+			Program program(src, optimize);
+			double gradient[2] = { -1.0, -1.0 };
+			double outputs[2];
+			program.run(args, outputs);
+			EXPECT_EQ(outputs[0], program.runGradient(args, gradient)) << src;
+			Ast first = Program::parse(src);
+			first.children.resize(1);
+			for (size_t k = 0; k < program.getArgumentNumber(); ++k) {
+				double expected = Program(differentiate(first, k)).run(args);
+				EXPECT_NEAR(expected, gradient[k], 1e-14 * (1.0 + std::abs(expected)))
+					<< src << " with respect to argument " << k;
+			}
+		}
+	}
+}
+
+TEST(DerivativesTests, DomainEdges) {
+	// both modes give NaN for the derivative of a power with respect to its exponent where the
+	// base isn't positive, and drop the terms of constant factors 0
+	const char *sources[] = {
+		"(-hypot(x, x))^x", "x^y", "y^x", "pow(x - 1, y)", "x^(y*0) + y", "sqrt(x*0) + y",
+		"sqrt(0*x*y)",
+	};
+	double rows[][2] = { { 1.0, 2.0 }, { 0.0, 2.0 }, { -1.5, 3.0 }, { 0.0, -1.0 }, { 1.0, 0.0 } };
+	for (const char *src : sources) {
+		for (int optimize : { Program::OPTIMIZE_NOTHING, Program::OPTIMIZE_STRICT }) {
+			Program program(src, optimize);
+			Program gradient = compileGradient(src, optimize);
+			for (auto &row : rows) {
+				double reverse[2] = { -1.0, -1.0 };
+				double symbolic[2] = { -1.0, -1.0 };
+				program.runGradient(row, reverse);
+				gradient.run(row, symbolic);
+				for (size_t k = 0; k < gradient.getOutputNumber(); ++k) {
+					if (std::isnan(symbolic[k]) || std::isinf(symbolic[k])) {
+						EXPECT_EQ(std::isnan(symbolic[k]), std::isnan(reverse[k]))
+							<< src << " at " << row[0] << ", " << row[1];
+					} else {
+						EXPECT_NEAR(symbolic[k], reverse[k], 1e-14 * (1.0 + std::abs(symbolic[k])))
+							<< src << " at " << row[0] << ", " << row[1];
+					}
+				}
+			}
+		}
+	}
+	double row[] = { 1.0, 2.0 };
+	double gradient[2];
+	Program("(-hypot(x, x))^x").runGradient(row, gradient);
+	EXPECT_TRUE(std::isnan(gradient[0]));
+	Program("sqrt(x*0)").runGradient(row, gradient);
+	EXPECT_EQ(0.0, gradient[0]);
+}
+
+TEST(DerivativesTests, ZeroAdjoints) {
+	// infinite partials times an adjoint 0 are NaN in both modes
+	struct Case {
+		const char *src;
+		double row[3];
+		size_t nan_argument;
+	};
+	Case cases[] = {
+		{ "sqrt(x)*y", { 0.0, 0.0, 0.0 }, 0 },
+		{ "arccos(z)-hypot(cbrt(z),x)", { 1.5, 0.0, 0.0 }, 2 },
+	};
+	for (const Case &c : cases) {
+		for (int optimize : { Program::OPTIMIZE_NOTHING, Program::OPTIMIZE_STRICT }) {
+			Program program(c.src, optimize);
+			Program gradient = compileGradient(c.src, optimize);
+			size_t n = program.getArgumentNumber();
+			double reverse[3] = { -1.0, -1.0, -1.0 };
+			double symbolic[3] = { -1.0, -1.0, -1.0 };
+			program.runGradient(c.row, reverse);
+			gradient.run(c.row, symbolic);
+			for (size_t k = 0; k < n; ++k) {
+				if (std::isnan(symbolic[k]))
+					EXPECT_TRUE(std::isnan(reverse[k])) << c.src << " argument " << k;
+				else
+					EXPECT_EQ(symbolic[k], reverse[k]) << c.src << " argument " << k;
+			}
+			EXPECT_TRUE(std::isnan(reverse[c.nan_argument])) << c.src;
+		}
+	}
+}
+
+TEST(DerivativesTests, HypotAtOrigin) {
+	// both modes give 0 where hypot() has no derivative
+	const char *sources[] = { "hypot(x, y)", "hypot(x, y) + x", "hypot(x*y, x)" };
+	for (const char *src : sources) {
+		for (int optimize : { Program::OPTIMIZE_NOTHING, Program::OPTIMIZE_STRICT,
+			Program::OPTIMIZE_FAST })
+		{
+			double row[] = { 0.0, 0.0 };
+			double reverse[2] = { -1.0, -1.0 };
+			double symbolic[2] = { -1.0, -1.0 };
+			Program(src, optimize).runGradient(row, reverse);
+			compileGradient(src, optimize).run(row, symbolic);
+			for (size_t k = 0; k < 2; ++k) {
+				EXPECT_EQ(symbolic[k], reverse[k]) << src << " with respect to argument " << k;
+				EXPECT_FALSE(std::isnan(symbolic[k])) << src;
+			}
+		}
+	}
+}
+
+TEST(DerivativesTests, ReverseModeBatch) {
+	const char *src = "exp(x*y) * sin(x*z) + y";
+	Program program(src);
+	Program gradient = compileGradient(src);
+	const size_t n = 300;
+	std::vector<double> x(n), y(n), z(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = 0.01 * i;
+		y[i] = 1.0 - 0.002 * i;
+		z[i] = 0.5 + 0.003 * i;
+	}
+	ColumnView arguments[] = { x.data(), y.data(), z.data() };
+	std::vector<double> result(n), columns[3];
+	ResultView views[3];
+	for (size_t k = 0; k < 3; ++k) {
+		columns[k].resize(n);
+		views[k] = ResultView(columns[k].data());
+	}
+	program.runGradient(arguments, ResultView(result.data()), views, n);
+	for (size_t i = 0; i < n; ++i) {
+		double row[] = { x[i], y[i], z[i] };
+		double expected[3];
+		gradient.run(row, expected);
+		EXPECT_EQ(program.run(row), result[i]);
+		for (size_t k = 0; k < 3; ++k)
+			EXPECT_NEAR(expected[k], columns[k][i], 1e-14 * (1.0 + std::abs(expected[k])));
+	}
+
+	// arguments the result doesn't depend on get zeros
+	Program partial("x * z");
+	std::fill(columns[1].begin(), columns[1].end(), 1.0);
+	partial.runGradient(arguments, ResultView(result.data()), views, n);
+	EXPECT_EQ(std::vector<double>(n, 0.0), columns[1]);
+	EXPECT_EQ(x, columns[2]);
+
+	FunctionRegistry functions;
+	functions.defineNative("twice", 1, [](const double *const *arguments, double *result,
+		size_t n)
+	{
+		for (size_t j = 0; j < n; ++j)
+			result[j] = 2.0 * arguments[0][j];
+	});
+	Program call(Program::parse("twice(x)", &functions), &functions);
+	double grad[1];
+	EXPECT_THROW(call.runGradient(x.data(), grad), std::invalid_argument);
+}
+
+TEST(DerivativesTests, ReverseModeStepFactors) {
+	// factors without a derivative can still be 0 in some rows only, here in the first one
+	const char *sources[] = { "x*floor(y)", "floor(y)*x", "pow(x, floor(y))", "(y > 1) * x" };
+	const size_t n = 300;
+	std::vector<double> x(n), y(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = 1.0 + 0.01 * i;
+		y[i] = 0.5 + 0.02 * i;
+	}
+	ColumnView arguments[] = { x.data(), y.data() };
+	for (const char *src : sources) {
+		Program program(src);
+		std::vector<double> result(n), columns[2];
+		ResultView views[2];
+		for (size_t k = 0; k < 2; ++k) {
+			columns[k].resize(n);
+			views[k] = ResultView(columns[k].data());
+		}
+		program.runGradient(arguments, ResultView(result.data()), views, n);
+		for (size_t i = 0; i < n; ++i) {
+			double row[] = { x[i], y[i] };
+			double expected[2];
+			program.runGradient(row, expected);
+			EXPECT_EQ(expected[0], columns[0][i]) << src << " in row " << i;
+			EXPECT_EQ(0.0, columns[1][i]) << src << " in row " << i;
+		}
+		EXPECT_NE(0.0, columns[0][n - 1]) << src;
+	}
+}
+
+TEST(DerivativesTests, ReverseModeGuardedDomain) {
+	// the untaken branch is NaN, with a NaN derivative, where the condition is false
+	for (int optimize : { Program::OPTIMIZE_NOTHING, Program::OPTIMIZE_STRICT,
+		Program::OPTIMIZE_FAST })
+	{
+		Program program("if(x > 0, sqrt(x), 0) + if(x < 4, 0, log(x - 4))", optimize);
+		double args[] = { -1.0 };
+		double gradient[1];
+		EXPECT_EQ(0.0, program.runGradient(args, gradient));
+		EXPECT_EQ(0.0, gradient[0]);
+
+		const size_t n = 300;
+		std::vector<double> x(n), result(n), column(n);
+		for (size_t i = 0; i < n; ++i)
+			x[i] = 0.1 * double(i) - 10.05;
+		ColumnView arguments[] = { x.data() };
+		ResultView views[] = { ResultView(column.data()) };
+		program.runGradient(arguments, ResultView(result.data()), views, n);
+		for (size_t i = 0; i < n; ++i) {
+			double expected = x[i] > 0.0 ? 0.5 / sqrt(x[i]) : 0.0;
+			if (x[i] >= 4.0)
+				expected += 1.0 / (x[i] - 4.0);
+			EXPECT_NEAR(expected, column[i], 1e-14 * (1.0 + std::abs(expected))) << x[i];
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+
+#include "executor.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST(ExecutorTests, Evaluate) {
+	Executor executor(3);
+	auto program = std::make_shared<const Program>("sin(x) * y");
+	const size_t n = 100000;
+	std::vector<double> x(n), y(n), result(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = i * 0.001;
+		y[i] = 2.0 - i * 0.0001;
+	}
+	executor.evaluate(program, { x.data(), y.data() }, result.data(), n).get();
+	for (size_t i = 0; i < n; i += 997) {
+		double args[] = { x[i], y[i] };
+		EXPECT_EQ(Program("sin(x) * y").run(args), result[i]);
+	}
+}
+
+TEST(ExecutorTests, CompileAndEvaluate) {
+	Executor executor(2);
+	std::vector<double> x = { 1.0, 2.0, 3.0 }, result(3);
+	std::future<void> done = executor.evaluate("x * 10", Program::OPTIMIZE_STRICT, { x.data() },
+		result.data(), x.size());
+	std::future<Executor::ProgramPtr> program = executor.compile("x + 1");
+	done.get();
+	EXPECT_EQ(std::vector<double>({ 10.0, 20.0, 30.0 }), result);
+	EXPECT_EQ(1u, program.get()->getArgumentNumber());
+}
+
+TEST(ExecutorTests, Errors) {
+	Executor executor(1);
+	std::vector<double> result(1);
+	EXPECT_THROW(executor.compile("x +").get(), std::invalid_argument);
+	EXPECT_THROW(executor.evaluate("x +", Program::OPTIMIZE_STRICT, {}, result.data(), 1).get(),
+		std::invalid_argument);
+	auto program = std::make_shared<const Program>("x");
+	EXPECT_THROW(executor.evaluate(program, {}, result.data(), 1).get(), std::invalid_argument);
+	EXPECT_EQ(0u, executor.getJobsInFlight());
+}
+
+TEST(ExecutorTests, Reduce) {
+	Executor executor(4);
+	auto program = std::make_shared<const Program>("x * 2 - 3");
+	std::vector<double> x(100000);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = double(i);
+	ColumnView args[] = { x.data() };
+	for (Reduction reduction : { REDUCE_SUM, REDUCE_MIN, REDUCE_MAX, REDUCE_MEAN, REDUCE_COUNT }) {
+		EXPECT_EQ(::reduce(*program, reduction, args, x.size()),
+			executor.reduce(program, reduction, { x.data() }, x.size()).get());
+	}
+
+	// sums that aren't exact in floating point are the same bit for bit
+	auto inverse = std::make_shared<const Program>("1 / (x + 0.1)");
+	double expected = ::reduce(*inverse, REDUCE_SUM, args, x.size());
+	EXPECT_EQ(expected, executor.reduce(inverse, REDUCE_SUM, { x.data() }, x.size()).get());
+	EXPECT_EQ(expected, executor.reduce("1 / (x + 0.1)", Program::OPTIMIZE_STRICT, REDUCE_SUM,
+		{ x.data() }, x.size()).get());
+	EXPECT_THROW(executor.reduce("x +", Program::OPTIMIZE_STRICT, REDUCE_SUM, { x.data() },
+		x.size()).get(), std::invalid_argument);
+	EXPECT_EQ(0u, executor.getJobsInFlight());
+}
+
+TEST(ExecutorTests, ShortJobsAreNotBlocked) {
+	// with a single worker, the chunks of both jobs are evaluated in turns
+	Executor executor(1);
+	auto program = std::make_shared<const Program>("sin(x) * cos(x) + exp(x)");
+	double x = 0.5, result = 0.0;
+	ColumnView column(&x, 0, TYPE_FLOAT64);
+	ResultView sink(&result, 0, TYPE_FLOAT64);
+	std::future<void> long_job = executor.evaluate(program, { column }, sink, size_t(1) << 24);
+	std::vector<double> short_result(10);
+	executor.evaluate(program, { column }, short_result.data(), 10).get();
+	EXPECT_EQ(std::future_status::timeout, long_job.wait_for(std::chrono::seconds(0)));
+	long_job.get();
+}
+
+TEST(ExecutorTests, Backpressure) {
+	Executor executor(2, 3);
+	auto program = std::make_shared<const Program>("x + 1");
+	std::vector<double> x(50000, 1.0);
+	std::vector<std::vector<double>> results(20, std::vector<double>(x.size()));
+	std::vector<std::future<void>> futures;
+	for (auto &result : results) {
+		futures.push_back(executor.evaluate(program, { x.data() }, result.data(), x.size()));
+		EXPECT_LE(executor.getJobsInFlight(), 3u);
+	}
+	for (auto &future : futures)
+		future.get();
+	for (auto &result : results)
+		EXPECT_EQ(2.0, result.back());
+}
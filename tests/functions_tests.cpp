@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+
+#include "functions.hpp"
+#include "program.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(FunctionsTests, Gauss) {
+	FunctionRegistry functions;
+	functions.define("gauss(x, m, s) = exp(-0.5*((x-m)/s)^2) / (sqrt(2*pi)*s)");
+	EXPECT_EQ(3, functions.getParameterNumber(functions.find("gauss")));
+
+	Program program("gauss(y, 1, x)", functions);
+	Program expected("exp(-0.5*((y-1)/x)^2) / (sqrt(2*pi)*x)");
+	double args[] = { 2.0, 0.3 };
+	EXPECT_EQ(expected.run(args), program.run(args));
+}
+
+TEST(FunctionsTests, InlinedBeforeOptimizing) {
+	// the call is folded into a constant
+	FunctionRegistry functions;
+	functions.define("square(t) = t^2");
+	Program program("square(3) + x", functions);
+	EXPECT_EQ(Program("9 + x").estimateCost(), program.estimateCost());
+	EXPECT_EQ(Program::parse("x^2"), Program::parse("square(x)", &functions));
+}
+
+TEST(FunctionsTests, NestedCallsAndConstants) {
+	FunctionRegistry functions;
+	functions.define("kB = 2");
+	functions.define("twice(t) = kB * t");
+	functions.define("quad(t) = twice(twice(t))");
+	double args[] = { 1.5 };
+	EXPECT_EQ(6.0, Program("quad(x)", functions).run(args));
+	EXPECT_EQ(3.0, Program("kB * x", functions).run(args));
+}
+
+TEST(FunctionsTests, ParametersHideArguments) {
+	FunctionRegistry functions;
+	functions.define("shift(x) = x + y");
+	double args[] = { 1.0, 10.0, 100.0 };
+	EXPECT_EQ(110.0, Program("shift(z)", functions).run(args));
+}
+
+TEST(FunctionsTests, InvalidDefinitions) {
+	FunctionRegistry functions;
+	functions.define("f(t) = t");
+	EXPECT_THROW(functions.define("f(t) = 2*t"), std::invalid_argument);
+	EXPECT_THROW(functions.define("sin(t) = t"), std::invalid_argument);
+	EXPECT_THROW(functions.define("g(t, t) = t"), std::invalid_argument);
+	EXPECT_THROW(functions.define("g(t) == t"), std::invalid_argument);
+	EXPECT_THROW(functions.define("g(t) = t +"), std::invalid_argument);
+	EXPECT_THROW(functions.define("g(t) = u"), std::invalid_argument);
+	EXPECT_EQ(1, functions.getFunctionNumber());
+}
+
+TEST(FunctionsTests, InvalidCalls) {
+	FunctionRegistry functions;
+	functions.define("f(t, u) = t - u");
+	EXPECT_THROW(Program("f(x)", functions), std::invalid_argument);
+	EXPECT_THROW(Program("f(x, y, z)", functions), std::invalid_argument);
+	EXPECT_THROW(Program("f(x, )", functions), std::invalid_argument);
+	EXPECT_THROW(Program("f + 1", functions), std::invalid_argument);
+	EXPECT_THROW(Program("f(x, y)"), std::invalid_argument);
+
+	// calls without an argument list
+	functions.define("g(t, u, v) = t * u + v");
+	functions.define("h(t) = 2 * t");
+	EXPECT_THROW(Program("g x", functions), std::invalid_argument);
+	EXPECT_THROW(Program("g x, y, z", functions), std::invalid_argument);
+	EXPECT_THROW(Program("h", functions), std::invalid_argument);
+	EXPECT_THROW(Program("h x", functions), std::invalid_argument);
+	EXPECT_THROW(Program("(g)(x, y, z)", functions), std::invalid_argument);
+	EXPECT_THROW(Program("hypot x"), std::invalid_argument);
+	EXPECT_THROW(Program("hypot(x)"), std::invalid_argument);
+	EXPECT_THROW(Program("pow(x, y, z)"), std::invalid_argument);
+	EXPECT_THROW(Program("if(x, y)"), std::invalid_argument);
+	double args[] = { 5.0, 2.0 };
+	EXPECT_EQ(3.0, Program("f(x, (y))", functions).run(args));
+}
+
+TEST(FunctionsTests, NestedCalls) {
+	FunctionRegistry functions;
+	functions.define("f(t) = t*t + t");
+	std::string src = "x";
+	for (int depth = 0; depth < 6; ++depth)
+		src = "f(" + src + ")";
+	double args[] = { 0.5 };
+	double expected = 0.5;
+	for (int depth = 0; depth < 6; ++depth)
+		expected = expected * expected + expected;
+	EXPECT_EQ(expected, Program(src.c_str(), functions).run(args));
+
+	// every level doubles the tree, so deep nesting is rejected instead of exhausting the memory
+	for (int depth = 6; depth < 40; ++depth)
+		src = "f(" + src + ")";
+	EXPECT_THROW(Program(src.c_str(), functions), std::invalid_argument);
+	EXPECT_THROW(functions.define(("g(t) = " + src).c_str()), std::invalid_argument);
+	EXPECT_EQ(1, functions.getFunctionNumber());
+}
+
+// x^2 + y, one block at a time
+static size_t block_calls = 0;
+static void squarePlus(const double *const *arguments, double *result, size_t n) {
+	++block_calls;
+	for (size_t j = 0; j < n; ++j)
+		result[j] = arguments[0][j] * arguments[0][j] + arguments[1][j];
+}
+
+TEST(FunctionsTests, NativeBlockFunction) {
+	FunctionRegistry functions;
+	functions.defineNative("sqplus", 2, squarePlus);
+	EXPECT_TRUE(functions.isNative(functions.find("sqplus")));
+
+	// the arguments of the inner call overlap the result of the outer one
+	const size_t n = 3 * Program::BLOCK_SIZE + 7;
+	std::vector<double> x(n), y(n), result(n);
+	for (size_t j = 0; j < n; ++j) {
+		x[j] = 0.01 * double(j);
+		y[j] = 1.0 - 0.02 * double(j);
+	}
+	Program program("1 + sqplus(sqplus(x, y), 2*y)", functions);
+	block_calls = 0;
+	double *columns[] = { x.data(), y.data() };
+	program.run(columns, result.data(), n);
+	EXPECT_EQ(8, block_calls);
+	for (size_t j = 0; j < n; ++j) {
+		double inner = x[j] * x[j] + y[j];
+		EXPECT_EQ(1.0 + (inner * inner + 2.0 * y[j]), result[j]);
+	}
+
+	// without a scalar function, single rows go through the block function
+	double args[] = { 3.0, 0.5 };
+	EXPECT_EQ(1.0 + (9.5 * 9.5 + 1.0), program.run(args));
+}
+
+TEST(FunctionsTests, NativeScalarFunction) {
+	FunctionRegistry functions;
+	size_t scalar_calls = 0;
+	functions.defineNative("half", 1,
+		[](const double *const *arguments, double *result, size_t n) {
+			for (size_t j = 0; j < n; ++j)
+				result[j] = 0.5 * arguments[0][j];
+		},
+		[&scalar_calls](const double *arguments) {
+			++scalar_calls;
+			return 0.5 * arguments[0];
+		});
+	Program program("half(x) + half(half(y))", functions);
+	double args[] = { 3.0, 8.0 };
+	EXPECT_EQ(3.5, program.run(args));
+	EXPECT_EQ(3, scalar_calls);
+
+	// the block function is still used for batches
+	std::vector<double> x = { 1.0, 2.0 }, y = { 4.0, 0.0 }, result(2);
+	double *columns[] = { x.data(), y.data() };
+	program.run(columns, result.data(), 2);
+	EXPECT_EQ(1.5, result[0]);
+	EXPECT_EQ(1.0, result[1]);
+	EXPECT_EQ(3, scalar_calls);
+}
+
+TEST(FunctionsTests, InvalidNativeFunctions) {
+	FunctionRegistry functions;
+	auto identity = [](const double *const *arguments, double *result, size_t n) {
+		for (size_t j = 0; j < n; ++j)
+			result[j] = arguments[0][j];
+	};
+	functions.defineNative("id", 1, identity);
+	EXPECT_THROW(functions.defineNative("id", 1, identity), std::invalid_argument);
+	EXPECT_THROW(functions.defineNative("sin", 1, identity), std::invalid_argument);
+	EXPECT_THROW(functions.defineNative("g h", 1, identity), std::invalid_argument);
+	EXPECT_THROW(functions.defineNative("g", 0, identity), std::invalid_argument);
+	EXPECT_THROW(functions.defineNative("g", FunctionRegistry::MAX_NATIVE_PARAMETERS + 1,
+		identity), std::invalid_argument);
+	EXPECT_THROW(functions.defineNative("g", 1, nullptr), std::invalid_argument);
+	EXPECT_THROW(Program("id(x, y)", functions), std::invalid_argument);
+	EXPECT_THROW(Program("id x", functions), std::invalid_argument);
+	EXPECT_THROW(Program("id", functions), std::invalid_argument);
+
+	// the tree refers to the registry it was parsed with
+	Ast tree = Program::parse("id(x)", &functions);
+	EXPECT_THROW(Program program(tree), std::invalid_argument);
+	double args[] = { 4.0 };
+	EXPECT_EQ(4.0, Program(tree, &functions).run(args));
+}
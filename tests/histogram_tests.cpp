@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+
+#include "functions.hpp"
+#include "histogram.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST(HistogramTests, FixedAxis) {
+	Axis axis(4, 0.0, 2.0);
+	EXPECT_EQ(0, axis.findBin(-0.1));
+	EXPECT_EQ(1, axis.findBin(0.0));
+	EXPECT_EQ(2, axis.findBin(0.5));
+	EXPECT_EQ(4, axis.findBin(1.99));
+	EXPECT_EQ(5, axis.findBin(2.0));
+	EXPECT_EQ(5, axis.findBin(NAN));
+	EXPECT_EQ(1.5, axis.getLowEdge(4));
+}
+
+TEST(HistogramTests, VariableAxis) {
+	Axis axis(std::vector<double>{ 0.0, 1.0, 10.0, 100.0 });
+	EXPECT_EQ(3, axis.getBinNumber());
+	EXPECT_EQ(0, axis.findBin(-1.0));
+	EXPECT_EQ(1, axis.findBin(0.5));
+	EXPECT_EQ(2, axis.findBin(1.0));
+	EXPECT_EQ(3, axis.findBin(50.0));
+	EXPECT_EQ(4, axis.findBin(100.0));
+	EXPECT_THROW(Axis(std::vector<double>{ 0.0, 1.0, 1.0 }), std::invalid_argument);
+}
+
+TEST(HistogramTests, Fill1D) {
+	Program program("sqrt(x*x + y*y)");
+	std::vector<double> x(1000), y(1000);
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = double(i % 10);
+		y[i] = 0.0;
+	}
+	ColumnView args[] = { x.data(), y.data() };
+	Histogram1D histogram(Axis(5, 0.0, 5.0));
+	fillHistogram(histogram, program, args, x.size());
+	EXPECT_EQ(1000, histogram.getEntries());
+	EXPECT_EQ(0.0, histogram.getBinContent(0));
+	EXPECT_EQ(100.0, histogram.getBinContent(1));
+	EXPECT_EQ(100.0, histogram.getBinContent(5));
+	EXPECT_EQ(500.0, histogram.getBinContent(6));
+}
+
+TEST(HistogramTests, Weighted) {
+	Program program("x");
+	Program weight("x * 2");
+	std::vector<double> x = { 0.5, 1.5, 1.5, 3.0 };
+	ColumnView args[] = { x.data() };
+	Histogram1D histogram(Axis(std::vector<double>{ 0.0, 1.0, 2.0 }));
+	fillHistogram(histogram, program, args, x.size(), &weight);
+	EXPECT_EQ(1.0, histogram.getBinContent(1));
+	EXPECT_EQ(6.0, histogram.getBinContent(2));
+	EXPECT_EQ(6.0, histogram.getBinContent(3));
+}
+
+TEST(HistogramTests, Fill2D) {
+	Program px("x");
+	Program py2("y");
+	std::vector<double> x(500), y(500);
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = double(i % 2);
+		y[i] = double(i % 5);
+	}
+	ColumnView args[] = { x.data(), y.data() };
+	Histogram2D histogram(Axis(2, 0.0, 2.0), Axis(5, 0.0, 5.0));
+	fillHistogram(histogram, px, py2, args, x.size());
+	EXPECT_EQ(500, histogram.getEntries());
+	EXPECT_EQ(50.0, histogram.getBinContent(1, 1));
+	EXPECT_EQ(50.0, histogram.getBinContent(2, 5));
+	EXPECT_EQ(0.0, histogram.getBinContent(3, 1));
+}
+
+TEST(HistogramTests, Threads) {
+	Program program("sin(x)");
+	std::vector<double> x(200000);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = double(i);
+	ColumnView args[] = { x.data() };
+	Histogram1D single(Axis(20, -1.0, 1.0));
+	fillHistogram(single, program, args, x.size());
+	Histogram1D threaded(Axis(20, -1.0, 1.0));
+	threaded.fill(0.0);
+	fillHistogram(threaded, program, args, x.size(), nullptr, 4);
+	EXPECT_EQ(single.getEntries() + 1, threaded.getEntries());
+	for (size_t bin = 0; bin < 22; ++bin)
+		EXPECT_EQ(single.getBinContent(bin) + (bin == 11), threaded.getBinContent(bin));
+}
+
+TEST(HistogramTests, NativeFunctionThrows) {
+	FunctionRegistry functions;
+	functions.defineNative("checked", 1, [](const double *const *arguments, double *result,
+		size_t n)
+	{
+		for (size_t j = 0; j < n; ++j) {
+			if (arguments[0][j] < 0.0)
+				throw std::runtime_error("negative value");
+			result[j] = arguments[0][j];
+		}
+	});
+	Program program(Program::parse("checked(x)", &functions), &functions);
+	std::vector<double> x(200000);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = i % 40000 == 39999 ? -1.0 : double(i);
+	ColumnView args[] = { x.data() };
+	for (unsigned threads : { 1u, 2u, 8u }) {
+		Histogram1D histogram(Axis(20, 0.0, 200000.0));
+		EXPECT_THROW(fillHistogram(histogram, program, args, x.size(), nullptr, threads),
+			std::runtime_error);
+	}
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "incremental.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(IncrementalTests, UpdateMatchesFullRun) {
+	const char *src = "sqrt(x * x + 1) + sin(y) * z + exp(-z)";
+	IncrementalProgram incremental(src);
+	Program program(src);
+	EXPECT_EQ(3, incremental.getArgumentNumber());
+	// sqrt(x * x + 1), sin(y) * z and exp(-z)
+	EXPECT_EQ(3, incremental.getPartNumber());
+
+	const size_t n = 1000;
+	std::vector<double> x(n), y(n), z(n), result(n), expected(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = i * 0.1;
+		y[i] = i * 0.2;
+		z[i] = i * 0.003;
+	}
+	ColumnView args[] = { x.data(), y.data(), z.data() };
+	incremental.run(args, ResultView(result.data()), n);
+	program.run(args, ResultView(expected.data()), n);
+	EXPECT_EQ(expected, result);
+
+	for (size_t i = 0; i < n; ++i)
+		y[i] = i * 0.5;
+	incremental.update(1, args, ResultView(result.data()));
+	program.run(args, ResultView(expected.data()), n);
+	EXPECT_EQ(expected, result);
+
+	// the terms of long sums are split off without recursion
+	std::string sum = "x";
+	for (size_t i = 0; i < 10000; ++i)
+		sum += i % 2 ? " + y" : " - z";
+	IncrementalProgram terms(sum.c_str(), Program::OPTIMIZE_NOTHING);
+	EXPECT_EQ(10001, terms.getPartNumber());
+	terms.run(args, ResultView(result.data()), 10);
+	Program(sum.c_str(), Program::OPTIMIZE_NOTHING).run(args, ResultView(expected.data()), 10);
+	EXPECT_TRUE(std::equal(expected.begin(), expected.begin() + 10, result.begin()));
+}
+
+TEST(IncrementalTests, OnlyDependentPartsAreEvaluated) {
+	IncrementalProgram incremental("x * 2 - y");
+	std::vector<double> x = { 1.0, 2.0 }, y = { 3.0, 4.0 }, result(2);
+	ColumnView args[] = { x.data(), y.data() };
+	incremental.run(args, ResultView(result.data()), 2);
+	EXPECT_EQ(-1.0, result[0]);
+
+	// x changes, but only y is reported as updated, so the old values of x * 2 are used
+	x[0] = 10.0;
+	y[0] = 5.0;
+	incremental.update(1, args, ResultView(result.data()));
+	EXPECT_EQ(-3.0, result[0]);
+	incremental.update(0, args, ResultView(result.data()));
+	EXPECT_EQ(15.0, result[0]);
+}
+
+TEST(IncrementalTests, UnaryRoot) {
+	IncrementalProgram incremental("-sqrt(x + y)");
+	EXPECT_EQ(2, incremental.getPartNumber());
+	IncrementalProgram leaf("x");
+	EXPECT_EQ(1, leaf.getPartNumber());
+	std::vector<double> x = { 4.0 }, result(1);
+	ColumnView args[] = { x.data() };
+	leaf.run(args, ResultView(result.data()), 1);
+	EXPECT_EQ(4.0, result[0]);
+}
+
+TEST(IncrementalTests, SharingWithinParts) {
+	// every part shares its own work, as if it was compiled on its own, and pairs no sine with a
+	// cosine of another part
+	const char *terms[] = { "sin(x + y) * cos(x + y) * sin(x * y)", "exp(cos(x * y)) * sqrt(x + y)" };
+	std::string src = std::string(terms[0]) + " + " + terms[1];
+	IncrementalProgram incremental(src.c_str());
+	ASSERT_EQ(2, incremental.getPartNumber());
+	for (size_t i = 0; i < 2; ++i)
+		EXPECT_EQ(Program(terms[i]).estimateCost(), incremental.getPart(i).estimateCost()) << i;
+
+	std::vector<double> x = { 0.3, 1.7 }, y = { 0.2, 2.5 }, result(2), expected(2);
+	ColumnView args[] = { x.data(), y.data() };
+	incremental.run(args, ResultView(result.data()), 2);
+	Program(src.c_str()).run(args, ResultView(expected.data()), 2);
+	EXPECT_EQ(expected, result);
+}
+
+TEST(IncrementalTests, UpdateBeforeRun) {
+	IncrementalProgram incremental("x + y");
+	std::vector<double> result(1);
+	EXPECT_THROW(incremental.update(0, nullptr, ResultView(result.data())), std::invalid_argument);
+}
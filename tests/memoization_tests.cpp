@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "memoization.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(MemoizationTests, Scalar) {
+	Program program("exp(x) * sin(z)");
+	EXPECT_EQ(std::vector<size_t>({ 0, 2 }), program.getUsedArguments());
+	MemoizedProgram memoized(program, 100);
+	EXPECT_EQ(128, memoized.getCapacity());
+
+	double args[] = { 0.5, 1.0, 2.0 };
+	double expected = program.run(args);
+	EXPECT_EQ(expected, memoized.run(args));
+	EXPECT_EQ(0, memoized.getHits());
+	EXPECT_EQ(1, memoized.getMisses());
+
+	// y isn't read, so it isn't part of the key
+	args[1] = 7.0;
+	EXPECT_EQ(expected, memoized.run(args));
+	EXPECT_EQ(1, memoized.getHits());
+	args[2] = 3.0;
+	EXPECT_EQ(program.run(args), memoized.run(args));
+	EXPECT_EQ(2, memoized.getMisses());
+
+	memoized.clear();
+	memoized.resetStatistics();
+	EXPECT_EQ(program.run(args), memoized.run(args));
+	EXPECT_EQ(0, memoized.getHits());
+	EXPECT_EQ(1, memoized.getMisses());
+
+	EXPECT_THROW(MemoizedProgram(program, 0), std::invalid_argument);
+}
+
+TEST(MemoizationTests, Batch) {
+	// 16 distinct tuples repeated over many rows, with a cache smaller than the rows
+	Program program("hypot(x, y) + sqrt(x)");
+	MemoizedProgram memoized(program, 64);
+	const size_t n = 10000;
+	std::vector<double> x(n), y(n), expected(n), results(n);
+	std::vector<float> narrow(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = double(i % 4);
+		y[i] = 0.5 * double(i % 16 / 4);
+	}
+	ColumnView arguments[] = { x.data(), y.data() };
+	program.run(arguments, ResultView(expected.data()), n);
+	memoized.run(arguments, ResultView(results.data()), n);
+	EXPECT_EQ(expected, results);
+	EXPECT_EQ(n, memoized.getHits() + memoized.getMisses());
+	EXPECT_EQ(16, memoized.getMisses());
+
+	memoized.run(arguments, ResultView(narrow.data()), n);
+	for (size_t i = 0; i < n; ++i)
+		EXPECT_EQ(float(expected[i]), narrow[i]);
+	EXPECT_EQ(2 * n - 16, memoized.getHits());
+}
+
+TEST(MemoizationTests, Collisions) {
+	// more distinct tuples than entries, results stay correct when entries are replaced
+	Program program("x * 3 + y");
+	MemoizedProgram memoized(program, 8);
+	const size_t n = 5000;
+	std::vector<double> x(n), y(n), expected(n), results(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = double(i % 37);
+		y[i] = i % 2 ? 0.0 : -0.0;
+	}
+	ColumnView arguments[] = { x.data(), y.data() };
+	program.run(arguments, ResultView(expected.data()), n);
+	memoized.run(arguments, ResultView(results.data()), n);
+	EXPECT_EQ(expected, results);
+	EXPECT_GT(memoized.getMisses(), 8);
+}
+
+TEST(MemoizationTests, Concurrent) {
+	Program program("sin(x) * cos(x) + x");
+	MemoizedProgram memoized(program, 256);
+	const size_t n = 20000;
+	std::vector<double> x(n), expected(n);
+	for (size_t i = 0; i < n; ++i)
+		x[i] = 0.25 * double(i % 300);
+	ColumnView arguments[] = { x.data() };
+	program.run(arguments, ResultView(expected.data()), n);
+
+	std::vector<std::vector<double>> results(4, std::vector<double>(n));
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < results.size(); ++t) {
+		threads.emplace_back([&, t]() {
+			Program::Context context;
+			memoized.runRange(context, arguments, ResultView(results[t].data()), 0, n);
+		});
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+	for (const std::vector<double> &result : results)
+		EXPECT_EQ(expected, result);
+	EXPECT_EQ(4 * n, memoized.getHits() + memoized.getMisses());
+}
@@ -1,8 +1,11 @@
 #include <gtest/gtest.h>
 
 #include "optimizations.hpp"
+#include "program.hpp"
 
+#include <cmath>
 #include <utility>
+#include <vector>
 
 using std::move;
 using std::swap;
@@ -71,3 +74,216 @@ TEST_F(OptimizationsTests, FlattenSum1) {
 
 	EXPECT_EQ(x_y_z_sum_ast, ast);
 }
+
+TEST_F(OptimizationsTests, CompressStackSwapsSum) {
+	Ast ast(OP_ADD);
+	ast.children.emplace_back(x_ast);
+	ast.children.emplace_back(x_y_sum_ast);
+
+	optimizer.compressStack(&ast);
+
+	Ast expected(OP_ADD);
+	expected.children.emplace_back(x_y_sum_ast);
+	expected.children.emplace_back(x_ast);
+	EXPECT_EQ(expected, ast);
+	EXPECT_EQ(2, ast.stack_size_needed);
+}
+
+TEST_F(OptimizationsTests, CompressStackReversesSubtraction) {
+	Ast ast(OP_SUB);
+	ast.children.emplace_back(x_ast);
+	ast.children.emplace_back(x_y_sum_ast);
+
+	optimizer.compressStack(&ast);
+
+	Ast expected(OP_RSUB);
+	expected.children.emplace_back(x_y_sum_ast);
+	expected.children.emplace_back(x_ast);
+	EXPECT_EQ(expected, ast);
+	EXPECT_EQ(2, ast.stack_size_needed);
+}
+
+TEST_F(OptimizationsTests, CompressStackRestoresSubtraction) {
+	Ast ast(OP_RSUB);
+	ast.children.emplace_back(x_ast);
+	ast.children.emplace_back(x_y_sum_ast);
+
+	optimizer.compressStack(&ast);
+
+	EXPECT_EQ(x_y_sum_ast, ast.children[0]);
+	EXPECT_EQ(OP_SUB, ast.op);
+}
+
+TEST_F(OptimizationsTests, CompressStackKeepsBalancedOperands) {
+	Ast ast(OP_DIV);
+	ast.children.emplace_back(x_y_sum_ast);
+	ast.children.emplace_back(x_y_sum_ast);
+
+	optimizer.compressStack(&ast);
+
+	EXPECT_EQ(OP_DIV, ast.op);
+	EXPECT_EQ(3, ast.stack_size_needed);
+}
+
+TEST_F(OptimizationsTests, CompressStackFlattenedSum) {
+	Ast product(OP_MUL);
+	product.children.emplace_back(x_minus_y_ast);
+	product.children.emplace_back(x_y_sum_ast);
+
+	Ast ast(OP_ADD);
+	ast.children.emplace_back(x_ast);
+	ast.children.emplace_back(y_ast);
+	ast.children.emplace_back(product);
+	ast.children.emplace_back(z_ast);
+
+	// reordering the chain would reassociate the sum
+	Ast strict = ast;
+	optimizer.compressStack(&strict);
+	ASSERT_EQ(4, strict.children.size());
+	EXPECT_EQ(x_ast, strict.children[0]);
+	EXPECT_EQ(OP_MUL, strict.children[2].op);
+	EXPECT_EQ(4, strict.stack_size_needed);
+
+	optimizer.compressStackRelaxed(&ast);
+
+	ASSERT_EQ(4, ast.children.size());
+	EXPECT_EQ(OP_MUL, ast.children[0].op);
+	EXPECT_EQ(x_ast, ast.children[1]);
+	EXPECT_EQ(y_ast, ast.children[2]);
+	EXPECT_EQ(z_ast, ast.children[3]);
+	EXPECT_EQ(3, ast.stack_size_needed);
+}
+
+TEST_F(OptimizationsTests, RecognizeIntrinsics) {
+	Ast log_ast(OP_LOG);
+	log_ast.children.emplace_back(OP_ADD);
+	log_ast.children[0].children.emplace_back(OP_CONST);
+	log_ast.children[0].children[0].d = 1.0;
+	log_ast.children[0].children.emplace_back(x_ast);
+	optimizer.recognizeIntrinsics(&log_ast);
+	EXPECT_EQ(OP_LOG1P, log_ast.op);
+	EXPECT_EQ(x_ast, log_ast.children[0]);
+
+	Ast sqrt_ast(OP_SQRT);
+	sqrt_ast.children.emplace_back(OP_ADD);
+	sqrt_ast.children[0].children.emplace_back(OP_SQ);
+	sqrt_ast.children[0].children[0].children.emplace_back(x_ast);
+	sqrt_ast.children[0].children.emplace_back(OP_MUL);
+	sqrt_ast.children[0].children[1].children.emplace_back(y_ast);
+	sqrt_ast.children[0].children[1].children.emplace_back(y_ast);
+	optimizer.recognizeIntrinsics(&sqrt_ast);
+	EXPECT_EQ(OP_HYPOT, sqrt_ast.op);
+	EXPECT_EQ(x_ast, sqrt_ast.children[0]);
+	EXPECT_EQ(y_ast, sqrt_ast.children[1]);
+}
+
+TEST_F(OptimizationsTests, ShareSinCos) {
+	Ast ast(OP_ADD);
+	ast.children.emplace_back(OP_COS);
+	ast.children[0].children.emplace_back(x_minus_y_ast);
+	ast.children.emplace_back(OP_SIN);
+	ast.children[1].children.emplace_back(x_minus_y_ast);
+	optimizer.shareSinCos(&ast);
+	EXPECT_EQ(OP_COSSIN, ast.children[0].op);
+	EXPECT_EQ(OP_SINCOS, ast.children[1].op);
+	EXPECT_EQ(ast.children[0].i, ast.children[1].i);
+}
+
+TEST_F(OptimizationsTests, ShareSinCosDeep) {
+	// sin(sin(...sin(x))) + cos(sin(...sin(x))), where only the outermost arguments match
+	const size_t depth = 200000;
+	Ast chain = Program::parse("x").children[0];
+	for (size_t i = 0; i < depth; ++i) {
+		Ast sin(OP_SIN);
+		sin.children.emplace_back(move(chain));
+		chain = move(sin);
+	}
+	Ast ast(OP_ADD);
+	ast.children.emplace_back(OP_COS);
+	ast.children[0].children.push_back(chain.children[0]);
+	ast.children.emplace_back(move(chain));
+	optimizer.shareSinCos(&ast);
+	EXPECT_EQ(OP_COSSIN, ast.children[0].op);
+	EXPECT_EQ(OP_SINCOS, ast.children[1].op);
+	EXPECT_EQ(OP_SIN, ast.children[1].children[0].op);
+
+	Program program("sin(x) * cos(x) + cos(x)");
+	double args[] = { 0.7 };
+	EXPECT_EQ(std::sin(0.7) * std::cos(0.7) + std::cos(0.7), program.run(args));
+}
+
+TEST_F(OptimizationsTests, ShareSubexpressions) {
+	Ast ast = Program::parse("exp(x - y) * 2 + exp(x - y) * z, exp(x - y) + (x - y)");
+	optimizer.shareSubexpressions(&ast);
+	std::vector<const Ast *> stores;
+	std::vector<const Ast *> stack = { &ast };
+	while (stack.size() > 0) {
+		const Ast *node = stack.back();
+		stack.pop_back();
+		if (node->op == OP_STORE)
+			stores.push_back(node);
+		for (const Ast &child : node->children)
+			stack.push_back(&child);
+	}
+
+	// x - y occurs once more than the exponentials, so it is shared on its own as well
+	ASSERT_EQ(7, stores.size());
+	std::vector<long> slots[2]; // of the exponentials and of the differences
+	for (const Ast *store : stores) {
+		bool is_exponential = store->children[0].op == OP_EXP;
+		if (is_exponential) {
+			EXPECT_EQ(OP_STORE, store->children[0].children[0].op);
+		}
+		slots[is_exponential ? 0 : 1].push_back(store->i);
+	}
+	EXPECT_EQ(std::vector<long>(3, slots[0][0]), slots[0]);
+	EXPECT_EQ(std::vector<long>(4, slots[1][0]), slots[1]);
+	EXPECT_NE(slots[0][0], slots[1][0]);
+
+	// sharing again gives the same tree
+	Ast again = ast;
+	optimizer.shareSubexpressions(&again);
+	EXPECT_EQ(ast, again);
+
+	// subtrees that only occur within a shared one are not shared on their own
+	Ast nested = Program::parse("sqrt(x * y + 1) + sqrt(x * y + 1)");
+	optimizer.shareSubexpressions(&nested);
+	EXPECT_EQ(OP_STORE, nested.children[0].children[0].op);
+	EXPECT_EQ(OP_SQRT, nested.children[0].children[0].children[0].op);
+	EXPECT_EQ(OP_ADD, nested.children[0].children[0].children[0].children[0].op);
+}
+
+TEST_F(OptimizationsTests, SimplifyRelaxed) {
+	auto simplified = [&](const char *src) {
+		Ast ast = Program::parse(src);
+		optimizer.simplifyRelaxed(&ast);
+		return move(ast.children[0]);
+	};
+	auto node = [](Op op, std::initializer_list<Ast> children) {
+		Ast ast(op);
+		ast.children = children;
+		return ast;
+	};
+	auto constant = [](double value) {
+		Ast ast(OP_CONST);
+		ast.d = value;
+		return ast;
+	};
+
+	EXPECT_EQ(x_ast, simplified("(x * 1 + 0) / 1 - 0"));
+	EXPECT_EQ(x_ast, simplified("exp(log(-(-x)))"));
+	EXPECT_EQ(node(OP_ABS, { x_ast }), simplified("sqrt(x*x)"));
+	EXPECT_EQ(constant(0.0), simplified("x - x"));
+	EXPECT_EQ(constant(0.0), simplified("0 * sin(x)"));
+
+	// constants are collected across nested sums and products
+	EXPECT_EQ(node(OP_ADD, { x_ast, y_ast, constant(6.0) }), simplified("1 + (x + 2) + (y + 3)"));
+	EXPECT_EQ(node(OP_MUL, { constant(6.0), x_ast, y_ast }), simplified("2 * (x * 3) * y"));
+
+	// like terms are merged, repeated factors become powers
+	EXPECT_EQ(node(OP_MUL, { constant(2.0), y_ast }), simplified("x + y + -(x + -y)"));
+	EXPECT_EQ(node(OP_CU, { x_ast }), simplified("x * x * x"));
+
+	// common factors are extracted
+	EXPECT_EQ(node(OP_MUL, { x_ast, node(OP_ADD, { y_ast, z_ast }) }), simplified("x * y + z * x"));
+}
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+
+#include "passes.hpp"
+#include "program.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+TEST(PassesTests, Pipeline) {
+	PassManager passes;
+	passes.addPasses("subtraction-to-sum, flatten-sum");
+	Ast ast = Program::parse("x - y - z");
+	passes.run(&ast);
+
+	// x + -y + -z
+	const Ast &sum = ast.children[0];
+	EXPECT_EQ(OP_ADD, sum.op);
+	ASSERT_EQ(3, sum.children.size());
+	EXPECT_EQ(OP_NEG, sum.children[2].op);
+	EXPECT_EQ(2, passes.getIterations());
+
+	const std::vector<PassManager::Statistics> &stats = passes.getStatistics();
+	ASSERT_EQ(2, stats.size());
+	EXPECT_EQ("subtraction-to-sum", stats[0].name);
+	EXPECT_EQ(2, stats[0].runs);
+	EXPECT_EQ(7, stats[1].nodes_after);
+}
+
+TEST(PassesTests, UnknownPass) {
+	PassManager passes;
+	EXPECT_THROW(passes.addPass("no-such-pass"), std::invalid_argument);
+}
+
+TEST(PassesTests, IterationLimit) {
+	PassManager passes;
+	passes.addPasses("fold-constants");
+	passes.setMaxIterations(1);
+	Ast ast = Program::parse("1 + 2");
+	passes.run(&ast);
+	EXPECT_EQ(1, passes.getIterations());
+	EXPECT_EQ(OP_CONST, ast.children[0].op);
+}
+
+TEST(PassesTests, CustomPipelineProgram) {
+	PassManager passes;
+	passes.addPasses("powi,fold-constants");
+	Program program("pow(x, 2) + 2 * 3", passes);
+	double args[] = { 3.0 };
+	EXPECT_EQ(15.0, program.run(args));
+	// the second iteration finds nothing left to change
+	EXPECT_EQ(2, passes.getStatistics()[0].runs);
+}
+
+TEST(PassesTests, Normalize) {
+	// powers, double negations and constants in one traversal, so the folded exponent is
+	// seen by its power
+	PassManager passes;
+	passes.addPasses("normalize");
+	passes.setMaxIterations(1);
+	Ast ast = Program::parse("pow(x, 1 + 1) + -(-pow(2, 3)) + pow(y, 1) + pi * 2");
+	passes.run(&ast);
+	Ast expected(OP_ADD);
+	expected.children.emplace_back(OP_ADD);
+	expected.children[0].children.emplace_back(OP_ADD);
+	Ast &inner = expected.children[0].children[0];
+	inner.children.emplace_back(OP_SQ);
+	inner.children[0].children.emplace_back(OP_ARG);
+	inner.children.emplace_back(OP_CONST);
+	inner.children[1].d = 8.0;
+	expected.children[0].children.emplace_back(OP_NOOP);
+	expected.children[0].children[1].children.emplace_back(OP_ARG);
+	expected.children[0].children[1].children[0].i = 1;
+	expected.children.emplace_back(OP_CONST);
+	expected.children[1].d = 2.0 * 3.14159265358979323846;
+	EXPECT_EQ(expected, ast.children[0]);
+
+	// the same rewrites as the separate passes
+	const char *sources[] = { "pow(x, 3) * pow(2, -1) - -(-y)", "pow(x, 2.5) + sin(1) * e" };
+	for (const char *src : sources) {
+		Ast normalized = Program::parse(src);
+		Ast separate = normalized;
+		passes.run(&normalized);
+		PassManager three;
+		three.addPasses("powi,fold-constants,fold-double-minus");
+		three.setMaxIterations(1);
+		three.run(&separate);
+		EXPECT_EQ(separate, normalized) << src;
+	}
+}
+
+TEST(PassesTests, Precise) {
+	const char *src = "x - y - (z - 1) * 2 - -x";
+	Program precise(src, Program::OPTIMIZE_PRECISE);
+	Program strict(src, Program::OPTIMIZE_STRICT);
+	double args[] = { 1.5, 2.0, 4.0 };
+	EXPECT_EQ(strict.run(args), precise.run(args));
+	EXPECT_LE(precise.getStackSize(), strict.getStackSize());
+}
+
+TEST(PassesTests, FoldConstantOperands) {
+	PassManager passes;
+	passes.addPasses("flatten-sum,fold-constant-operands");
+	Ast ast = Program::parse("(1 + x) + (2 + y) + 3");
+	passes.run(&ast);
+	ASSERT_EQ(OP_ADD, ast.children[0].op);
+	ASSERT_EQ(3, ast.children[0].children.size());
+	EXPECT_EQ(OP_CONST, ast.children[0].children[0].op);
+	EXPECT_EQ(6.0, ast.children[0].children[0].d);
+	EXPECT_EQ(OP_ARG, ast.children[0].children[1].op);
+	EXPECT_EQ(OP_ARG, ast.children[0].children[2].op);
+
+	// the constant siblings of flattened sums and products are combined at FAST
+	for (const char *src : { "x + 2 + y - 3 + 4", "2*x*3*y" }) {
+		Ast optimized = Program::parse(src);
+		PassManager::forLevel(Program::OPTIMIZE_FAST).run(&optimized);
+		size_t constants = 0;
+		for (const Ast &child : optimized.children[0].children)
+			constants += child.op == OP_CONST;
+		EXPECT_EQ(1, constants) << src;
+	}
+}
+
+TEST(PassesTests, PreciseKeepsRounding) {
+	// sums and products that aren't associative in floating point, the precise level gives
+	// the results of the strict level bit for bit
+	const char *sources[] = {
+		"1e16 + x - 1e16", "x + 1e16 - 1e16 + y", "x + 2 + y - 3 + 4", "0.1 * x * 3 * y",
+		"(x + y) + (x + 1e-17)", "log(1 + x) + exp(y) - 1", "sqrt(x*x + y*y) * 1e300 * 1e10",
+	};
+	double rows[][2] = { { 1.0, 2.0 }, { 0.1, 0.7 }, { 1e-17, -3.0 }, { 1e300, 1e-300 } };
+	for (const char *src : sources) {
+		Program strict(src, Program::OPTIMIZE_STRICT);
+		Program precise(src, Program::OPTIMIZE_PRECISE);
+		for (auto &row : rows) {
+			double expected = strict.run(row);
+			double result = precise.run(row);
+			EXPECT_EQ(0, std::memcmp(&expected, &result, sizeof(double)))
+				<< src << " at " << row[0] << ", " << row[1];
+		}
+	}
+	double args[] = { 1.0, 2.0 };
+	EXPECT_EQ(0.0, Program("1e16 + x - 1e16", Program::OPTIMIZE_PRECISE).run(args));
+}
+
+TEST(PassesTests, DeepSums) {
+	// a left-deep chain of parenthesized sums is flattened into one sum in linear time
+	const int n = 200000;
+	std::string nested(n, '(');
+	nested += "x";
+	for (int i = 0; i < n; ++i)
+		nested += "+y)";
+	PassManager passes;
+	passes.addPasses("flatten-sum");
+	Ast ast = Program::parse(nested.c_str());
+	passes.run(&ast);
+	ASSERT_EQ(OP_ADD, ast.children[0].op);
+	EXPECT_EQ(n + 1, ast.children[0].children.size());
+	EXPECT_EQ(OP_ARG, ast.children[0].children[0].op);
+	EXPECT_EQ(0, ast.children[0].children[0].i);
+
+	// the iterated pipelines handle a million nodes
+	std::string sum = "x";
+	sum.reserve(2 * 500000 + 1);
+	for (int i = 0; i < 500000; ++i)
+		sum += "+x";
+	double args[] = { 1.0, 2.0 };
+	EXPECT_EQ(500001.0, Program(sum.c_str(), Program::OPTIMIZE_PRECISE).run(args));
+	EXPECT_EQ(n * 2.0 + 1.0, Program(nested.c_str(), Program::OPTIMIZE_FAST).run(args));
+}
@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "program.hpp"
+
+#include <string>
+#include <vector>
+
+#ifdef MINT_PROFILE
+
+TEST(ProfileTests, CountsInstructions) {
+	Program program("sin(x) + 2", Program::OPTIMIZE_NOTHING);
+	double args[] = { 1.0 };
+	program.run(args);
+	program.run(args);
+
+	// ARG, SIN, CONST, ADD, HLT
+	const Profile &profile = program.getProfile();
+	EXPECT_EQ(2, profile.offsets[0].executions);
+	EXPECT_EQ(2, profile.offsets[2].executions);
+	EXPECT_EQ(0, profile.offsets[1].executions);
+
+	std::vector<double> x(1000, 1.0), result(1000);
+	program.resetProfile();
+	ColumnView columns[] = { x.data() };
+	program.run(columns, ResultView(result.data()), x.size());
+	EXPECT_EQ(4, profile.offsets[2].executions);
+	EXPECT_EQ(1000, profile.offsets[2].rows);
+}
+
+TEST(ProfileTests, ReportShowsSource) {
+	Program program("x * pow(y, 0.5)", Program::OPTIMIZE_NOTHING);
+	double args[] = { 1.0, 4.0 };
+	program.run(args);
+	std::string report = program.getProfileReport();
+	EXPECT_NE(std::string::npos, report.find("POW"));
+	EXPECT_NE(std::string::npos, report.find("4 pow"));
+	EXPECT_NE(std::string::npos, report.find("2 *"));
+}
+
+#else
+
+TEST(ProfileTests, DisabledCollectsNothing) {
+	Program program("sin(x) + 2");
+	double args[] = { 1.0 };
+	program.run(args);
+	EXPECT_TRUE(program.getProfile().offsets.empty());
+}
+
+#endif
@@ -0,0 +1,399 @@
+#include <gtest/gtest.h>
+
+#include "program.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+TEST(ProgramTests, Constant) {
+	Program program("1.5");
+	EXPECT_EQ(1.5, program.run(nullptr));
+	EXPECT_EQ(1, program.getStackSize());
+	EXPECT_EQ(0, program.getArgumentNumber());
+}
+
+TEST(ProgramTests, Arguments) {
+	Program program("x + y * z");
+	double args[] = { 1.0, 2.0, 3.0 };
+	EXPECT_EQ(7.0, program.run(args));
+	EXPECT_EQ(3, program.getArgumentNumber());
+}
+
+TEST(ProgramTests, Functions) {
+	Program program("sqrt(x) + sin(y) - pow(z, 0.5)");
+	double args[] = { 4.0, 0.5, 9.0 };
+	EXPECT_EQ(std::sqrt(4.0) + std::sin(0.5) - std::pow(9.0, 0.5), program.run(args));
+}
+
+TEST(ProgramTests, Batch) {
+	Program program("x * y - 1");
+	double x[] = { 1.0, 2.0, 3.0 };
+	double y[] = { 4.0, 5.0, 6.0 };
+	double *args[] = { x, y };
+	double result[3];
+	program.run(args, result, 3);
+	EXPECT_EQ(3.0, result[0]);
+	EXPECT_EQ(9.0, result[1]);
+	EXPECT_EQ(17.0, result[2]);
+}
+
+TEST(ProgramTests, StackIsSizedExactly) {
+	// a right-leaning chain that cannot be rebalanced needs one slot per level
+	std::string src = "x";
+	for (int i = 0; i < 200; ++i)
+		src = "x/(" + src + ")";
+	Program program(src.c_str(), Program::OPTIMIZE_NOTHING);
+	EXPECT_EQ(201, program.getStackSize());
+	double args[] = { 2.0 };
+	EXPECT_EQ(2.0, program.run(args));
+}
+
+TEST(ProgramTests, ParsingError) {
+	EXPECT_THROW(Program("x +"), std::invalid_argument);
+}
+
+TEST(ProgramTests, ReversedOperators) {
+	Program program("x - (y + z*x) / pow(x, y*z - x)");
+	double args[] = { 1.5, 2.0, 3.0 };
+	double x = args[0], y = args[1], z = args[2];
+	EXPECT_EQ(x - (y + z*x) / std::pow(x, y*z - x), program.run(args));
+	EXPECT_EQ(3, program.getStackSize());
+}
+
+TEST(ProgramTests, ManyConstants) {
+	// enough distinct constants to need 16 bit indices
+	std::string src = "0";
+	double expected = 0.0;
+	for (int i = 1; i <= 1000; ++i) {
+		src += "+" + std::to_string(i) + ".5*x";
+		expected += (i + 0.5) * 2.0;
+	}
+	Program program(src.c_str(), Program::OPTIMIZE_NOTHING);
+	double args[] = { 2.0 };
+	EXPECT_EQ(expected, program.run(args));
+}
+
+TEST(ProgramTests, WideArgumentIndex) {
+	Program program("$300 - $1");
+	EXPECT_EQ(300, program.getArgumentNumber());
+	std::vector<double> args(300, 1.0);
+	args[299] = 5.0;
+	EXPECT_EQ(4.0, program.run(args.data()));
+}
+
+TEST(ProgramTests, NegativeZeroIsNotMergedWithZero) {
+	// -0 is folded into a constant, x/0 + x/(-0) = inf - inf
+	Program program("x/0 + x/(-0)");
+	double args[] = { 1.0 };
+	EXPECT_TRUE(std::isnan(program.run(args)));
+}
+
+TEST(ProgramTests, DeepExpression) {
+	// a left-leaning chain with a million nodes compiles without recursion
+	const int n = 500000;
+	std::string src = "x";
+	src.reserve(2 * n + 1);
+	for (int i = 0; i < n; ++i)
+		src += "+x";
+	Program program(src.c_str());
+	double args[] = { 1.0 };
+	EXPECT_EQ(n + 1.0, program.run(args));
+	EXPECT_EQ(2, program.getStackSize());
+}
+
+TEST(ProgramTests, BatchCrossesBlocks) {
+	Program program("sin(x) * y + 2");
+	const size_t n = 1000;
+	std::vector<double> x(n), y(n), result(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = 0.01 * i;
+		y[i] = 1.0 + i;
+	}
+	double *args[] = { x.data(), y.data() };
+	program.run(args, result.data(), n);
+	for (size_t i = 0; i < n; ++i) {
+		double row[] = { x[i], y[i] };
+		EXPECT_EQ(program.run(row), result[i]);
+	}
+}
+
+TEST(ProgramTests, ArrayOfStructsLayout) {
+	struct Row {
+		double params[4];
+		float weight;
+		int32_t count;
+	};
+	Row rows[300];
+	for (int i = 0; i < 300; ++i) {
+		rows[i] = { { 1.0 * i, 2.0, 0.5 * i, 4.0 }, 0.25f * i, i % 7 };
+	}
+	Program program("x * z + w + y");
+	ColumnView args[] = {
+		ColumnView(&rows[0].weight, sizeof(Row), TYPE_FLOAT32),
+		ColumnView(&rows[0].count, sizeof(Row), TYPE_INT32),
+		ColumnView(&rows[0].params[2], sizeof(Row), TYPE_FLOAT64),
+		ColumnView(&rows[0].params[3], sizeof(Row), TYPE_FLOAT64),
+	};
+
+	// write every result into the first parameter of its row
+	program.run(args, ResultView(&rows[0].params[0], sizeof(Row), TYPE_FLOAT64), 300);
+
+	for (int i = 0; i < 300; ++i) {
+		EXPECT_EQ(0.25 * i * 0.5 * i + 4.0 + (i % 7), rows[i].params[0]);
+	}
+}
+
+TEST(ProgramTests, FloatResult) {
+	Program program("x / 3");
+	int64_t x[] = { 1, 2, 3 };
+	float result[3];
+	ColumnView args[] = { ColumnView(x) };
+	program.run(args, ResultView(result), 3);
+	EXPECT_EQ(float(1.0 / 3), result[0]);
+	EXPECT_EQ(float(2.0 / 3), result[1]);
+	EXPECT_EQ(1.0f, result[2]);
+}
+
+TEST(ProgramTests, SelectionDense) {
+	Program program("x * y");
+	const size_t n = 1000;
+	std::vector<double> x(n), y(n);
+	std::vector<size_t> selection;
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = double(i);
+		y[i] = 0.5;
+		if (i % 7 == 3)
+			selection.push_back(i);
+	}
+	ColumnView args[] = { ColumnView(x.data()), ColumnView(y.data()) };
+	std::vector<double> result(selection.size());
+	program.runSelected(args, ResultView(result.data()), selection.data(), selection.size());
+	for (size_t j = 0; j < selection.size(); ++j) {
+		EXPECT_EQ(0.5 * selection[j], result[j]);
+	}
+}
+
+TEST(ProgramTests, SelectionScattered) {
+	Program program("x + 1");
+	double x[] = { 1, 2, 3, 4, 5 };
+	double result[] = { -1, -1, -1, -1, -1 };
+	size_t selection[] = { 4, 1 };
+	ColumnView args[] = { ColumnView(x) };
+	program.runSelected(args, ResultView(result), selection, 2, RESULT_SCATTERED);
+	EXPECT_EQ(-1.0, result[0]);
+	EXPECT_EQ(3.0, result[1]);
+	EXPECT_EQ(-1.0, result[2]);
+	EXPECT_EQ(-1.0, result[3]);
+	EXPECT_EQ(6.0, result[4]);
+}
+
+TEST(ProgramTests, Bitmask) {
+	Program program("2 * x");
+	const size_t n = 600;
+	std::vector<double> x(n);
+	std::vector<uint64_t> mask((n + 63) / 64, 0);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = double(i);
+		if (i % 3 == 0)
+			mask[i / 64] |= uint64_t(1) << (i % 64);
+	}
+	// bits beyond n are ignored
+	mask.back() |= ~uint64_t(0) << (n % 64);
+	ColumnView args[] = { ColumnView(x.data()) };
+
+	std::vector<double> dense(n, -1.0);
+	program.runMasked(args, ResultView(dense.data()), mask.data(), n);
+	std::vector<double> scattered(n, -1.0);
+	program.runMasked(args, ResultView(scattered.data()), mask.data(), n, RESULT_SCATTERED);
+
+	size_t j = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (i % 3 == 0) {
+			EXPECT_EQ(2.0 * i, dense[j++]);
+			EXPECT_EQ(2.0 * i, scattered[i]);
+		} else {
+			EXPECT_EQ(-1.0, scattered[i]);
+		}
+	}
+	EXPECT_EQ(-1.0, dense[j]);
+}
+
+TEST(ProgramTests, Predicate) {
+	Program program("x > 0 && y < 5 || !(z == 1)");
+	double args1[] = { 1.0, 4.0, 1.0 };
+	EXPECT_EQ(1.0, program.run(args1));
+	double args2[] = { -1.0, 4.0, 1.0 };
+	EXPECT_EQ(0.0, program.run(args2));
+	double args3[] = { -1.0, 4.0, 2.0 };
+	EXPECT_EQ(1.0, program.run(args3));
+}
+
+TEST(ProgramTests, ComparisonPrecedence) {
+	Program program("x + 1 >= 2 * y == 1");
+	double args[] = { 3.0, 2.0 };
+	EXPECT_EQ(1.0, program.run(args));
+}
+
+TEST(ProgramTests, Select) {
+	// piecewise function, evaluated without branches in batch mode
+	Program program("if(x < 0, -x, sqrt(x)) + if(x != x, 100, 0)");
+	const size_t n = 600;
+	std::vector<double> x(n), result(n);
+	for (size_t i = 0; i < n; ++i)
+		x[i] = (double(i) - 300.0) / 7.0;
+	double *args[] = { x.data() };
+	program.run(args, result.data(), n);
+	for (size_t i = 0; i < n; ++i) {
+		EXPECT_EQ(x[i] < 0 ? -x[i] : std::sqrt(x[i]), result[i]);
+	}
+}
+
+TEST(ProgramTests, SelectIsFolded) {
+	Program program("if(1 > 2, 3, 4)");
+	EXPECT_EQ(4.0, program.run(nullptr));
+	EXPECT_EQ(1, program.getStackSize());
+}
+
+TEST(ProgramTests, SinCos) {
+	const char *src = "sin(x * y) * 2 + cos(x * y) + sin(y) - cos(x)";
+	Program program(src);
+	Program plain(src, Program::OPTIMIZE_NOTHING);
+	double args[] = { 0.7, 1.3 };
+	EXPECT_EQ(plain.run(args), program.run(args));
+
+	std::vector<double> x(300), y(300), result(300), expected(300);
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = i * 0.01;
+		y[i] = 1.0 - i * 0.02;
+	}
+	double *columns[] = { x.data(), y.data() };
+	program.run(columns, result.data(), x.size());
+	plain.run(columns, expected.data(), x.size());
+	EXPECT_EQ(expected, result);
+}
+
+TEST(ProgramTests, Intrinsics) {
+	double args[] = { 1e-10, 1e200 };
+	EXPECT_EQ(std::log1p(1e-10), Program("log(1 + x)", Program::OPTIMIZE_FAST).run(args));
+	EXPECT_EQ(std::expm1(1e-10), Program("exp(x) - 1", Program::OPTIMIZE_FAST).run(args));
+	EXPECT_EQ(1e200, Program("sqrt(y*y + x^2)", Program::OPTIMIZE_FAST).run(args));
+	EXPECT_EQ(-2.0, Program("cbrt(-8)").run(args));
+
+	// the other levels keep the rounding of the original expression
+	EXPECT_EQ(std::log(1 + 1e-10), Program("log(1 + x)").run(args));
+	EXPECT_EQ(std::log(1 + 1e-10), Program("log(1 + x)", Program::OPTIMIZE_PRECISE).run(args));
+}
+
+TEST(ProgramTests, RelaxedSimplifications) {
+	double args[] = { 0.3, 0.7, 1.9 };
+	const char *src = "(x + y) - (x - y) + exp(log(z)) * 1";
+	Program fast(src, Program::OPTIMIZE_FAST);
+	EXPECT_DOUBLE_EQ(2 * 0.7 + 1.9, fast.run(args));
+	EXPECT_LT(fast.estimateCost(), Program(src, Program::OPTIMIZE_PRECISE).estimateCost());
+
+	// other levels keep the expression, e.g. because x - x is NaN for infinite x
+	double inf[] = { INFINITY };
+	EXPECT_TRUE(std::isnan(Program("x - x", Program::OPTIMIZE_PRECISE).run(inf)));
+	EXPECT_EQ(0.0, Program("x - x", Program::OPTIMIZE_FAST).run(inf));
+}
+
+TEST(ProgramTests, MultipleOutputs) {
+	const char *sources[] = { "sqrt(x*x + y*y)", "arctan(y/x)", "sqrt(x*x + y*y) * cos(arctan(y/x))" };
+	Program program("sqrt(x*x + y*y), arctan(y/x), sqrt(x*x + y*y) * cos(arctan(y/x))");
+	EXPECT_EQ(3, program.getOutputNumber());
+	EXPECT_EQ(1, Program(sources[0]).getOutputNumber());
+
+	// the shared subexpressions are computed once
+	double separate_cost = 0.0;
+	for (const char *src : sources)
+		separate_cost += Program(src).estimateCost();
+	EXPECT_LT(program.estimateCost(), separate_cost);
+
+	double args[] = { 0.6, 0.8 };
+	double outputs[3];
+	program.run(args, outputs);
+	for (size_t k = 0; k < 3; ++k)
+		EXPECT_EQ(Program(sources[k]).run(args), outputs[k]);
+	EXPECT_EQ(outputs[0], program.run(args));
+
+	const size_t n = 300;
+	std::vector<double> x(n), y(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = 0.5 + i * 0.01;
+		y[i] = 1.0 - i * 0.02;
+	}
+	ColumnView columns[] = { ColumnView(x.data()), ColumnView(y.data()) };
+	std::vector<double> results[3], expected(n);
+	std::vector<float> narrow(n);
+	ResultView views[3];
+	for (size_t k = 0; k < 3; ++k) {
+		results[k].resize(n);
+		views[k] = ResultView(results[k].data());
+	}
+	views[1] = ResultView(narrow.data());
+	program.run(columns, views, n);
+	for (size_t k = 0; k < 3; ++k) {
+		Program(sources[k]).run(columns, ResultView(expected.data()), n);
+		if (k == 1) {
+			for (size_t i = 0; i < n; ++i)
+				EXPECT_EQ(float(expected[i]), narrow[i]);
+		} else {
+			EXPECT_EQ(expected, results[k]);
+		}
+	}
+}
+
+TEST(ProgramTests, SharedSubexpressions) {
+	const char *src = "exp(x*y) + 1/exp(x*y) + (x*y > 1)";
+	Program program(src);
+	Program plain(src, Program::OPTIMIZE_NOTHING);
+	EXPECT_LT(program.estimateCost(), plain.estimateCost());
+	double args[] = { 0.7, 1.3 };
+	EXPECT_EQ(plain.run(args), program.run(args));
+
+	std::vector<double> x(300), y(300), result(300), expected(300);
+	for (size_t i = 0; i < x.size(); ++i) {
+		x[i] = i * 0.01;
+		y[i] = 1.0 - i * 0.02;
+	}
+	double *columns[] = { x.data(), y.data() };
+	program.run(columns, result.data(), x.size());
+	plain.run(columns, expected.data(), x.size());
+	EXPECT_EQ(expected, result);
+}
+
+TEST(ProgramTests, SharedConstants) {
+	// after subtraction-to-sum, -0.5 occurs twice, and the second iteration folds it
+	const char *src = "(x-0.5)*y-0.5";
+	double args[] = { 1.3, 0.425 };
+	double expected = (1.3 - 0.5) * 0.425 - 0.5;
+	for (int optimize = Program::OPTIMIZE_NOTHING; optimize <= Program::OPTIMIZE_FAST; ++optimize)
+		EXPECT_NEAR(expected, Program(src, optimize).run(args), 1e-15) << optimize;
+
+	// constant subtrees are not shared
+	Ast ast = Program::parse("x + sqrt(2) * y + sqrt(2)");
+	Program::applyOptimizations(&ast, Program::OPTIMIZE_STRICT);
+	std::vector<const Ast *> stack = { &ast };
+	while (stack.size() > 0) {
+		const Ast *node = stack.back();
+		stack.pop_back();
+		EXPECT_NE(OP_STORE, node->op);
+		for (const Ast &child : node->children)
+			stack.push_back(&child);
+	}
+}
+
+TEST(ProgramTests, MisplacedCommas) {
+	EXPECT_THROW(Program("x,"), std::invalid_argument);
+	EXPECT_THROW(Program(", x"), std::invalid_argument);
+	EXPECT_THROW(Program("x,, y"), std::invalid_argument);
+	EXPECT_THROW(Program("x +, y"), std::invalid_argument);
+	EXPECT_THROW(Program("hypot(, x)"), std::invalid_argument);
+	EXPECT_THROW(Program("sin(x, y)"), std::invalid_argument);
+	EXPECT_THROW(Program("(x, y)"), std::invalid_argument);
+	EXPECT_THROW(Program("x + (y, z)"), std::invalid_argument);
+	EXPECT_THROW(Program("2*(x,y)"), std::invalid_argument);
+	EXPECT_THROW(Program("-(x, y)"), std::invalid_argument);
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "functions.hpp"
+#include "reductions.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST(ReductionsTests, SumMinMaxMean) {
+	Program program("x * 2 - 3");
+	std::vector<double> x(1000);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = double(i);
+	ColumnView args[] = { x.data() };
+	EXPECT_EQ(2.0 * 999 * 1000 / 2 - 3000, reduce(program, REDUCE_SUM, args, x.size()));
+	EXPECT_EQ(-3.0, reduce(program, REDUCE_MIN, args, x.size()));
+	EXPECT_EQ(1995.0, reduce(program, REDUCE_MAX, args, x.size()));
+	EXPECT_EQ(996.0, reduce(program, REDUCE_MEAN, args, x.size()));
+}
+
+TEST(ReductionsTests, Count) {
+	Program program("x >= 10 && x < 20");
+	std::vector<double> x(100);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = double(i);
+	ColumnView args[] = { x.data() };
+	EXPECT_EQ(10.0, reduce(program, REDUCE_COUNT, args, x.size()));
+}
+
+TEST(ReductionsTests, Empty) {
+	Program program("x");
+	ColumnView args[] = { static_cast<const double *>(nullptr) };
+	EXPECT_EQ(0.0, reduce(program, REDUCE_SUM, args, 0));
+	EXPECT_EQ(0.0, reduce(program, REDUCE_COUNT, args, 0));
+	EXPECT_TRUE(std::isnan(reduce(program, REDUCE_MEAN, args, 0)));
+	EXPECT_TRUE(std::isnan(reduce(program, REDUCE_MIN, args, 0)));
+}
+
+TEST(ReductionsTests, AccurateSum) {
+	// adding 0.1 one by one is off by more than 1e-6 after a million rows
+	Program program("x");
+	std::vector<double> x(1000000, 0.1);
+	ColumnView args[] = { x.data() };
+	EXPECT_NEAR(100000.0, reduce(program, REDUCE_SUM, args, x.size()), 1e-9);
+}
+
+TEST(ReductionsTests, ThreadsAreDeterministic) {
+	Program program("sin(x) * 1e10 + 1 / (x + 1)");
+	std::vector<double> x(300000);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = double(i) * 0.37;
+	ColumnView args[] = { x.data() };
+	double sum = reduce(program, REDUCE_SUM, args, x.size());
+	double max = reduce(program, REDUCE_MAX, args, x.size());
+	for (unsigned threads : { 2u, 3u, 8u }) {
+		EXPECT_EQ(sum, reduce(program, REDUCE_SUM, args, x.size(), threads));
+		EXPECT_EQ(max, reduce(program, REDUCE_MAX, args, x.size(), threads));
+	}
+}
+
+TEST(ReductionsTests, NativeFunctionThrows) {
+	FunctionRegistry functions;
+	functions.defineNative("checked", 1, [](const double *const *arguments, double *result,
+		size_t n)
+	{
+		for (size_t j = 0; j < n; ++j) {
+			if (arguments[0][j] < 0.0)
+				throw std::runtime_error("negative value");
+			result[j] = arguments[0][j];
+		}
+	});
+	Program program(Program::parse("checked(x)", &functions), &functions);
+	// negative values in chunks taken by the calling thread and by the others
+	std::vector<double> x(300000);
+	for (size_t i = 0; i < x.size(); ++i)
+		x[i] = i % 40000 == 39999 ? -1.0 : double(i);
+	ColumnView args[] = { x.data() };
+	for (unsigned threads : { 1u, 2u, 8u })
+		EXPECT_THROW(reduce(program, REDUCE_SUM, args, x.size(), threads), std::runtime_error);
+}
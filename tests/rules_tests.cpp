@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include "rules.hpp"
+#include "optimizations.hpp"
+#include "passes.hpp"
+#include "program.hpp"
+
+#include <stdexcept>
+
+static Ast parsed(const char *src) {
+	Ast root = Program::parse(src);
+	Ast ast = std::move(root.children[0]);
+	return ast;
+}
+
+TEST(RulesTests, Rewrite) {
+	RuleSet rules;
+	rules.addRule("exp(log(x))", "x");
+	rules.addRule("x*1", "x");
+	Ast ast = Program::parse("sin(exp(log(y * 1))) + exp(log(2))");
+	EXPECT_EQ(3, rules.rewrite(&ast));
+	EXPECT_EQ(Program::parse("sin(y) + 2"), ast);
+}
+
+TEST(RulesTests, RepeatedWildcards) {
+	RuleSet rules;
+	rules.addRule("x - x", "0");
+	Ast same = Program::parse("sin(y) - sin(y)");
+	Ast different = Program::parse("sin(y) - sin(x)");
+	rules.rewrite(&same);
+	rules.rewrite(&different);
+	EXPECT_EQ(Program::parse("0"), same);
+	EXPECT_EQ(Program::parse("sin(y) - sin(x)"), different);
+}
+
+TEST(RulesTests, GuardAndBuilder) {
+	RuleSet rules;
+	auto constants = [](const RuleSet::Match &match) {
+		return match[0].op == OP_CONST && match[1].op == OP_CONST;
+	};
+	rules.addRule("x * y", [](RuleSet::Match &match) {
+		Ast product(OP_CONST);
+		product.d = match[0].d * match[1].d;
+		return product;
+	}, constants);
+	Ast ast = Program::parse("(2 * 3) * 4 * x");
+	rules.rewrite(&ast);
+	EXPECT_EQ(Program::parse("24 * x"), ast);
+}
+
+TEST(RulesTests, FirstRuleWins) {
+	RuleSet rules;
+	rules.addRule("x + 0", "x");
+	rules.addRule("x + y", "y + x");
+	Ast ast = Program::parse("sin(y) + 0");
+	rules.rewrite(&ast);
+	EXPECT_EQ(Program::parse("sin(y)"), ast);
+}
+
+TEST(RulesTests, NewNodesAreRewritten) {
+	// the replacement of the first rule is matched by the second one
+	RuleSet rules;
+	rules.addRule("x - y", "x + -y");
+	rules.addRule("-(-x)", "x");
+	Ast ast = Program::parse("x - -y");
+	EXPECT_EQ(2, rules.rewrite(&ast));
+	EXPECT_EQ(parsed("x + y"), ast.children[0]);
+}
+
+TEST(RulesTests, RewriteLimit) {
+	// rules that undo each other stop after MAX_REWRITES
+	RuleSet rules;
+	rules.addRule("x + y", "y + x");
+	Ast ast = Program::parse("x + y");
+	EXPECT_EQ(RuleSet::MAX_REWRITES, rules.rewrite(&ast));
+}
+
+TEST(RulesTests, TreesAsRules) {
+	Ast x(OP_ARG);
+	Ast pattern(OP_SQ);
+	pattern.children.push_back(x);
+	Ast replacement(OP_MUL);
+	replacement.children.push_back(x);
+	replacement.children.push_back(x);
+	RuleSet rules;
+	rules.addRule(pattern, replacement);
+	Ast ast = Program::parse("cos(z)^2");
+	Optimizer().optimizePowersToIntegerExponents(&ast);
+	rules.rewrite(&ast);
+	EXPECT_EQ(Program::parse("cos(z) * cos(z)"), ast);
+}
+
+TEST(RulesTests, InvalidRules) {
+	RuleSet rules;
+	EXPECT_THROW(rules.addRule("x +", "x"), std::invalid_argument);
+	EXPECT_THROW(rules.addRule("x + 0", "y"), std::invalid_argument);
+	EXPECT_EQ(0, rules.getRuleNumber());
+}
+
+TEST(RulesTests, DeepExpression) {
+	std::string src = "x";
+	for (int i = 0; i < 100000; ++i)
+		src += "+0";
+	RuleSet rules;
+	rules.addRule("x + 0", "x");
+	Ast ast = Program::parse(src.c_str());
+	EXPECT_EQ(100000, rules.rewrite(&ast));
+	EXPECT_EQ(Program::parse("x"), ast);
+}
+
+TEST(RulesTests, RulesPass) {
+	PassManager passes;
+	passes.getRules().addRule("x * 0", "0");
+	passes.addPasses("rules,fold-constants");
+	Program program("sin(x) * 0 + 1", passes);
+	double args[] = { 1.0 };
+	EXPECT_EQ(1.0, program.run(args));
+}
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "functions.hpp"
+#include "scheduler.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+TEST(SchedulerTests, Grid) {
+	Program sum("x + y"), product("x * y"), sine("sin(x) - y");
+	std::vector<const Program *> programs = { &sum, &product, &sine };
+	const size_t n = 20000;
+	std::vector<double> x(n), y(n);
+	for (size_t i = 0; i < n; ++i) {
+		x[i] = i * 0.01;
+		y[i] = 1.0 - i * 0.001;
+	}
+	ColumnView args[] = { x.data(), y.data() };
+
+	for (unsigned threads : { 1u, 3u }) {
+		std::vector<std::vector<double>> results(3, std::vector<double>(n));
+		std::vector<float> floats(n);
+		ResultView views[] = { results[0].data(), results[1].data(), floats.data() };
+		GridOptions options;
+		options.threads = threads;
+		options.chunk_blocks = 4;
+		GridStatistics statistics = runGrid(programs, args, views, n, options);
+		EXPECT_EQ(3 * ((n + 1023) / 1024), statistics.tasks);
+		EXPECT_LE(statistics.stolen, statistics.tasks);
+
+		std::vector<double> expected(n);
+		sum.run(args, expected.data(), n);
+		EXPECT_EQ(expected, results[0]);
+		product.run(args, expected.data(), n);
+		EXPECT_EQ(expected, results[1]);
+		sine.run(args, expected.data(), n);
+		for (size_t i = 0; i < n; ++i)
+			EXPECT_EQ(float(expected[i]), floats[i]);
+	}
+}
+
+TEST(SchedulerTests, Empty) {
+	Program program("x");
+	std::vector<const Program *> programs = { &program };
+	ColumnView args[] = { static_cast<const double *>(nullptr) };
+	ResultView results[] = { static_cast<double *>(nullptr) };
+	EXPECT_EQ(0, runGrid(programs, args, results, 0).tasks);
+}
+
+TEST(SchedulerTests, UnsupportedResultType) {
+	Program program("x");
+	std::vector<const Program *> programs = { &program };
+	std::vector<int32_t> result(10);
+	ColumnView args[] = { static_cast<const double *>(nullptr) };
+	ResultView results[] = { ResultView(result.data(), sizeof(int32_t), TYPE_INT32) };
+	EXPECT_THROW(runGrid(programs, args, results, 10), std::invalid_argument);
+}
+
+TEST(SchedulerTests, NativeFunctionThrows) {
+	FunctionRegistry functions;
+	functions.defineNative("checked", 1, [](const double *const *arguments, double *result,
+		size_t n)
+	{
+		for (size_t j = 0; j < n; ++j) {
+			if (arguments[0][j] < 0.0)
+				throw std::runtime_error("negative value");
+			result[j] = arguments[0][j];
+		}
+	});
+	Program program(Program::parse("checked(x)", &functions), &functions);
+	Program sum("x + 1");
+	std::vector<const Program *> programs = { &sum, &program };
+	const size_t n = 100000;
+	std::vector<double> x(n), results[2];
+	for (size_t i = 0; i < n; ++i)
+		x[i] = i % 20000 == 19999 ? -1.0 : double(i);
+	ColumnView args[] = { x.data() };
+	for (std::vector<double> &result : results)
+		result.resize(n);
+	ResultView views[] = { results[0].data(), results[1].data() };
+	for (unsigned threads : { 1u, 2u, 8u }) {
+		GridOptions options;
+		options.threads = threads;
+		options.chunk_blocks = 4;
+		EXPECT_THROW(runGrid(programs, args, views, n, options), std::runtime_error);
+	}
+}
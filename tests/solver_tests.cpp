@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include "solver.hpp"
+#include "derivatives.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+TEST(SolverTests, SquareRoots) {
+	// x^2 - a = 0 for a in (0, 1000], with the bracket [0, 1000] broadcast to all rows
+	const size_t n = 1000;
+	std::vector<double> a(n), roots(n);
+	for (size_t i = 0; i < n; ++i)
+		a[i] = double(i + 1);
+	double lower = 0.0, upper = 1000.0;
+	ColumnView arguments[] = { ColumnView(), a.data() };
+	EXPECT_EQ(n, solve("x^2 - y", 0, arguments, ColumnView(&lower, 0, TYPE_FLOAT64),
+		ColumnView(&upper, 0, TYPE_FLOAT64), ResultView(roots.data()), n));
+	for (size_t i = 0; i < n; ++i)
+		EXPECT_NEAR(std::sqrt(a[i]), roots[i], 1e-12 * std::sqrt(a[i]));
+}
+
+TEST(SolverTests, Bisection) {
+	// the derivative is 0 at the bracket's midpoint and wrong elsewhere, bisection still converges
+	Program f("x^3 - 2");
+	Program bad("0");
+	double lower = -1.0, upper = 3.0, root;
+	ColumnView arguments[] = { ColumnView() };
+	EXPECT_EQ(1, solve(f, bad, 0, arguments, &lower, &upper, &root, 1));
+	EXPECT_NEAR(std::cbrt(2.0), root, 1e-13);
+
+	// without enough iterations the row doesn't converge
+	SolverOptions options;
+	options.max_iterations = 5;
+	EXPECT_EQ(0, solve(f, bad, 0, arguments, &lower, &upper, &root, 1, options));
+	EXPECT_TRUE(std::isnan(root));
+}
+
+TEST(SolverTests, Brackets) {
+	// per row brackets, roots on a bound, reversed bounds and brackets without a sign change
+	std::vector<double> lower = { 0.5, 1.0, 3.0, 2.5, 1.2 };
+	std::vector<double> upper = { 1.5, 3.0, 1.5, 5.0, 1.6 };
+	std::vector<float> roots(lower.size());
+	ColumnView arguments[] = { ColumnView() };
+	EXPECT_EQ(3, solve("(x - 1) * (x - 2)", 0, arguments, lower.data(), upper.data(),
+		ResultView(roots.data()), lower.size()));
+	EXPECT_EQ(1.0f, roots[0]);
+	EXPECT_EQ(1.0f, roots[1]);
+	EXPECT_EQ(2.0f, roots[2]);
+	EXPECT_TRUE(std::isnan(roots[3]));
+	EXPECT_TRUE(std::isnan(roots[4]));
+
+	double bound = 0.0, root;
+	EXPECT_THROW(solve("x", 1, arguments, &bound, &bound, &root, 1), std::invalid_argument);
+
+	// no columns are needed if the unknown is the only argument
+	double low = 0.0, high = 4.0;
+	EXPECT_EQ(1, solve("x^3 - 8", 0, nullptr, &low, &high, &root, 1));
+	EXPECT_NEAR(2.0, root, 1e-14);
+	EXPECT_THROW(solve("x * y - 1", 0, nullptr, &low, &high, &root, 1), std::invalid_argument);
+}
+
+TEST(SolverTests, Minimize) {
+	// (x - y)^2 + cos(x) has a minimum near y for y in [5, 6]
+	const size_t n = 300;
+	std::vector<double> y(n), minima(n), slopes(n);
+	for (size_t i = 0; i < n; ++i)
+		y[i] = 5.0 + double(i) / n;
+	double lower = 0.0, upper = 10.0;
+	ColumnView arguments[] = { ColumnView(), y.data() };
+	const char *src = "(x - y)^2 + cos(x)";
+	EXPECT_EQ(n, minimize(src, 0, arguments, ColumnView(&lower, 0, TYPE_FLOAT64),
+		ColumnView(&upper, 0, TYPE_FLOAT64), ResultView(minima.data()), n));
+	ColumnView at_minima[] = { minima.data(), y.data() };
+	compileDerivative(src, 0).run(at_minima, ResultView(slopes.data()), n);
+	for (size_t i = 0; i < n; ++i) {
+		EXPECT_NEAR(0.0, slopes[i], 1e-12);
+		EXPECT_NEAR(y[i], minima[i], 0.5);
+	}
+
+	// 1 - x^2 has a maximum, not a minimum, between the bounds
+	lower = -1.0;
+	upper = 1.0;
+	double minimum;
+	EXPECT_EQ(0, minimize("1 - x^2", 0, arguments, &lower, &upper, &minimum, 1));
+	EXPECT_TRUE(std::isnan(minimum));
+	EXPECT_EQ(1, minimize("x^2", 0, arguments, &lower, &upper, &minimum, 1));
+	EXPECT_EQ(0.0, minimum);
+}
@@ -249,3 +249,46 @@ TEST(TokenizerTests, TenPowMinusTwo) {
 	tok = tokenizer.getNextToken();
 	EXPECT_EQ(TOK_EOF, tok.id);
 }
+
+TEST(TokenizerTests, Comparisons) {
+	Tokenizer tokenizer("< <= > >= == !=");
+	EXPECT_EQ(TOK_OP_LT, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_LE, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_GT, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_GE, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_EQ, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_NE, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_EOF, tokenizer.getNextToken().id);
+}
+
+TEST(TokenizerTests, Logic) {
+	Tokenizer tokenizer("!x&&y||z");
+	EXPECT_EQ(TOK_UN_NOT, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_ARG, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_AND, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_ARG, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_OP_OR, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_ARG, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_EOF, tokenizer.getNextToken().id);
+}
+
+TEST(TokenizerTests, SingleAmpersand) {
+	Tokenizer tokenizer("x & y");
+	EXPECT_EQ(TOK_ARG, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_ERROR, tokenizer.getNextToken().id);
+}
+
+TEST(TokenizerTests, CallIf) {
+	Tokenizer tokenizer("if(x,1,2)");
+	EXPECT_EQ(TOK_F_IF, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_LPAREN, tokenizer.getNextToken().id);
+}
+
+TEST(TokenizerTests, IdentifiersWithDigits) {
+	Tokenizer tokenizer("log1p expm1 cbrt hypot x2");
+	EXPECT_EQ(TOK_F_LOG1P, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_F_EXPM1, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_F_CBRT, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_F_HYPOT, tokenizer.getNextToken().id);
+	EXPECT_EQ(TOK_IDENT, tokenizer.getNextToken().id);
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include "verifier.hpp"
+#include "ops.hpp"
+
+#include <climits>
+
+TEST(VerifierTests, SingleConstant) {
+	unsigned char program[] = { OP_CONST, 0, OP_HLT };
+	Verifier verifier(program, sizeof(program), 1);
+	EXPECT_EQ(0, verifier.verify());
+	EXPECT_EQ(1, verifier.getStackSize());
+	EXPECT_EQ(0, verifier.getArgumentNumber());
+}
+
+TEST(VerifierTests, StackSizeAndArguments) {
+	// x + (y * z)
+	unsigned char program[] = { OP_ARG, 0, OP_ARG, 1, OP_ARG, 2, OP_MUL, OP_ADD, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_EQ(0, verifier.verify());
+	EXPECT_EQ(3, verifier.getStackSize());
+	EXPECT_EQ(3, verifier.getArgumentNumber());
+}
+
+TEST(VerifierTests, ConstantOutOfRange) {
+	unsigned char program[] = { OP_CONST, 1, OP_HLT };
+	Verifier verifier(program, sizeof(program), 1);
+	EXPECT_NE(0, verifier.verify());
+}
+
+TEST(VerifierTests, StackUnderflow) {
+	unsigned char program[] = { OP_ARG, 0, OP_ADD, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_NE(0, verifier.verify());
+	EXPECT_EQ(2, verifier.getErrorOffset());
+}
+
+TEST(VerifierTests, ValuesLeftOnStack) {
+	unsigned char program[] = { OP_ARG, 0, OP_ARG, 1, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_NE(0, verifier.verify());
+}
+
+TEST(VerifierTests, MissingOperand) {
+	unsigned char program[] = { OP_ARG };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_NE(0, verifier.verify());
+}
+
+TEST(VerifierTests, MissingHlt) {
+	unsigned char program[] = { OP_ARG, 0 };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_NE(0, verifier.verify());
+}
+
+TEST(VerifierTests, UnknownOpcode) {
+	unsigned char program[] = { OP_ARG, 0, UCHAR_MAX, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_NE(0, verifier.verify());
+}
+
+TEST(VerifierTests, Slots) {
+	// sin(x) + cos(x)
+	unsigned char program[] = { OP_ARG, 0, OP_SINCOS, 3, OP_LOAD, 3, OP_ADD, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_EQ(0, verifier.verify());
+	EXPECT_EQ(4, verifier.getSlotNumber());
+}
+
+TEST(VerifierTests, LoadBeforeStore) {
+	unsigned char program[] = { OP_LOAD, 0, OP_ARG, 0, OP_SINCOS, 0, OP_ADD, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0);
+	EXPECT_NE(0, verifier.verify());
+	EXPECT_EQ(0, verifier.getErrorOffset());
+}
+
+TEST(VerifierTests, Calls) {
+	// f(x, 2)
+	unsigned char program[] = { OP_ARG, 0, OP_CONST, 0, OP_CALL, 0, 2, OP_HLT };
+	Verifier verifier(program, sizeof(program), 1, { 2 });
+	EXPECT_EQ(0, verifier.verify());
+	EXPECT_EQ(2, verifier.getStackSize());
+
+	Verifier unknown(program, sizeof(program), 1, {});
+	EXPECT_NE(0, unknown.verify());
+	EXPECT_EQ(4, unknown.getErrorOffset());
+
+	// the function takes three arguments, the call passes two
+	Verifier wrong_arity(program, sizeof(program), 1, { 3 });
+	EXPECT_NE(0, wrong_arity.verify());
+	EXPECT_EQ(4, wrong_arity.getErrorOffset());
+	EXPECT_STREQ("wrong number of arguments", wrong_arity.getError());
+
+	unsigned char underflow[] = { OP_ARG, 0, OP_CALL, 0, 2, OP_HLT };
+	Verifier too_few(underflow, sizeof(underflow), 0, { 2 });
+	EXPECT_NE(0, too_few.verify());
+	EXPECT_EQ(2, too_few.getErrorOffset());
+}
+
+TEST(VerifierTests, StoreAndOutputs) {
+	// x, x + x
+	unsigned char program[] = { OP_ARG, 0, OP_STORE, 1, OP_LOAD, 1, OP_LOAD, 1, OP_ADD, OP_HLT };
+	Verifier verifier(program, sizeof(program), 0, {}, 2);
+	EXPECT_EQ(0, verifier.verify());
+	EXPECT_EQ(2, verifier.getSlotNumber());
+	EXPECT_EQ(3, verifier.getStackSize());
+
+	Verifier single(program, sizeof(program), 0);
+	EXPECT_NE(0, single.verify());
+	EXPECT_EQ(9, single.getErrorOffset());
+}